@@ -33,6 +33,15 @@
 #include "util.h"
 #include "bluetooth.h"
 #include "scandev.h"
+#include "scheduler.h"
+#include "battery.h"
+#include "sensor.h"
+#include "beacon.h"
+#include "group.h"
+#include "events.h"
+#include "payload.h"
+#include "filter.h"
+#include "dedup.h"
 #include "watchdog.h"
 #if defined(ESP32)
 #include "soc/soc.h"
@@ -92,6 +101,14 @@ void setup()
     BLEManufacturerSetup();
     MqttSetup();
     BluetoothSetup();
+    BatterySetup();
+    SensorSetup();
+    BeaconSetup();
+    GroupSetup();
+    EventsSetup();
+    PayloadSetup();
+    FilterSetup();
+    DedupSetup();
     WatchdogSetup(_config.bluetooth.scan_time);
   }
 }
@@ -131,6 +148,12 @@ void loop()
     MqttUpdate();
     BluetoothUpdate();
     ScanDevUpdate();
+    BatteryUpdate();
+    SensorUpdate();
+    BeaconUpdate();
+    GroupUpdate();
+    EventsUpdate();
+    DedupUpdate();
   }
 
   /*
@@ -143,6 +166,7 @@ void loop()
       */
       LogMsg(__TITLE__ ": scanning");
       LedSetup(LED_MODE_BLINK_SLOW);
+      BatteryCancel();
       BluetoothScanStart();
       break;
     case STATE_PAUSING:
@@ -152,6 +176,11 @@ void loop()
       LogMsg(__TITLE__ ": pausing");
       LedSetup(LED_MODE_BLINK_SLOW);
       BluetoothScanStop();
+
+      /*
+         adapt the scan & pause time to what happened during the scan
+      */
+      SchedulerUpdate();
       break;
     case STATE_CONFIGURING:
       /*
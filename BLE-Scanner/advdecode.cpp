@@ -0,0 +1,356 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to decode well known advertisement frames
+
+  The decoders are registered in a hash table, which is built by the
+  compiler. Each decoder sits in the bucket of its key, so the lookup
+  is a single table access. A static_assert ensures that no two
+  decoders share a bucket -- if a new decoder collides, the table has
+  to grow.
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "advdecode.h"
+
+/*
+   the hash table of the decoders
+*/
+#define ADVDECODE_BUCKETS         32
+#define ADVDECODE_KEY(source,id)  (((uint32_t) (source) << 16) | (id))
+#define ADVDECODE_BUCKET(key)     (((key) ^ ((key) >> 8) ^ ((key) >> 16)) & (ADVDECODE_BUCKETS - 1))
+
+/*
+   read big endian values
+*/
+#define ADVDECODE_BE16(p)         ((uint16_t) (((p)[0] << 8) | (p)[1]))
+#define ADVDECODE_LE16(p)         ((uint16_t) ((p)[0] | ((p)[1] << 8)))
+#define ADVDECODE_LE24(p)         ((uint32_t) ((p)[0] | ((p)[1] << 8) | ((uint32_t) (p)[2] << 16)))
+#define ADVDECODE_BE32(p)         ((uint32_t) (((uint32_t) (p)[0] << 24) | ((uint32_t) (p)[1] << 16) | ((p)[2] << 8) | (p)[3]))
+
+/*
+   decoder for the Apple continuity messages -- including iBeacon
+*/
+static bool AdvDecodeApple(const uint8_t *data, size_t length, ADVDECODE_T *frame)
+{
+  if (length < 4)
+    return false;
+
+  if (data[2] == 0x02 && data[3] == 0x15 && length >= 25) {
+    /*
+       iBeacon
+    */
+    frame->type = ADVDECODE_IBEACON;
+    memcpy(frame->ibeacon.uuid, &data[4], sizeof(frame->ibeacon.uuid));
+    frame->ibeacon.major = ADVDECODE_BE16(&data[20]);
+    frame->ibeacon.minor = ADVDECODE_BE16(&data[22]);
+    frame->ibeacon.txpower = (int8_t) data[24];
+    return true;
+  }
+
+  frame->type = ADVDECODE_APPLE;
+  frame->apple.type = data[2];
+  frame->apple.length = data[3];
+  frame->apple.data = (length > 4) ? data[4] : 0;
+  return true;
+}
+
+/*
+   decoder for the Microsoft Connected Devices Platform beacon
+*/
+static bool AdvDecodeMicrosoft(const uint8_t *data, size_t length, ADVDECODE_T *frame)
+{
+  if (length < 4)
+    return false;
+
+  frame->type = ADVDECODE_MICROSOFT_CDP;
+  frame->microsoft.scenario = data[2];
+  frame->microsoft.version = data[3] >> 5;
+  frame->microsoft.device_type = data[3] & 0x1f;
+  return true;
+}
+
+/*
+   decoder for the Eddystone frames
+*/
+static bool AdvDecodeEddystone(const uint8_t *data, size_t length, ADVDECODE_T *frame)
+{
+  static const char *schemes[] = { "http://www.", "https://www.", "http://", "https://" };
+  static const char *expansions[] = {
+    ".com/", ".org/", ".edu/", ".net/", ".info/", ".biz/", ".gov/",
+    ".com", ".org", ".edu", ".net", ".info", ".biz", ".gov",
+  };
+
+  if (length < 2)
+    return false;
+
+  switch (data[0]) {
+    case 0x00:
+      if (length < 18)
+        return false;
+      frame->type = ADVDECODE_EDDYSTONE_UID;
+      frame->eddystone_uid.txpower = (int8_t) data[1];
+      memcpy(frame->eddystone_uid.ns, &data[2], sizeof(frame->eddystone_uid.ns));
+      memcpy(frame->eddystone_uid.instance, &data[12], sizeof(frame->eddystone_uid.instance));
+      return true;
+    case 0x10: {
+        if (length < 3 || data[2] >= sizeof(schemes) / sizeof(schemes[0]))
+          return false;
+
+        char *url = frame->eddystone_url.url;
+        size_t len = strlen(schemes[data[2]]);
+
+        strcpy(url, schemes[data[2]]);
+        for (size_t n = 3; n < length; n++) {
+          if (data[n] < sizeof(expansions) / sizeof(expansions[0])) {
+            for (const char *s = expansions[data[n]]; *s && len < ADVDECODE_URL_LENGTH; s++)
+              url[len++] = *s;
+          }
+          else if (data[n] > 0x20 && data[n] < 0x7f && data[n] != '"' && data[n] != '\\') {
+            if (len < ADVDECODE_URL_LENGTH)
+              url[len++] = data[n];
+          }
+          else {
+            /*
+               not a valid URL character -- as the URL is published
+               in JSON, a malformed frame is dropped
+            */
+            return false;
+          }
+        }
+        url[len] = '\0';
+        frame->type = ADVDECODE_EDDYSTONE_URL;
+        frame->eddystone_url.txpower = (int8_t) data[1];
+        return true;
+      }
+    case 0x20:
+      if (length < 14 || data[1] != 0x00)
+        return false;   // encrypted TLM
+      frame->type = ADVDECODE_EDDYSTONE_TLM;
+      frame->eddystone_tlm.battery = ADVDECODE_BE16(&data[2]);
+      frame->eddystone_tlm.temperature = (int16_t) ADVDECODE_BE16(&data[4]);
+      frame->eddystone_tlm.adv_count = ADVDECODE_BE32(&data[6]);
+      frame->eddystone_tlm.uptime = ADVDECODE_BE32(&data[10]);
+      return true;
+  }
+  return false;
+}
+
+/*
+   store a metric of a sensor frame
+*/
+#define ADVDECODE_METRIC(frame,metric,val) { (frame)->sensor.value[metric] = (val); (frame)->sensor.present |= 1 << (metric); }
+
+/*
+   decoder for the RuuviTag data format 5 (RAWv2)
+*/
+static bool AdvDecodeRuuvi(const uint8_t *data, size_t length, ADVDECODE_T *frame)
+{
+  if (length < 26 || data[2] != 0x05)
+    return false;
+
+  int16_t temperature = (int16_t) ADVDECODE_BE16(&data[3]);
+  uint16_t humidity = ADVDECODE_BE16(&data[5]);
+  uint16_t pressure = ADVDECODE_BE16(&data[7]);
+  uint16_t voltage = ADVDECODE_BE16(&data[15]) >> 5;
+
+  frame->type = ADVDECODE_SENSOR;
+  frame->sensor.format = ADVDECODE_SENSOR_RUUVI;
+  frame->sensor.present = 0;
+  if (temperature != (int16_t) 0x8000)
+    ADVDECODE_METRIC(frame, ADVDECODE_METRIC_TEMPERATURE, temperature / 2);   // 0.005 degree
+  if (humidity != 0xffff)
+    ADVDECODE_METRIC(frame, ADVDECODE_METRIC_HUMIDITY, humidity / 4);         // 0.0025 %
+  if (pressure != 0xffff)
+    ADVDECODE_METRIC(frame, ADVDECODE_METRIC_PRESSURE, pressure + 50000);     // Pa with an offset of 50000 Pa
+  if (voltage != 0x7ff)
+    ADVDECODE_METRIC(frame, ADVDECODE_METRIC_VOLTAGE, voltage + 1600);        // mV with an offset of 1600 mV
+  return frame->sensor.present != 0;
+}
+
+/*
+   size of the BTHome v2 objects -- 0 for unknown objects, 0xff for objects with a length byte
+*/
+static const uint8_t _bthome_sizes[] = {
+  /* 0x00 */ 1, 1, 2, 2, 3, 3, 2, 2, 2, 1, 3, 3, 2, 2, 2, 1,
+  /* 0x10 */ 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  /* 0x20 */ 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  /* 0x30 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 2, 2, 4, 2,
+  /* 0x40 */ 2, 2, 3, 2, 2, 2, 1, 2, 2, 2, 2, 3, 4, 4, 4, 4,
+  /* 0x50 */ 4, 2, 2, 0xff, 0xff, 4, 2, 1, 1, 1, 2, 4, 4, 2, 2, 2,
+  /* 0x60 */ 1,
+};
+
+/*
+   decoder for unencrypted BTHome v2
+*/
+static bool AdvDecodeBTHome(const uint8_t *data, size_t length, ADVDECODE_T *frame)
+{
+  if (length < 1 || (data[0] & 0x01) || (data[0] >> 5) != 2)
+    return false;
+
+  frame->type = ADVDECODE_SENSOR;
+  frame->sensor.format = ADVDECODE_SENSOR_BTHOME;
+  frame->sensor.present = 0;
+
+  for (size_t n = 1; n < length;) {
+    uint8_t id = data[n++];
+    size_t size = (id < sizeof(_bthome_sizes)) ? _bthome_sizes[id] : 0;
+
+    if (size == 0xff)
+      size = (n < length) ? data[n++] : length;
+    if (size == 0 || n + size > length)
+      break;    // unknown object or truncated frame
+
+    const uint8_t *value = &data[n];
+
+    switch (id) {
+      case 0x01: ADVDECODE_METRIC(frame, ADVDECODE_METRIC_BATTERY, value[0]); break;
+      case 0x02: ADVDECODE_METRIC(frame, ADVDECODE_METRIC_TEMPERATURE, (int16_t) ADVDECODE_LE16(value)); break;
+      case 0x03: ADVDECODE_METRIC(frame, ADVDECODE_METRIC_HUMIDITY, ADVDECODE_LE16(value)); break;
+      case 0x04: ADVDECODE_METRIC(frame, ADVDECODE_METRIC_PRESSURE, ADVDECODE_LE24(value)); break;
+      case 0x05: ADVDECODE_METRIC(frame, ADVDECODE_METRIC_ILLUMINANCE, ADVDECODE_LE24(value)); break;
+      case 0x0c: ADVDECODE_METRIC(frame, ADVDECODE_METRIC_VOLTAGE, ADVDECODE_LE16(value)); break;
+      case 0x12: ADVDECODE_METRIC(frame, ADVDECODE_METRIC_CO2, ADVDECODE_LE16(value)); break;
+      case 0x2e: ADVDECODE_METRIC(frame, ADVDECODE_METRIC_HUMIDITY, value[0] * 100); break;
+      case 0x45: ADVDECODE_METRIC(frame, ADVDECODE_METRIC_TEMPERATURE, (int16_t) ADVDECODE_LE16(value) * 10); break;
+      case 0x4a: ADVDECODE_METRIC(frame, ADVDECODE_METRIC_VOLTAGE, ADVDECODE_LE16(value) * 100); break;
+      case 0x57: ADVDECODE_METRIC(frame, ADVDECODE_METRIC_TEMPERATURE, (int8_t) value[0] * 100); break;
+    }
+    n += size;
+  }
+  return frame->sensor.present != 0;
+}
+
+/*
+   a registered decoder
+*/
+typedef struct _advdecode_decoder {
+  uint32_t key;
+  bool (*decode)(const uint8_t *data, size_t length, ADVDECODE_T *frame);
+} ADVDECODE_DECODER_T;
+
+#define ADVDECODE_EMPTY           { 0, NULL }
+
+/*
+   the decoders -- each one has to be placed in the bucket of its key
+*/
+static constexpr ADVDECODE_DECODER_T _decoders[ADVDECODE_BUCKETS] = {
+  /*  0 */ ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY,
+  /*  4 */ ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY,
+  /*  7 */ { ADVDECODE_KEY(ADVDECODE_MANUFACTURER, ADVDECODE_COMPANY_MICROSOFT), AdvDecodeMicrosoft },
+  /*  8 */ ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY,
+  /* 12 */ { ADVDECODE_KEY(ADVDECODE_SERVICE, ADVDECODE_UUID_BTHOME), AdvDecodeBTHome },
+  /* 13 */ { ADVDECODE_KEY(ADVDECODE_MANUFACTURER, ADVDECODE_COMPANY_APPLE), AdvDecodeApple },
+  /* 14 */ ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY,
+  /* 18 */ ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY,
+  /* 22 */ { ADVDECODE_KEY(ADVDECODE_SERVICE, ADVDECODE_UUID_EDDYSTONE), AdvDecodeEddystone },
+  /* 23 */ ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY,
+  /* 28 */ { ADVDECODE_KEY(ADVDECODE_MANUFACTURER, ADVDECODE_COMPANY_RUUVI), AdvDecodeRuuvi },
+  /* 29 */ ADVDECODE_EMPTY, ADVDECODE_EMPTY, ADVDECODE_EMPTY,
+};
+
+/*
+   check at compile time, that each decoder sits in its bucket
+*/
+static constexpr bool AdvDecodeCheck(int n)
+{
+  return n >= ADVDECODE_BUCKETS
+         || ((!_decoders[n].decode || ADVDECODE_BUCKET(_decoders[n].key) == (uint32_t) n) && AdvDecodeCheck(n + 1));
+}
+static_assert(AdvDecodeCheck(0), "advertisement decoder placed in the wrong bucket");
+
+/*
+   decode manufacturer or service data into a frame
+
+   return true if the data was decoded
+*/
+bool AdvDecode(int source, uint16_t id, const uint8_t *data, size_t length, ADVDECODE_T *frame)
+{
+  uint32_t key = ADVDECODE_KEY(source, id);
+  const ADVDECODE_DECODER_T *decoder = &_decoders[ADVDECODE_BUCKET(key)];
+
+  if (!decoder->decode || decoder->key != key)
+    return false;
+  if (!decoder->decode(data, length, frame)) {
+    frame->type = ADVDECODE_NONE;
+    return false;
+  }
+  return true;
+}
+
+/*
+   convert bytes into a hex string
+*/
+static String AdvDecodeHex(const uint8_t *data, int length)
+{
+  char hex[2 * 16 + 1];
+  int n;
+
+  for (n = 0; n < length && n < 16; n++)
+    sprintf(&hex[2 * n], "%02X", data[n]);
+  hex[2 * n] = '\0';
+  return String(hex);
+}
+
+/*
+   return the decoded frame as a JSON member -- empty if there is none
+
+   sensor frames are published per metric by the sensor module
+*/
+String AdvDecodeToJSON(const ADVDECODE_T *frame)
+{
+  switch (frame->type) {
+    case ADVDECODE_IBEACON:
+      return "\"iBeacon\":{"
+             "\"UUID\":\"" + AdvDecodeHex(frame->ibeacon.uuid, sizeof(frame->ibeacon.uuid)) + "\","
+             "\"Major\":" + String(frame->ibeacon.major) + ","
+             "\"Minor\":" + String(frame->ibeacon.minor) + ","
+             "\"TxPower\":" + String(frame->ibeacon.txpower) + "}";
+    case ADVDECODE_EDDYSTONE_UID:
+      return "\"Eddystone\":{"
+             "\"Namespace\":\"" + AdvDecodeHex(frame->eddystone_uid.ns, sizeof(frame->eddystone_uid.ns)) + "\","
+             "\"Instance\":\"" + AdvDecodeHex(frame->eddystone_uid.instance, sizeof(frame->eddystone_uid.instance)) + "\","
+             "\"TxPower\":" + String(frame->eddystone_uid.txpower) + "}";
+    case ADVDECODE_EDDYSTONE_URL:
+      return "\"Eddystone\":{"
+             "\"URL\":\"" + String(frame->eddystone_url.url) + "\","
+             "\"TxPower\":" + String(frame->eddystone_url.txpower) + "}";
+    case ADVDECODE_EDDYSTONE_TLM:
+      return "\"Eddystone\":{"
+             "\"Battery\":" + String(frame->eddystone_tlm.battery) + ","
+             "\"Temperature\":" + String(frame->eddystone_tlm.temperature / 256.0, 1) + ","
+             "\"AdvCount\":" + String(frame->eddystone_tlm.adv_count) + ","
+             "\"Uptime\":" + String(frame->eddystone_tlm.uptime / 10) + "}";
+    case ADVDECODE_MICROSOFT_CDP:
+      return "\"Microsoft\":{"
+             "\"Scenario\":" + String(frame->microsoft.scenario) + ","
+             "\"Version\":" + String(frame->microsoft.version) + ","
+             "\"DeviceType\":" + String(frame->microsoft.device_type) + "}";
+    case ADVDECODE_APPLE:
+      return "\"Apple\":{"
+             "\"Type\":" + String(frame->apple.type) + ","
+             "\"Length\":" + String(frame->apple.length) + ","
+             "\"Data\":" + String(frame->apple.data) + "}";
+  }
+  return "";
+}/**/
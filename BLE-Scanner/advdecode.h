@@ -0,0 +1,147 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to decode well known advertisement frames
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __ADVDECODE_H__
+#define __ADVDECODE_H__ 1
+
+#include <Arduino.h>
+#include "config.h"
+
+/*
+   the source of the data to decode
+*/
+#define ADVDECODE_MANUFACTURER    1       // manufacturer data keyed by the company id
+#define ADVDECODE_SERVICE         2       // service data keyed by the 16 bit UUID
+
+/*
+   company ids and UUIDs of the known frames
+*/
+#define ADVDECODE_COMPANY_MICROSOFT     0x0006
+#define ADVDECODE_COMPANY_APPLE         0x004C
+#define ADVDECODE_COMPANY_RUUVI         0x0499
+#define ADVDECODE_UUID_BTHOME           0xFCD2
+#define ADVDECODE_UUID_EDDYSTONE        0xFEAA
+
+/*
+   maximum length of a decoded Eddystone URL
+*/
+#define ADVDECODE_URL_LENGTH      32
+
+/*
+   the types of decoded frames
+*/
+enum ADVDECODE_TYPE {
+  ADVDECODE_NONE = 0,
+  ADVDECODE_IBEACON,
+  ADVDECODE_EDDYSTONE_UID,
+  ADVDECODE_EDDYSTONE_URL,
+  ADVDECODE_EDDYSTONE_TLM,
+  ADVDECODE_MICROSOFT_CDP,
+  ADVDECODE_APPLE,
+  ADVDECODE_SENSOR,
+};
+
+/*
+   the metrics of a sensor frame -- all values are fixed point
+*/
+enum ADVDECODE_METRIC {
+  ADVDECODE_METRIC_TEMPERATURE = 0,   // 0.01 degree celsius
+  ADVDECODE_METRIC_HUMIDITY,          // 0.01 %
+  ADVDECODE_METRIC_PRESSURE,          // Pa
+  ADVDECODE_METRIC_BATTERY,           // %
+  ADVDECODE_METRIC_VOLTAGE,           // mV
+  ADVDECODE_METRIC_ILLUMINANCE,       // 0.01 lux
+  ADVDECODE_METRIC_CO2,               // ppm
+  ADVDECODE_METRICS
+};
+
+/*
+   the formats of a sensor frame
+*/
+#define ADVDECODE_SENSOR_BTHOME   1
+#define ADVDECODE_SENSOR_RUUVI    2
+
+/*
+   a decoded frame
+*/
+typedef struct _advdecode_frame {
+  uint8_t type;
+  union {
+    struct {
+      uint8_t uuid[16];
+      uint16_t major;
+      uint16_t minor;
+      int8_t txpower;             // RSSI at 1 m
+    } ibeacon;
+    struct {
+      int8_t txpower;             // RSSI at 0 m
+      uint8_t ns[10];
+      uint8_t instance[6];
+    } eddystone_uid;
+    struct {
+      int8_t txpower;             // RSSI at 0 m
+      char url[ADVDECODE_URL_LENGTH + 1];
+    } eddystone_url;
+    struct {
+      uint16_t battery;           // battery voltage in mV
+      int16_t temperature;        // temperature in 1/256 degree celsius
+      uint32_t adv_count;         // number of advertisements since power up
+      uint32_t uptime;            // time since power up in 0.1 s
+    } eddystone_tlm;
+    struct {
+      uint8_t scenario;           // 1 = Bluetooth
+      uint8_t version;
+      uint8_t device_type;        // 1 = Xbox One, 9 = Windows desktop, ...
+    } microsoft;
+    struct {
+      uint8_t type;               // type of the continuity message, 0x10 = Nearby Info, ...
+      uint8_t length;
+      uint8_t data;               // first byte of the message
+    } apple;
+    struct {
+      uint8_t format;             // BTHome or Ruuvi
+      uint8_t present;            // bit mask of the metrics in this frame
+      int32_t value[ADVDECODE_METRICS];
+    } sensor;
+  };
+} ADVDECODE_T;
+
+/*
+   decode manufacturer or service data into a frame
+
+   return true if the data was decoded
+*/
+bool AdvDecode(int source, uint16_t id, const uint8_t *data, size_t length, ADVDECODE_T *frame);
+
+/*
+   return the decoded frame as a JSON member -- empty if there is none
+
+   sensor frames are published per metric by the sensor module
+*/
+String AdvDecodeToJSON(const ADVDECODE_T *frame);
+
+#endif
+
+/**/
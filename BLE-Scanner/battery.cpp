@@ -0,0 +1,594 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to read the battery level and the device information of devices
+
+  The connection is established asynchronously, the NimBLE callbacks
+  drive the state of each connection. Each slot keeps its client, so
+  the clients are created only once and reused for all checks. As the
+  service discovery and the read of the characteristic are blocking
+  calls, they are done by a worker task, so the main loop never waits
+  for a device. The battery level and the device information are read
+  over the same connection.
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "state.h"
+#include "bluetooth.h"
+#include "scandev.h"
+#include "battery.h"
+#include "gattcache.h"
+#include "util.h"
+
+/*
+   states of a connection slot
+
+   once connected, the slot belongs to the worker until it hands it back
+   as closed -- neither the callbacks nor the loop touch it in between
+*/
+enum BATTERY_SLOT_STATE {
+  BATTERY_SLOT_FREE = 0,      // slot is unused
+  BATTERY_SLOT_CONNECTING,    // connection was requested
+  BATTERY_SLOT_CONNECTED,     // connection is established and queued for the worker
+  BATTERY_SLOT_WORKING,       // the worker reads the characteristics
+  BATTERY_SLOT_CLOSED,        // connection is closed or failed, the result can be taken over
+};
+
+/*
+   a connection slot
+*/
+typedef struct _battery_slot {
+  volatile int state;
+  SCANDEV_T *device;
+  BLEAddress addr;
+  NimBLEClient *client;
+  unsigned long started;
+  bool read_battery;
+  bool read_info;
+  volatile bool success;
+  volatile uint8_t level;
+  GATTCACHE_ENTRY_T info;
+} BATTERY_SLOT_T;
+
+static BATTERY_SLOT_T _slots[BATTERY_CONNECTIONS_MAX];
+static portMUX_TYPE _battery_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/*
+   the devices waiting for a connection
+*/
+static struct {
+  SCANDEV_T *device;
+  BLEAddress addr;
+  bool read_battery;
+  bool read_info;
+} _queue[BATTERY_QUEUE_LENGTH];
+static int _queue_head = 0;
+static int _queue_count = 0;
+
+/*
+   the worker task and its queue of connected slots
+*/
+static TaskHandle_t _worker = NULL;
+static QueueHandle_t _worker_queue = NULL;
+
+/*
+   the stack is about to be re-initialized -- the worker skips its reads
+   and acknowledges by handing its slots back as closed
+*/
+static volatile bool _stopping = false;
+
+/*
+   some stats
+*/
+static unsigned long _advertised = 0;
+static unsigned long _checks = 0;
+static unsigned long _failures = 0;
+static unsigned long _enriched = 0;
+
+/*
+   the connection budget in milli seconds -- each connection costs a share of a minute
+*/
+static unsigned long _budget = 60 * 1000;
+static unsigned long _budget_updated = 0;
+
+/*
+   find the slot of a client
+*/
+static BATTERY_SLOT_T *BatterySlot(NimBLEClient *client)
+{
+  for (int n = 0; n < BATTERY_CONNECTIONS_MAX; n++)
+    if (_slots[n].state != BATTERY_SLOT_FREE && _slots[n].client == client)
+      return &_slots[n];
+  return NULL;
+}
+
+/*
+   switch the state of a slot if it is still in the expected state
+*/
+static bool BatterySlotSwitch(BATTERY_SLOT_T *slot, int from, int to)
+{
+  bool switched = false;
+
+  portENTER_CRITICAL(&_battery_mux);
+  if (slot->state == from) {
+    slot->state = to;
+    switched = true;
+  }
+  portEXIT_CRITICAL(&_battery_mux);
+  return switched;
+}
+
+/*
+   callback class to follow the connection
+
+   NOTE: these are called in the context of the NimBLE task
+*/
+class BatteryClientCallbacks : public NimBLEClientCallbacks {
+    void onConnect(NimBLEClient *client) {
+      BATTERY_SLOT_T *slot = BatterySlot(client);
+
+      if (!slot || !BatterySlotSwitch(slot, BATTERY_SLOT_CONNECTING, BATTERY_SLOT_CONNECTED)) {
+        /*
+           the attempt was given up in the meantime
+        */
+        client->disconnect();
+        return;
+      }
+
+      /*
+         hand the connection over to the worker
+      */
+      int n = slot - _slots;
+
+      if (xQueueSend(_worker_queue, &n, 0) != pdTRUE) {
+        slot->state = BATTERY_SLOT_CLOSED;
+        client->disconnect();
+      }
+    }
+    void onConnectFail(NimBLEClient *client, int reason) {
+      BATTERY_SLOT_T *slot = BatterySlot(client);
+
+      if (slot)
+        BatterySlotSwitch(slot, BATTERY_SLOT_CONNECTING, BATTERY_SLOT_CLOSED);
+    }
+    void onDisconnect(NimBLEClient *client, int reason) {
+      BATTERY_SLOT_T *slot = BatterySlot(client);
+
+      /*
+         a connected slot is handed back by the worker only
+      */
+      if (slot)
+        BatterySlotSwitch(slot, BATTERY_SLOT_CONNECTING, BATTERY_SLOT_CLOSED);
+    }
+};
+
+static BatteryClientCallbacks _client_callbacks;
+
+/*
+   read a string characteristic
+*/
+static bool BatteryReadString(NimBLEClient *client, const BLEUUID &service_uuid, const BLEUUID &uuid, char *value, size_t size)
+{
+  NimBLERemoteService *service = client->getService(service_uuid);
+  NimBLERemoteCharacteristic *characteristic;
+
+  if (!service || !(characteristic = service->getCharacteristic(uuid)) || !characteristic->canRead())
+    return false;
+
+  std::string data = characteristic->readValue();
+
+  strncpy(value, data.c_str(), size - 1);
+  value[size - 1] = '\0';
+  return true;
+}
+
+/*
+   the worker task reads the characteristics of connected devices
+*/
+static void BatteryWorker(void *param)
+{
+  int n;
+
+  for (;;) {
+    if (xQueueReceive(_worker_queue, &n, portMAX_DELAY) != pdTRUE)
+      continue;
+
+    BATTERY_SLOT_T *slot = &_slots[n];
+
+    if (!BatterySlotSwitch(slot, BATTERY_SLOT_CONNECTED, BATTERY_SLOT_WORKING))
+      continue;
+
+    NimBLEClient *client = slot->client;
+    NimBLERemoteService *service;
+    NimBLERemoteCharacteristic *characteristic;
+
+    /*
+       select the service and get the characteristic
+    */
+    if (slot->read_battery && !_stopping && client->isConnected()
+        && (service = client->getService(BLEBatteryService))
+        && (characteristic = service->getCharacteristic(BLEBatteryCharacteristics))
+        && characteristic->canRead()) {
+      slot->level = characteristic->readValue<uint8_t>();
+      slot->success = true;
+    }
+
+    /*
+       read the device information
+    */
+    if (slot->read_info && !_stopping && client->isConnected()) {
+      GATTCACHE_ENTRY_T *info = &slot->info;
+      bool valid = false;
+
+      valid |= BatteryReadString(client, GATTCACHE_GAP_SERVICE, GATTCACHE_DEVICE_NAME, info->name, sizeof(info->name));
+      valid |= BatteryReadString(client, GATTCACHE_DEVICE_INFO_SERVICE, GATTCACHE_MODEL_NUMBER, info->model, sizeof(info->model));
+      valid |= BatteryReadString(client, GATTCACHE_DEVICE_INFO_SERVICE, GATTCACHE_MANUFACTURER_NAME, info->manufacturer, sizeof(info->manufacturer));
+      valid |= BatteryReadString(client, GATTCACHE_DEVICE_INFO_SERVICE, GATTCACHE_FIRMWARE_REVISION, info->firmware, sizeof(info->firmware));
+      info->valid = valid;
+    }
+
+    /*
+       hand the slot back to the loop once the client is disconnected,
+       so the pooled client isn't reused while it is still connected
+    */
+    client->disconnect();
+    for (int wait = 0; client->isConnected() && wait < BATTERY_DISCONNECT_TIMEOUT; wait += 10)
+      vTaskDelay(pdMS_TO_TICKS(10));
+    slot->state = BATTERY_SLOT_CLOSED;
+  }
+}
+
+/*
+   take over the result of a closed slot
+*/
+static void BatteryClose(BATTERY_SLOT_T *slot)
+{
+  if (slot->read_info) {
+    /*
+       even a failed attempt is cached, so the device isn't contacted again too soon
+    */
+    _enriched++;
+    GattCacheUpdate(slot->addr, &slot->info);
+    ScanDevInfoResult(slot->device, slot->addr);
+  }
+
+  if (slot->read_battery) {
+    _checks++;
+    if (!slot->success) {
+      _failures++;
+      LogMsg("BATTERY: couldn't read battery level of device %s", slot->addr.toString().c_str());
+    }
+    ScanDevBatteryResult(slot->device, slot->addr, slot->success, slot->level);
+  }
+
+  slot->device = NULL;
+  slot->state = BATTERY_SLOT_FREE;
+}
+
+/*
+   setup the battery reader
+*/
+void BatterySetup(void)
+{
+  /*
+     check and correct the config
+  */
+  FIX_RANGE(_config.bluetooth.battcheck_timeout, BLUETOOTH_BATTCHECK_TIMEOUT_MIN, BLUETOOTH_BATTCHECK_TIMEOUT_MAX);
+  _config.bluetooth.enrich = _config.bluetooth.enrich ? true : false;
+  if (!_config.bluetooth.enrich_ttl)
+    _config.bluetooth.enrich_ttl = BLUETOOTH_ENRICH_TTL_DEFAULT;
+  FIX_RANGE(_config.bluetooth.enrich_ttl, BLUETOOTH_ENRICH_TTL_MIN, BLUETOOTH_ENRICH_TTL_MAX);
+  if (!_config.bluetooth.connect_budget)
+    _config.bluetooth.connect_budget = BLUETOOTH_CONNECT_BUDGET_DEFAULT;
+  FIX_RANGE(_config.bluetooth.connect_budget, BLUETOOTH_CONNECT_BUDGET_MIN, BLUETOOTH_CONNECT_BUDGET_MAX);
+
+  GattCacheSetup();
+
+  if (_worker)
+    return;
+
+  LogMsg("BATTERY: starting worker task");
+  _worker_queue = xQueueCreate(BATTERY_CONNECTIONS_MAX, sizeof(int));
+  if (!_worker_queue || xTaskCreate(BatteryWorker, "battery", 4096, NULL, 1, &_worker) != pdPASS)
+    LogMsg("BATTERY: couldn't create worker task");
+}
+
+/*
+   check if the connection budget allows another connection
+*/
+static bool BatteryBudget(void)
+{
+  unsigned long cost = 60 * 1000 / _config.bluetooth.connect_budget;
+
+  _budget = MIN(_budget + (millis() - _budget_updated), 60 * 1000UL);
+  _budget_updated = millis();
+  if (_budget < cost)
+    return false;
+  _budget -= cost;
+  return true;
+}
+
+/*
+   do the cyclic update
+
+   connections are only started while the scan pauses -- a connection
+   would stop a running scan
+*/
+void BatteryUpdate(void)
+{
+  for (int n = 0; n < BATTERY_CONNECTIONS_MAX; n++) {
+    BATTERY_SLOT_T *slot = &_slots[n];
+
+    switch (slot->state) {
+      case BATTERY_SLOT_CONNECTING:
+        /*
+           the stack should report a timeout -- this is just to be sure
+        */
+        if (millis() - slot->started > 2 * BATTERY_CONNECT_TIMEOUT && !slot->client->cancelConnect())
+          BatterySlotSwitch(slot, BATTERY_SLOT_CONNECTING, BATTERY_SLOT_CLOSED);
+        break;
+      case BATTERY_SLOT_CLOSED:
+        BatteryClose(slot);
+        break;
+    }
+
+    if (slot->state == BATTERY_SLOT_FREE && _queue_count > 0 && _worker && !_stopping
+        && !(slot->client && slot->client->isConnected())
+        && StateCheck(STATE_PAUSING) && !_config.bluetooth.continuous && BatteryBudget()) {
+      /*
+         start the next connection
+      */
+      slot->device = _queue[_queue_head].device;
+      slot->addr = _queue[_queue_head].addr;
+      slot->read_battery = _queue[_queue_head].read_battery;
+      slot->read_info = _queue[_queue_head].read_info;
+      _queue_head = (_queue_head + 1) % BATTERY_QUEUE_LENGTH;
+      _queue_count--;
+      if (slot->device->addr != slot->addr) {
+        /*
+           the record was taken over by another device in the meantime
+        */
+        continue;
+      }
+      slot->success = false;
+      memset(&slot->info, 0, sizeof(slot->info));
+
+      if (!slot->client) {
+        /*
+           create the client of this slot
+        */
+        if (!(slot->client = NimBLEDevice::createClient())) {
+          LogMsg("BATTERY: couldn't create client");
+          slot->state = BATTERY_SLOT_CLOSED;
+          continue;
+        }
+        slot->client->setClientCallbacks(&_client_callbacks, false);
+        slot->client->setConnectTimeout(BATTERY_CONNECT_TIMEOUT);
+        slot->client->setConnectionParams(BATTERY_CONN_INTERVAL, BATTERY_CONN_INTERVAL,
+                                          BATTERY_CONN_LATENCY, BATTERY_CONN_TIMEOUT);
+      }
+      slot->started = millis();
+      slot->state = BATTERY_SLOT_CONNECTING;
+
+#if DBG_BT
+      DbgMsg("BATTERY: connect device %s ...", slot->addr.toString().c_str());
+#endif
+      if (!slot->client->connect(slot->addr, true, true))
+        slot->state = BATTERY_SLOT_CLOSED;
+    }
+  }
+}
+
+/*
+   queue a device to read its battery level and/or its device information
+
+   return false if the queue is full
+*/
+bool BatteryRequest(SCANDEV_T *device, bool read_battery, bool read_info)
+{
+  if (_queue_count >= BATTERY_QUEUE_LENGTH)
+    return false;
+
+  int n = (_queue_head + _queue_count++) % BATTERY_QUEUE_LENGTH;
+
+  _queue[n].device = device;
+  _queue[n].addr = device->addr;
+  _queue[n].read_battery = read_battery;
+  _queue[n].read_info = read_info;
+  return true;
+}
+
+/*
+   cancel all connections which are not yet established -- called before the scan starts
+*/
+void BatteryCancel(void)
+{
+  for (int n = 0; n < BATTERY_CONNECTIONS_MAX; n++)
+    if (_slots[n].state == BATTERY_SLOT_CONNECTING && !_slots[n].client->cancelConnect())
+      BatterySlotSwitch(&_slots[n], BATTERY_SLOT_CONNECTING, BATTERY_SLOT_CLOSED);
+}
+
+/*
+   decoder for the battery service data -- the level is the only content
+*/
+static int BatteryDecodeBatteryService(const uint8_t *data, size_t length)
+{
+  return (length >= 1) ? data[0] : -1;
+}
+
+/*
+   decoder for the custom formats of the ATC1441 and pvvx firmwares
+*/
+static int BatteryDecodeEnvironmental(const uint8_t *data, size_t length)
+{
+  if (length == 13)
+    return data[9];     // ATC1441: mac, temperature, humidity, battery level, ...
+  if (length == 15)
+    return data[12];    // pvvx: mac, temperature, humidity, battery voltage, battery level, ...
+  return -1;
+}
+
+/*
+   decoder for unencrypted Xiaomi MiBeacon
+*/
+static int BatteryDecodeXiaomi(const uint8_t *data, size_t length)
+{
+  if (length < 5)
+    return -1;
+
+  uint16_t frame_control = data[0] | (data[1] << 8);
+  size_t n = 5;
+
+  if ((frame_control & 0x0008) || !(frame_control & 0x0040))
+    return -1;  // encrypted or without object
+  if (frame_control & 0x0010)
+    n += 6;     // mac address
+  if (frame_control & 0x0020) {
+    if (n < length && (data[n] & 0x20))
+      n += 2;   // io capability
+    n += 1;     // capability
+  }
+  if (n + 3 < length && (data[n] | (data[n + 1] << 8)) == 0x100A && data[n + 2] >= 1)
+    return data[n + 3];
+  return -1;
+}
+
+/*
+   table of the known service data formats
+*/
+static const struct {
+  uint16_t uuid;
+  int (*decode)(const uint8_t *data, size_t length);
+} _decoders[] = {
+  { BATTERY_UUID_BATTERY_SERVICE, BatteryDecodeBatteryService },
+  { BATTERY_UUID_ENVIRONMENTAL, BatteryDecodeEnvironmental },
+  { BATTERY_UUID_XIAOMI, BatteryDecodeXiaomi },
+};
+
+/*
+   decode the battery level out of the service data of an advertisement
+
+   return -1 if the service data doesn't carry a battery level
+*/
+int BatteryDecode(uint16_t uuid, const uint8_t *data, size_t length)
+{
+  for (size_t n = 0; n < sizeof(_decoders) / sizeof(_decoders[0]); n++) {
+    if (_decoders[n].uuid == uuid) {
+      int level = _decoders[n].decode(data, length);
+
+      if (level < 0 || level > 100)
+        return -1;
+      _advertised++;
+      return level;
+    }
+  }
+  return -1;
+}
+
+/*
+   take the battery level out of a decoded sensor frame, like BTHome
+*/
+int BatteryDecodeFrame(const ADVDECODE_T *frame)
+{
+  if (frame->type != ADVDECODE_SENSOR || !(frame->sensor.present & (1 << ADVDECODE_METRIC_BATTERY)))
+    return -1;
+
+  int level = frame->sensor.value[ADVDECODE_METRIC_BATTERY];
+
+  if (level < 0 || level > 100)
+    return -1;
+  _advertised++;
+  return level;
+}
+
+/*
+   the stack is about to be re-initialized -- stop the worker and release all clients
+
+   return false as long as a client is still in use, the stack must not be
+   re-initialized then -- the call is repeated until it returns true
+*/
+bool BatteryReset(void)
+{
+  static unsigned long _started = 0;
+  static bool _logged = false;
+  bool busy = false;
+
+  if (!_stopping) {
+    _stopping = true;
+    _started = millis();
+    _logged = false;
+  }
+
+  /*
+     the worker has to leave its client before the stack deletes it --
+     disconnecting lets the blocking reads return early
+  */
+  for (int n = 0; n < BATTERY_CONNECTIONS_MAX; n++) {
+    BATTERY_SLOT_T *slot = &_slots[n];
+
+    if (slot->state == BATTERY_SLOT_CONNECTING && !slot->client->cancelConnect())
+      BatterySlotSwitch(slot, BATTERY_SLOT_CONNECTING, BATTERY_SLOT_CLOSED);
+    if (slot->state == BATTERY_SLOT_CONNECTED || slot->state == BATTERY_SLOT_WORKING)
+      slot->client->disconnect();
+    if (slot->state == BATTERY_SLOT_CONNECTING || slot->state == BATTERY_SLOT_CONNECTED || slot->state == BATTERY_SLOT_WORKING)
+      busy = true;
+  }
+  if (busy) {
+    if (!_logged && millis() - _started > BATTERY_RESET_TIMEOUT) {
+      LogMsg("BATTERY: a connection is still in use -- the re-initialization is deferred");
+      _logged = true;
+    }
+    return false;
+  }
+
+  /*
+     the worker acknowledged by closing all slots
+  */
+  for (int n = 0; n < BATTERY_CONNECTIONS_MAX; n++) {
+    if (_slots[n].state != BATTERY_SLOT_FREE)
+      BatteryClose(&_slots[n]);
+    _slots[n].device = NULL;
+    _slots[n].client = NULL;
+  }
+  _stopping = false;
+  return true;
+}
+
+/*
+   a deferred re-initialization isn't needed anymore -- the worker goes on
+*/
+void BatteryResume(void)
+{
+  _stopping = false;
+}
+
+/*
+   get some stats
+*/
+void BatteryStats(unsigned long *advertised, unsigned long *checks, unsigned long *failures, unsigned long *enriched, int *queued)
+{
+  *enriched = _enriched;
+  *advertised = _advertised;
+  *checks = _checks;
+  *failures = _failures;
+  *queued = _queue_count;
+}/**/
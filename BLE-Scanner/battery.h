@@ -0,0 +1,138 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to read the battery level and the device information of devices
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __BATTERY_H__
+#define __BATTERY_H__ 1
+
+#include <NimBLEDevice.h>
+#include "config.h"
+#include "scandev.h"
+#include "advdecode.h"
+
+/*
+   maximum number of concurrent connections to read the battery level
+*/
+#define BATTERY_CONNECTIONS_MAX     2
+
+/*
+   number of devices waiting for a battery check
+*/
+#define BATTERY_QUEUE_LENGTH        16
+
+/*
+   timeout to establish a connection in milli seconds
+*/
+#define BATTERY_CONNECT_TIMEOUT     5000
+
+/*
+   connection parameters for a quick one-shot read
+
+   the interval is given in units of 1.25 ms, the supervision timeout in units of 10 ms
+*/
+#define BATTERY_CONN_INTERVAL       12
+#define BATTERY_CONN_LATENCY        0
+#define BATTERY_CONN_TIMEOUT        100
+
+/*
+   time to wait for a pooled client to disconnect in milli seconds
+*/
+#define BATTERY_DISCONNECT_TIMEOUT  2000
+
+/*
+   time after which a re-initialization deferred by the worker is logged in milli seconds
+*/
+#define BATTERY_RESET_TIMEOUT       5000
+
+/*
+   after a failed check, the battery check timeout is doubled up to this number of times
+*/
+#define BATTERY_BACKOFF_MAX         5
+
+/*
+   UUIDs of service data carrying a battery level
+*/
+#define BATTERY_UUID_BATTERY_SERVICE  0x180F    // Bluetooth SIG battery service
+#define BATTERY_UUID_ENVIRONMENTAL    0x181A    // used by the ATC1441 and pvvx firmwares
+#define BATTERY_UUID_XIAOMI           0xFE95    // Xiaomi MiBeacon
+
+/*
+   setup the battery reader
+*/
+void BatterySetup(void);
+
+/*
+   do the cyclic update
+
+   connections are only started while the scan pauses
+*/
+void BatteryUpdate(void);
+
+/*
+   queue a device to read its battery level and/or its device information
+
+   return false if the queue is full
+*/
+bool BatteryRequest(SCANDEV_T *device, bool read_battery, bool read_info);
+
+/*
+   cancel all connections which are not yet established -- called before the scan starts
+*/
+void BatteryCancel(void);
+
+/*
+   decode the battery level out of the service data of an advertisement
+
+   return -1 if the service data doesn't carry a battery level
+*/
+int BatteryDecode(uint16_t uuid, const uint8_t *data, size_t length);
+
+/*
+   take the battery level out of a decoded sensor frame, like BTHome
+
+   return -1 if the frame doesn't carry a battery level
+*/
+int BatteryDecodeFrame(const ADVDECODE_T *frame);
+
+/*
+   the stack is about to be re-initialized -- stop the worker and release all clients
+
+   return false as long as a client is still in use, the stack must not be
+   re-initialized then -- the call is repeated until it returns true
+*/
+bool BatteryReset(void);
+
+/*
+   a deferred re-initialization isn't needed anymore -- the worker goes on
+*/
+void BatteryResume(void);
+
+/*
+   get some stats
+*/
+void BatteryStats(unsigned long *advertised, unsigned long *checks, unsigned long *failures, unsigned long *enriched, int *queued);
+
+#endif
+
+/**/
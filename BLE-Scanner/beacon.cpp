@@ -0,0 +1,417 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to track iBeacons by their UUID, major & minor
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "bluetooth.h"
+#include "mqtt.h"
+#include "beacon.h"
+#include "util.h"
+
+/*
+   beacons rotating their address would flood the device list, so they
+   are kept in a table of their own, keyed by a hash of UUID, major &
+   minor -- the table uses open addressing with linear probing
+*/
+static_assert((BEACON_LENGTH & (BEACON_LENGTH - 1)) == 0, "BEACON_LENGTH has to be a power of two");
+
+typedef struct _beacon {
+  uint32_t hash;                  // hash of the key -- 0 marks an empty slot
+  uint8_t uuid[16];
+  uint16_t major;
+  uint16_t minor;
+  int8_t txpower;
+  int rssi;
+  uint64_t addr;                  // last address used by the beacon
+  unsigned long rotations;        // number of address changes
+  time_t last_seen;
+  time_t last_published;
+  int region;                     // index of the region, or -1
+  volatile bool present;
+  volatile bool publish_presence;
+  bool counted;                   // beacon is counted as present in its region
+} BEACON_T;
+
+static BEACON_T _beacons[BEACON_LENGTH];
+static int _beacon_count = 0;
+static int _beacon_present = 0;
+
+/*
+   the table is changed by the NimBLE task and purged by the loop
+*/
+static portMUX_TYPE _beacon_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/*
+   number of present beacons per region
+*/
+static struct {
+  int count;
+  bool publish;
+} _regions[CONFIG_BEACON_REGIONS];
+
+/*
+   some stats
+*/
+static volatile unsigned long _rotations = 0;
+static volatile unsigned long _dropped = 0;
+
+/*
+   hash the key of a beacon (FNV-1a)
+*/
+static uint32_t BeaconHash(const uint8_t *uuid, uint16_t major, uint16_t minor)
+{
+  uint32_t hash = 2166136261UL;
+
+  for (int n = 0; n < 16; n++)
+    hash = (hash ^ uuid[n]) * 16777619UL;
+  hash = (hash ^ (major >> 8)) * 16777619UL;
+  hash = (hash ^ (major & 0xff)) * 16777619UL;
+  hash = (hash ^ (minor >> 8)) * 16777619UL;
+  hash = (hash ^ (minor & 0xff)) * 16777619UL;
+  return (hash) ? hash : 1;
+}
+
+/*
+   return the region of a UUID, or -1
+*/
+static int BeaconRegion(const uint8_t *uuid)
+{
+  for (int n = 0; n < _config.beacon.regions; n++)
+    if (!memcmp(_config.beacon.region[n], uuid, 16))
+      return n;
+  return -1;
+}
+
+/*
+   convert a UUID into its string form
+*/
+static String BeaconUUID(const uint8_t *uuid)
+{
+  char str[40];
+  int len = 0;
+
+  for (int n = 0; n < 16; n++) {
+    len += sprintf(&str[len], "%02X", uuid[n]);
+    if (n == 3 || n == 5 || n == 7 || n == 9)
+      str[len++] = '-';
+  }
+  return String(str);
+}
+
+/*
+   setup the beacon table
+*/
+void BeaconSetup(void)
+{
+  /*
+     check and correct the config
+  */
+  _config.beacon.enabled = _config.beacon.enabled ? true : false;
+  FIX_RANGE(_config.beacon.regions, 0, CONFIG_BEACON_REGIONS);
+
+  /*
+     the regions might have changed -- count the beacons again
+  */
+  memset(_regions, 0, sizeof(_regions));
+  for (int n = 0; n < BEACON_LENGTH; n++) {
+    BEACON_T *beacon = &_beacons[n];
+
+    if (beacon->hash) {
+      beacon->region = BeaconRegion(beacon->uuid);
+      if (beacon->counted && beacon->region >= 0)
+        _regions[beacon->region].count++;
+    }
+  }
+  for (int n = 0; n < _config.beacon.regions; n++)
+    _regions[n].publish = true;
+
+  LogMsg("BEACON: %s with %d regions", (_config.beacon.enabled) ? "enabled" : "disabled", _config.beacon.regions);
+}
+
+/*
+   take over an iBeacon frame
+
+   NOTE: this is called in the context of the NimBLE task
+*/
+bool BeaconSample(const BLEAddress &addr, int rssi, const ADVDECODE_T *frame)
+{
+  if (!_config.beacon.enabled || frame->type != ADVDECODE_IBEACON)
+    return false;
+
+  uint32_t hash = BeaconHash(frame->ibeacon.uuid, frame->ibeacon.major, frame->ibeacon.minor);
+  uint64_t key = (uint64_t) addr;
+  int slot = hash & (BEACON_LENGTH - 1);
+  time_t t = now();       // might sync the time, so not within the lock
+  BEACON_T *beacon;
+
+  portENTER_CRITICAL(&_beacon_mux);
+  for (;;) {
+    beacon = &_beacons[slot];
+    if (!beacon->hash)
+      break;
+    if (beacon->hash == hash
+        && beacon->major == frame->ibeacon.major && beacon->minor == frame->ibeacon.minor
+        && !memcmp(beacon->uuid, frame->ibeacon.uuid, sizeof(beacon->uuid)))
+      break;
+    slot = (slot + 1) & (BEACON_LENGTH - 1);
+  }
+
+  if (!beacon->hash) {
+    /*
+       a new beacon
+    */
+    if (_beacon_count >= BEACON_LOAD_MAX) {
+      portEXIT_CRITICAL(&_beacon_mux);
+      _dropped++;
+      return true;
+    }
+    memset((void *) beacon, 0, sizeof(BEACON_T));
+    memcpy(beacon->uuid, frame->ibeacon.uuid, sizeof(beacon->uuid));
+    beacon->major = frame->ibeacon.major;
+    beacon->minor = frame->ibeacon.minor;
+    beacon->region = BeaconRegion(beacon->uuid);
+    beacon->addr = key;
+    beacon->hash = hash;
+    _beacon_count++;
+  }
+  else if (beacon->addr != key) {
+    /*
+       the beacon rotated its address
+    */
+    beacon->addr = key;
+    beacon->rotations++;
+    _rotations++;
+  }
+  beacon->txpower = frame->ibeacon.txpower;
+  beacon->rssi = rssi;
+  beacon->last_seen = t;
+  if (!beacon->present) {
+    beacon->present = true;
+    beacon->publish_presence = true;
+  }
+  portEXIT_CRITICAL(&_beacon_mux);
+
+  return true;
+}
+
+/*
+   remove the beacon in the given slot
+
+   the following entries of the probe sequence are moved up, so no
+   tombstones are needed
+*/
+static void BeaconRemove(int slot)
+{
+  int next = slot;
+
+  for (;;) {
+    next = (next + 1) & (BEACON_LENGTH - 1);
+    if (!_beacons[next].hash)
+      break;
+
+    int home = _beacons[next].hash & (BEACON_LENGTH - 1);
+
+    if ((next > slot && (home <= slot || home > next)) || (next < slot && home <= slot && home > next)) {
+      _beacons[slot] = _beacons[next];
+      slot = next;
+    }
+  }
+  _beacons[slot].hash = 0;
+  _beacon_count--;
+}
+
+/*
+   publish a beacon
+*/
+static void BeaconPublishMQTT(BEACON_T *beacon)
+{
+  String Key = BeaconUUID(beacon->uuid) + "-" + String(beacon->major) + "-" + String(beacon->minor);
+  String Addr = String(BLEAddress(beacon->addr, BLE_ADDR_RANDOM).toString().c_str());
+
+  Addr.toUpperCase();
+  String json = "\"presence\":\"" + String((beacon->present) ? "present" : "absent") + "\","
+                "\"last_seen\":" + String(beacon->last_seen) + ","
+                "\"Scanner\":\"" + String(_config.device.name) + "\","
+                "\"ScannerCID\":\"" + String(_config.mqtt.clientID) + "\","
+                "\"UUID\":\"" + BeaconUUID(beacon->uuid) + "\","
+                "\"Major\":" + String(beacon->major) + ","
+                "\"Minor\":" + String(beacon->minor) + ","
+                "\"TxPower\":" + String(beacon->txpower) + ","
+                "\"RSSI\":" + String(beacon->rssi) + ","
+                "\"Address\":\"" + Addr + "\","
+                "\"Rotations\":" + String(beacon->rotations);
+
+  MqttPublish("beacon/" + Key, "{" + json + "}");
+  beacon->last_published = now();
+}
+
+/*
+   do the cyclic update -- set beacons absent and publish them & the regions
+*/
+void BeaconUpdate(void)
+{
+  static time_t _last = 0;
+  int absence_timeout = _config.bluetooth.absence_cycles * BluetoothCycleTime();
+
+  if (now() <= _last)
+    return;
+  _last = now();
+
+  _beacon_present = 0;
+  for (int n = 0; n < BEACON_LENGTH; n++) {
+    BEACON_T *beacon = &_beacons[n];
+
+    if (!beacon->hash)
+      continue;
+
+    if (beacon->present && now() - beacon->last_seen > absence_timeout) {
+      /*
+         the beacon is absent
+      */
+      beacon->present = false;
+      beacon->publish_presence = true;
+    }
+    else if (!beacon->present && now() - beacon->last_seen > BEACON_PURGE_TIMEOUT) {
+      /*
+         drop the beacon -- the next entries might move into this slot
+      */
+      portENTER_CRITICAL(&_beacon_mux);
+      if (!beacon->present)
+        BeaconRemove(n--);
+      portEXIT_CRITICAL(&_beacon_mux);
+      continue;
+    }
+
+    if (beacon->present != beacon->counted) {
+      /*
+         update the region incrementally
+      */
+      beacon->counted = beacon->present;
+      if (beacon->region >= 0) {
+        int count = _regions[beacon->region].count += (beacon->present) ? 1 : -1;
+
+        if (count == ((beacon->present) ? 1 : 0))
+          _regions[beacon->region].publish = true;
+      }
+    }
+    if (beacon->present)
+      _beacon_present++;
+
+    if (beacon->publish_presence || (beacon->present && now() - beacon->last_published > _config.mqtt.publish_timeout)) {
+      beacon->publish_presence = false;
+      if (beacon->present || _config.mqtt.publish_absence)
+        BeaconPublishMQTT(beacon);
+    }
+  }
+
+  for (int n = 0; n < _config.beacon.regions; n++) {
+    if (_regions[n].publish) {
+      /*
+         any beacon of this UUID present?
+      */
+      String json = "\"presence\":\"" + String((_regions[n].count) ? "present" : "absent") + "\","
+                    "\"beacons\":" + String(_regions[n].count) + ","
+                    "\"Scanner\":\"" + String(_config.device.name) + "\"";
+
+      MqttPublish("region/" + BeaconUUID(_config.beacon.region[n]), "{" + json + "}");
+      _regions[n].publish = false;
+    }
+  }
+}
+
+/*
+   parse a list of region UUIDs into the configuration
+
+   UUIDs are separated by white spaces, commas or semicolons, dashes are ignored
+
+   return the number of regions taken over
+*/
+int BeaconParseRegions(const char *list)
+{
+  int count = 0;
+
+  while (*list && count < CONFIG_BEACON_REGIONS) {
+    /*
+       skip the separators
+    */
+    while (*list && strchr(" \t\r\n,;", *list))
+      list++;
+
+    /*
+       take over the UUID
+    */
+    int len = strcspn(list, " \t\r\n,;");
+    uint8_t uuid[16];
+    int digits = 0;
+
+    for (int n = 0; n < len && digits < 32; n++) {
+      if (isxdigit(list[n])) {
+        int nibble = isdigit(list[n]) ? list[n] - '0' : toupper(list[n]) - 'A' + 10;
+
+        uuid[digits / 2] = (digits & 1) ? (uuid[digits / 2] << 4) | nibble : nibble;
+        digits++;
+      }
+      else if (list[n] != '-')
+        break;
+    }
+    if (digits == 32)
+      memcpy(_config.beacon.region[count++], uuid, sizeof(uuid));
+    else if (len > 0)
+      LogMsg("BEACON: ignoring invalid UUID %.*s", len, list);
+    list += len;
+  }
+  _config.beacon.regions = count;
+
+#if DBG_BEACON
+  DbgMsg("BEACON: parsed %d regions", count);
+#endif
+  return count;
+}
+
+/*
+   return the regions as a string -- one UUID per line
+*/
+String BeaconRegionsToString(void)
+{
+  String list = "";
+
+  for (int n = 0; n < _config.beacon.regions && n < CONFIG_BEACON_REGIONS; n++)
+    list += BeaconUUID(_config.beacon.region[n]) + "\n";
+  return list;
+}
+
+/*
+   get some stats
+*/
+void BeaconStats(int *beacons, int *present, int *regions, unsigned long *rotations, unsigned long *dropped)
+{
+  *beacons = _beacon_count;
+  *present = _beacon_present;
+  *regions = 0;
+  for (int n = 0; n < _config.beacon.regions; n++)
+    if (_regions[n].count)
+      (*regions)++;
+  *rotations = _rotations;
+  *dropped = _dropped;
+}/**/
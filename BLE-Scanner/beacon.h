@@ -0,0 +1,86 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to track iBeacons by their UUID, major & minor
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __BEACON_H__
+#define __BEACON_H__ 1
+
+#include <NimBLEDevice.h>
+#include "config.h"
+#include "advdecode.h"
+
+/*
+   number of slots of the beacon table -- has to be a power of two
+*/
+#define BEACON_LENGTH               128
+
+/*
+   maximum number of beacons in the table, to keep the probe sequences short
+*/
+#define BEACON_LOAD_MAX             (BEACON_LENGTH * 3 / 4)
+
+/*
+   absent beacons are dropped from the table after this time in seconds
+*/
+#define BEACON_PURGE_TIMEOUT        (60 * 60)
+
+/*
+   setup the beacon table
+*/
+void BeaconSetup(void);
+
+/*
+   take over an iBeacon frame
+
+   NOTE: this is called in the context of the NimBLE task
+
+   return false if beacons are not tracked, so the device is handled as usual
+*/
+bool BeaconSample(const BLEAddress &addr, int rssi, const ADVDECODE_T *frame);
+
+/*
+   do the cyclic update -- set beacons absent and publish them & the regions
+*/
+void BeaconUpdate(void);
+
+/*
+   parse a list of region UUIDs into the configuration
+
+   return the number of regions taken over
+*/
+int BeaconParseRegions(const char *list);
+
+/*
+   return the regions as a string -- one UUID per line
+*/
+String BeaconRegionsToString(void);
+
+/*
+   get some stats
+*/
+void BeaconStats(int *beacons, int *present, int *regions, unsigned long *rotations, unsigned long *dropped);
+
+#endif
+
+/**/
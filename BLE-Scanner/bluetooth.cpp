@@ -29,26 +29,192 @@
 #include "bluetooth.h"
 #include "ble-manufacturer.h"
 #include "scandev.h"
+#include "watchlist.h"
+#include "battery.h"
+#include "scheduler.h"
+#include "resolver.h"
+#include "advdecode.h"
+#include "sensor.h"
+#include "beacon.h"
+#include "presence.h"
+#include "occupancy.h"
 #include "util.h"
+#if defined(ESP32)
+#include <esp_bt.h>
+#endif
 
 static NimBLEScan *_scan = NULL;
 static time_t _last_scan = 0;
 static time_t _last_activescan = 0;
 
+/*
+   the scan profiles
+*/
+static const BLUETOOTH_PROFILE_T _profiles[BLUETOOTH_PROFILES] = {
+  /*
+     almost continuous scanning with the classic settings
+  */
+  { "default",      "Default",              3000, 2999, CONFIG_BTDM_SCAN_DUPL_TYPE_DEVICE,        200, BLUETOOTH_ACTIVESCAN_TIMEOUT },
+
+  /*
+     many devices around -- a large duplicate cache keeps the host quiet
+  */
+  { "dense",        "Dense Venue",          1000,  500, CONFIG_BTDM_SCAN_DUPL_TYPE_DEVICE,       1000, BLUETOOTH_ACTIVESCAN_NEVER },
+
+  /*
+     short intervals and report data changes to catch arrivals fast
+  */
+  { "lowlatency",   "Low-Latency Presence",  100,  100, CONFIG_BTDM_SCAN_DUPL_TYPE_DATA_DEVICE,   500, BLUETOOTH_ACTIVESCAN_TIMEOUT },
+
+  /*
+     leave enough air time for the WiFi which shares the radio
+  */
+  { "wififriendly", "WiFi-Friendly",         300,   60, CONFIG_BTDM_SCAN_DUPL_TYPE_DEVICE,        200, BLUETOOTH_ACTIVESCAN_NEVER },
+};
+
+/*
+   the selected profile and the profile the controller was initialized with
+*/
+static int _profile = BLUETOOTH_PROFILE_DEFAULT;
+static int _profile_controller = -1;
+
+/*
+   the running scan is an active scan
+*/
+static bool _scan_active = false;
+
+/*
+   the scan is stopped by us, not by the end of the scan duration
+*/
+static volatile bool _scan_stopping = false;
+
+/*
+   the scan started with an active burst to resolve names,
+   after the burst the scan continues passively for the remaining time
+*/
+static volatile bool _scan_burst = false;
+static volatile bool _scan_burst_ended = false;
+static unsigned long _scan_remaining = 0;
+
+/*
+   scan coverage -- share of the time spent scanning during the last hour
+*/
+static unsigned long _scan_started = 0;
+static volatile unsigned long _scan_ended = 0;
+static unsigned long _coverage_start = 0;
+static unsigned long _coverage_scan = 0;
+static int _coverage = -1;
+
+/*
+   some scan statistics
+*/
+static volatile unsigned long _adverts_total = 0;
+static volatile unsigned long _adverts_filtered = 0;
+static volatile unsigned long _adverts_public = 0;
+static unsigned long _adverts_scan = 0;
+static unsigned long _adverts_public_scan = 0;
+static unsigned long _adverts_rate = 0;
+
+/*
+   statistics per scan profile
+*/
+static struct {
+  unsigned long adverts;    // scan results of public devices
+  unsigned long unique;     // number of different devices per scan
+  unsigned long seconds;    // duration of the scans
+} _profile_stats[BLUETOOTH_PROFILES];
+
 class BLEScannerScanCallbacks : public NimBLEScanCallbacks
 {
     void onResult(const BLEAdvertisedDevice* advertisedDevice)
     {
+      _adverts_total++;
+
+      /*
+         if the controller doesn't filter the watchlist, we have to do it
+      */
+      if (WatchlistEnabled() && !WatchlistControllerFiltering() && !WatchlistContains(advertisedDevice->getAddress())) {
+        _adverts_filtered++;
+        return;
+      }
+
 #if DBG_BT
       DbgMsg("BLE: found advertised device: %s  address type: 0x%02x", advertisedDevice->getAddress().toString().c_str(), advertisedDevice->getAddressType());
       if (advertisedDevice->getAppearance())
         DbgMsg("BLE: found advertised device: %s  appearance: 0x%02x", advertisedDevice->getAddress().toString().c_str(), advertisedDevice->getAppearance());
 #endif
 
+      /*
+         known devices sending the same payload as before take the fast path
+      */
+      uint32_t fingerprint = 0;
+
+      if (advertisedDevice->getAddressType() == BLE_ADDR_PUBLIC) {
+        const std::vector<uint8_t> &payload = advertisedDevice->getPayload();
+
+        fingerprint = ScanDevFingerprint(payload.data(), payload.size());
+        if (ScanDevSeen(advertisedDevice->getAddress(), fingerprint, advertisedDevice->getRSSI())) {
+          _adverts_public++;
+          return;
+        }
+      }
+
+      /*
+         check the service data for an advertised battery level
+      */
+      int battery_level = -1;
+      ADVDECODE_T frame;
+
+      memset(&frame, 0, sizeof(frame));
+      for (int n = 0; n < advertisedDevice->getServiceDataCount(); n++) {
+        NimBLEUUID uuid = advertisedDevice->getServiceDataUUID(n);
+
+        if (uuid.bitSize() == 16) {
+          std::string data = advertisedDevice->getServiceData(n);
+          const uint8_t *value = uuid.getValue();
+          uint16_t id = value[0] | (value[1] << 8);
+
+          if (battery_level < 0)
+            battery_level = BatteryDecode(id, (const uint8_t *) data.data(), data.length());
+          if (frame.type == ADVDECODE_NONE)
+            AdvDecode(ADVDECODE_SERVICE, id, (const uint8_t *) data.data(), data.length(), &frame);
+        }
+      }
+
+      /*
+         decode the manufacturer data of well known frames
+      */
+      for (int n = 0; n < advertisedDevice->getManufacturerDataCount() && frame.type == ADVDECODE_NONE; n++) {
+        std::string data = advertisedDevice->getManufacturerData(n);
+
+        if (data.length() >= 2)
+          AdvDecode(ADVDECODE_MANUFACTURER, (uint8_t) data[0] | ((uint8_t) data[1] << 8), (const uint8_t *) data.data(), data.length(), &frame);
+      }
+
+      /*
+         a sensor frame might carry the battery level
+      */
+      if (battery_level < 0 && frame.type == ADVDECODE_SENSOR)
+        battery_level = BatteryDecodeFrame(&frame);
+
+      /*
+         sensor tags mostly use random addresses, so their values are taken before the address filter
+      */
+      if (frame.type == ADVDECODE_SENSOR)
+        SensorSample(advertisedDevice->getAddress(), &frame);
+
+      /*
+         iBeacons are tracked by UUID, major & minor, as they might rotate their address
+      */
+      if (frame.type == ADVDECODE_IBEACON && BeaconSample(advertisedDevice->getAddress(), advertisedDevice->getRSSI(), &frame))
+        return;
+
       /*
          we only put devices onto the list, which don't use random addresses
       */
       if (advertisedDevice->getAddressType() == BLE_ADDR_PUBLIC) {
+        _adverts_public++;
+
         /*
            check the service UUIDs
         */
@@ -70,12 +236,128 @@ class BLEScannerScanCallbacks : public NimBLEScanCallbacks
                    advertisedDevice->getName().c_str(),
                    manufacturer_id,
                    advertisedDevice->getRSSI(),
-                   hasBatteryService);
+                   hasBatteryService,
+                   battery_level,
+                   advertisedDevice->isConnectable(),
+                   advertisedDevice->isScannable(),
+                   &frame,
+                   fingerprint);
 
       }
     }
+
+    void onScanEnd(const NimBLEScanResults& results, int reason)
+    {
+#if DBG_BT
+      DbgMsg("BLE: scan ended with reason %d", reason);
+#endif
+      /*
+         let the state maschine move on right away
+      */
+      if (_scan_stopping)
+        return;
+      if (_scan_burst) {
+        /*
+           the loop will continue with the passive scan
+        */
+        _scan_burst = false;
+        _scan_burst_ended = true;
+        return;
+      }
+      _scan_ended = millis();
+      StateSignal(STATE_SCANNING);
+    }
 };
 
+static BLEScannerScanCallbacks _scan_callbacks;
+
+/*
+   (re-)initialize the controller for the selected profile
+
+   the duplicate filter settings are taken over by the controller
+   only during the initialization
+*/
+static void BluetoothInit(void)
+{
+  const BLUETOOTH_PROFILE_T *profile = &_profiles[_profile];
+
+  if (NimBLEDevice::isInitialized()) {
+    if (_profile_controller < 0
+        || (_profiles[_profile_controller].dupl_mode == profile->dupl_mode
+            && _profiles[_profile_controller].dupl_cache == profile->dupl_cache)) {
+      _profile_controller = _profile;
+      return;
+    }
+    /*
+       the battery reader has to release its clients before the stack deletes them --
+       until then the controller keeps the current profile, and the next scan tries again
+    */
+    if (!BatteryReset())
+      return;
+    LogMsg("BLE: re-initializing the controller for scan profile %s", profile->name);
+    NimBLEDevice::deinit(true);
+    _scan = NULL;
+    WatchlistReset();
+  }
+
+#if DBG_BT
+  DbgMsg("BLE: init ...");
+#endif
+  NimBLEDevice::setScanFilterMode(profile->dupl_mode);
+  NimBLEDevice::setScanDuplicateCacheSize(profile->dupl_cache);
+
+  /*
+     init the device
+  */
+  NimBLEDevice::init(__TITLE__);
+  _profile_controller = _profile;
+
+  /*
+     create a scan
+  */
+#if DBG_BT
+  DbgMsg("BLE: create a scan ...");
+#endif
+  if (!(_scan = NimBLEDevice::getScan())) {
+    LogMsg("BLE: NimBLEDevice::getScan() failed");
+    return;
+  }
+  /*
+     duplicates are filtered by the controller as configured by the profile
+  */
+  _scan->setScanCallbacks(&_scan_callbacks, false);
+}
+
+/*
+   book the time spent scanning for the scan coverage
+*/
+static void BluetoothCoverageBook(unsigned long scan_end)
+{
+  unsigned long now = millis();
+
+  if (_scan_started) {
+    _coverage_scan += ((scan_end) ? scan_end : now) - _scan_started;
+    _scan_started = 0;
+  }
+  if (!_coverage_start)
+    _coverage_start = now;
+  if (now - _coverage_start >= SECS_PER_HOUR * 1000UL) {
+    _coverage = (_coverage_scan * 100) / (now - _coverage_start);
+    _coverage_start = now;
+    _coverage_scan = 0;
+  }
+}
+
+/*
+   stop the scan -- but don't signal its end
+*/
+static void BluetoothStop(void)
+{
+  _scan_stopping = true;
+  _scan_burst = _scan_burst_ended = false;
+  _scan->stop();
+}
+
 /*
    setup
 */
@@ -88,37 +370,44 @@ void BluetoothSetup(void)
   FIX_RANGE(_config.bluetooth.pause_time, BLUETOOTH_PAUSE_TIME_MIN, BLUETOOTH_PAUSE_TIME_MAX);
   FIX_RANGE(_config.bluetooth.activescan_timeout, BLUETOOTH_ACTIVESCAN_TIMEOUT_MIN, BLUETOOTH_ACTIVESCAN_TIMEOUT_MAX);
   FIX_RANGE(_config.bluetooth.absence_cycles, BLUETOOTH_ABSENCE_CYCLES_MIN, BLUETOOTH_ABSENCE_CYCLES_MAX);
+  _config.bluetooth.learn_absence = _config.bluetooth.learn_absence ? true : false;
+  if (!_config.bluetooth.absence_target)
+    _config.bluetooth.absence_target = BLUETOOTH_ABSENCE_TARGET_DEFAULT;
+  FIX_RANGE(_config.bluetooth.absence_target, BLUETOOTH_ABSENCE_TARGET_MIN, BLUETOOTH_ABSENCE_TARGET_MAX);
+  _config.bluetooth.presence_score = _config.bluetooth.presence_score ? true : false;
+  if (!_config.bluetooth.presence_enter) {
+    _config.bluetooth.presence_enter = PRESENCE_ENTER_DEFAULT;
+    _config.bluetooth.presence_leave = PRESENCE_LEAVE_DEFAULT;
+  }
+  FIX_RANGE(_config.bluetooth.presence_leave, 0, _config.bluetooth.presence_enter - 1);
+
+  FIX_RANGE(_config.bluetooth.profile, 0, BLUETOOTH_PROFILES - 1);
+  _config.bluetooth.continuous = _config.bluetooth.continuous ? true : false;
+  FIX_RANGE(_config.bluetooth.cycle_time, BLUETOOTH_CYCLE_TIME_MIN, BLUETOOTH_CYCLE_TIME_MAX);
 
   /*
      set the timeout values in the status table
   */
   LogMsg("BLE: setting up timout values in the status table");
-  StateModifyTimeout(STATE_SCANNING, (_config.bluetooth.scan_time + 5) * 1000);
-  StateModifyTimeout(STATE_PAUSING, _config.bluetooth.pause_time * 1000);
-
-#if DBG_BT
-  DbgMsg("BLE: init ...");
-#endif
-
-  NimBLEDevice::setScanFilterMode(CONFIG_BTDM_SCAN_DUPL_TYPE_DEVICE);
-  NimBLEDevice::setScanDuplicateCacheSize(200);
+  SchedulerSetup();
+  if (_config.bluetooth.continuous) {
+    /*
+       the scan keeps running, the state maschine only marks the virtual cycles
+    */
+    StateModifyTimeout(STATE_SCANNING, _config.bluetooth.cycle_time * 1000);
+    StateModifyTimeout(STATE_PAUSING, 0);
+  }
 
   /*
-     init the device
+     load the watchlist
   */
-  if (!NimBLEDevice::isInitialized())
-    NimBLEDevice::init(__TITLE__);
+  WatchlistSetup();
 
   /*
-     create a scan
+     init the controller
   */
-#if DBG_BT
-  DbgMsg("BLE: create a scan ...");
-#endif
-  if (!_scan && !(_scan = NimBLEDevice::getScan())) {
-    LogMsg("BLE: NimBLEDevice::getScan() failed");
-  }
-  _scan->setScanCallbacks(new BLEScannerScanCallbacks(), false);
+  _profile = _config.bluetooth.profile;
+  BluetoothInit();
 }
 
 /*
@@ -126,6 +415,19 @@ void BluetoothSetup(void)
 */
 void BluetoothUpdate(void)
 {
+  if (_scan_burst_ended) {
+    /*
+       the active burst is over -- continue passively for the rest of the scan
+    */
+    _scan_burst_ended = false;
+    if (_scan && StateCheck(STATE_SCANNING)) {
+#if DBG_BT
+      DbgMsg("BLE: burst ended, continue passive scan for %lu ms ...", _scan_remaining);
+#endif
+      _scan->setActiveScan(_scan_active = false);
+      _scan->start(_scan_remaining, true);
+    }
+  }
 }
 
 /*
@@ -137,29 +439,95 @@ bool BluetoothScanStart(void)
   DbgMsg("BLE: BluetoothScanStart");
 #endif
 
+  const BLUETOOTH_PROFILE_T *profile = &_profiles[_profile];
+
   /*
     active/passive scan
   */
   bool active = false;
 
-  if (now() - _last_activescan > _config.bluetooth.activescan_timeout) {
-    active = true;
-    _last_activescan = now();
+  switch (profile->activescan) {
+    case BLUETOOTH_ACTIVESCAN_ALWAYS:
+      active = true;
+      break;
+    case BLUETOOTH_ACTIVESCAN_TIMEOUT:
+      if (now() - _last_activescan > _config.bluetooth.activescan_timeout) {
+        active = true;
+        _last_activescan = now();
+      }
+      break;
   }
-  _scan->setActiveScan(active);
-
-  int scan_interval = 3000; // ms
-  _scan->setInterval(scan_interval);
-  _scan->setWindow(scan_interval - 1);
 
   /*
-     start the scan
+     if there are devices without a name, start with a short active burst
   */
+  unsigned long scan_time = (_config.bluetooth.continuous) ? 0 : SchedulerScanTime() * 1000;
+  bool burst = false;
+
+  if (!active && profile->activescan != BLUETOOTH_ACTIVESCAN_NEVER && ResolverPending()) {
+    ResolverBurst();
+    active = true;
+    burst = !scan_time || scan_time > RESOLVER_BURST_TIME * 1000;
+  }
+
+  if (_config.bluetooth.continuous && _scan && _scan->isScanning() && !burst
+      && _profile == _profile_controller && active == _scan_active && !WatchlistChanged()) {
+    /*
+       in continuous mode the scan keeps running -- this is just a new virtual cycle
+    */
 #if DBG_BT
-  DbgMsg("BLE: start %s scan for %d seconds ...", (active) ? "active" : "passive", _config.bluetooth.scan_time);
+    DbgMsg("BLE: continuing %s scan with profile %s ...", (active) ? "active" : "passive", profile->name);
 #endif
-  _scan->start(_config.bluetooth.scan_time * 1000, false);
+  }
+  else {
+    /*
+       take over a changed scan profile
+    */
+    if (_scan && _scan->isScanning()) {
+      BluetoothStop();
+      BluetoothCoverageBook(0);
+    }
+    if (_profile != _profile_controller)
+      BluetoothInit();
+    else
+      BatteryResume();
+    if (!_scan)
+      return false;
+
+    _scan->setActiveScan(_scan_active = active);
+    _scan->setInterval(profile->interval);
+    _scan->setWindow(profile->window);
+
+    /*
+       in continuous mode the results are only streamed via the callback,
+       so NimBLE doesn't keep them
+    */
+    _scan->setMaxResults((_config.bluetooth.continuous) ? 0 : 0xff);
+
+    /*
+       let the controller drop all devices which are not on the watchlist
+    */
+    WatchlistApply(_scan);
+
+    /*
+       start the scan
+    */
+#if DBG_BT
+    DbgMsg("BLE: start %s scan for %lu ms with profile %s ...", (burst) ? "burst" : (active) ? "active" : "passive",
+           (burst) ? RESOLVER_BURST_TIME * 1000 : scan_time, profile->name);
+#endif
+    _scan_stopping = false;
+    _scan_ended = 0;
+    _scan_burst = burst;
+    _scan_burst_ended = false;
+    _scan_remaining = (burst && scan_time) ? scan_time - RESOLVER_BURST_TIME * 1000 : scan_time;
+    _scan->start((burst) ? RESOLVER_BURST_TIME * 1000 : scan_time, false);
+  }
+  if (!_scan_started)
+    _scan_started = millis();
   _last_scan = now();
+  _adverts_scan = _adverts_total;
+  _adverts_public_scan = _adverts_public;
 
   return true;
 }
@@ -172,82 +540,140 @@ bool BluetoothScanStop(void)
 #if DBG_BT
   DbgMsg("BLE: BluetoothScanStop");
 #endif
-  _scan->stop();
-  _scan->clearResults();
+  if (!_scan)
+    return false;
+
+  if (_config.bluetooth.continuous && _scan->isScanning()) {
+    /*
+       keep the scan running, but let the controller report
+       all devices again in the next virtual cycle
+    */
+#if defined(ESP32)
+    esp_ble_scan_dupilcate_list_flush();
+#endif
+    BluetoothCoverageBook(0);
+  }
+  else {
+    BluetoothStop();
+    _scan->clearResults();
+    BluetoothCoverageBook(_scan_ended);
+  }
+
+  /*
+     compute the rate of scan results during the last scan
+  */
+  if (now() > _last_scan) {
+    _adverts_rate = (_adverts_total - _adverts_scan) / (now() - _last_scan);
+
+    /*
+       book the scan on the profile which was used
+    */
+    _profile_stats[_profile_controller].adverts += _adverts_public - _adverts_public_scan;
+    _profile_stats[_profile_controller].unique += ScanDevCountSeen(_last_scan);
+    _profile_stats[_profile_controller].seconds += now() - _last_scan;
+
+    /*
+       learn which devices were detected during this cycle
+    */
+    ScanDevCycle(_last_scan);
+
+    /*
+       publish the number of present devices
+    */
+    OccupancyPublish();
+  }
 
   return true;
 }
 
 /*
-   callback class to connect to the device
+   return the length of a scan cycle in seconds
+
+   in continuous mode this is the virtual cycle length
 */
-class BLEScannerClientCallbacks : public NimBLEClientCallbacks {
-    void onConnect(NimBLEClient *client) {
-    }
-    void onDisconnect(NimBLEClient* pclient, int reason) {
-    }
-};
+unsigned long BluetoothCycleTime(void)
+{
+  return (_config.bluetooth.continuous) ? _config.bluetooth.cycle_time : SchedulerScanTime() + SchedulerPauseTime();
+}
 
 /*
-   get the charactersitics from the battery service
+   get some stats
 */
-bool BluetoothBatteryCheck(BLEAddress device, uint8_t *battery_level)
+void BluetoothStats(unsigned long *adverts_total, unsigned long *adverts_filtered, unsigned long *adverts_rate)
 {
-#if DBG_BT
-  DbgMsg("BLE: create a client ...");
-#endif
-  NimBLEClient *client = NimBLEDevice::createClient();
+  *adverts_total = _adverts_total;
+  *adverts_filtered = _adverts_filtered;
+  *adverts_rate = _adverts_rate;
+}
 
-#if DBG_BT
-  DbgMsg("BLE: connect device %s ...", device.toString().c_str());
-#endif
-  client->setClientCallbacks(new BLEScannerClientCallbacks());
-  if (!client->connect(device)) {
-    LogMsg("BLE: couldn't connect to client device %s to read battery level", device.toString().c_str());
-    return false;
-  }
+/*
+   get the stats of a scan profile
 
-  /*
-     select the service
-  */
-#if DBG_BT
-  DbgMsg("BLE: create remote service for battery service ...");
-#endif
-  NimBLERemoteService *service = client->getService(BLEBatteryService);
+   the rate is the number of scan results per second, the duplicate ratio in percent
+*/
+void BluetoothProfileStats(int profile, unsigned long *adverts_rate, int *dupl_ratio)
+{
+  profile = CHECK_RANGE(profile, 0, BLUETOOTH_PROFILES - 1);
 
-  if (!service) {
-    LogMsg("BLE: couldn't create service for client device %s to read battery level", device.toString().c_str());
-    client->disconnect();
-    return false;
-  }
+  *adverts_rate = (_profile_stats[profile].seconds) ? _profile_stats[profile].adverts / _profile_stats[profile].seconds : 0;
+  *dupl_ratio = (_profile_stats[profile].adverts > _profile_stats[profile].unique)
+                ? 100 - (_profile_stats[profile].unique * 100) / _profile_stats[profile].adverts : 0;
+}
 
-  /*
-     get the characteristic
-  */
-#if DBG_BT
-  DbgMsg("BLE: get characteristics ...");
-#endif
-  NimBLERemoteCharacteristic *characteristic = service->getCharacteristic(BLEBatteryCharacteristics);
+/*
+   return a scan profile
+*/
+const BLUETOOTH_PROFILE_T *BluetoothProfile(int profile)
+{
+  return &_profiles[CHECK_RANGE(profile, 0, BLUETOOTH_PROFILES - 1)];
+}
 
-  if (!characteristic) {
-    LogMsg("BLE: couldn't create characteristics for client device %s to read battery level", device.toString().c_str());
-    client->disconnect();
-    return false;
-  }
-  if (characteristic->canRead() && battery_level) {
-#if DBG_BT
-    DbgMsg("BLE: reading characteristic");
-#endif
-    *battery_level = characteristic->readValue<uint8_t>();
-#if DBG_BT
-    DbgMsg("BLE: characteristic value=%u", *battery_level);
-#endif
+/*
+   return the current scan profile
+*/
+int BluetoothProfileCurrent(void)
+{
+  return _profile;
+}
+
+/*
+   select the scan profile by its name -- will be active with the next scan
+*/
+bool BluetoothProfileSelect(const char *name)
+{
+  for (int n = 0; n < BLUETOOTH_PROFILES; n++) {
+    if (!strcasecmp(_profiles[n].name, name)) {
+      LogMsg("BLE: selecting scan profile %s", _profiles[n].name);
+      _profile = n;
+      return true;
+    }
   }
+  LogMsg("BLE: unknown scan profile %s", name);
+  return false;
+}
 
-#if DBG_BT
-  DbgMsg("BLE: disconnecting device");
-#endif
-  client->disconnect();
+/*
+   return the bluetooth status as JSON members
+*/
+String BluetoothStatus(void)
+{
+  unsigned long adverts_rate;
+  int dupl_ratio;
 
-  return true;
+  BluetoothProfileStats(_profile, &adverts_rate, &dupl_ratio);
+
+  return "\"Profile\":\"" + String(_profiles[_profile].name) + "\","
+         "\"AdvertsRate\":" + String(adverts_rate) + ","
+         "\"DuplicateRatio\":" + String(dupl_ratio) + ","
+         "\"Coverage\":" + String(_coverage);
+}
+
+/*
+   return the share of the time spent scanning during the last hour in percent
+
+   returns -1 if there was no complete hour yet
+*/
+int BluetoothCoverage(void)
+{
+  return _coverage;
 }/**/
@@ -42,6 +42,50 @@
 #define BLUETOOTH_ABSENCE_CYCLES_MAX          10
 #define BLUETOOTH_BATTCHECK_TIMEOUT_MIN       60            // seconds
 #define BLUETOOTH_BATTCHECK_TIMEOUT_MAX       (24 * 60 * 60)
+#define BLUETOOTH_CYCLE_TIME_MIN              10            // seconds
+#define BLUETOOTH_CYCLE_TIME_MAX              (10 * 60)
+#define BLUETOOTH_ENRICH_TTL_MIN              (60 * 60)     // seconds
+#define BLUETOOTH_ENRICH_TTL_MAX              (30 * 24 * 60 * 60)
+#define BLUETOOTH_ENRICH_TTL_DEFAULT          (7 * 24 * 60 * 60)
+#define BLUETOOTH_CONNECT_BUDGET_MIN          1             // connections per minute
+#define BLUETOOTH_CONNECT_BUDGET_MAX          60
+#define BLUETOOTH_CONNECT_BUDGET_DEFAULT      6
+#define BLUETOOTH_ABSENCE_TARGET_MIN          1             // 0.1 %
+#define BLUETOOTH_ABSENCE_TARGET_MAX          100
+#define BLUETOOTH_ABSENCE_TARGET_DEFAULT      10
+
+/*
+    scan profiles
+*/
+enum BLUETOOTH_PROFILE {
+  BLUETOOTH_PROFILE_DEFAULT = 0,
+  BLUETOOTH_PROFILE_DENSE,
+  BLUETOOTH_PROFILE_LOWLATENCY,
+  BLUETOOTH_PROFILE_WIFIFRIENDLY,
+  BLUETOOTH_PROFILES
+};
+
+/*
+    active scan cadence of a profile
+*/
+enum BLUETOOTH_ACTIVESCAN {
+  BLUETOOTH_ACTIVESCAN_TIMEOUT = 0,   // active scan after the configured timeout
+  BLUETOOTH_ACTIVESCAN_NEVER,         // only passive scans
+  BLUETOOTH_ACTIVESCAN_ALWAYS,        // only active scans
+};
+
+/*
+    parameters of a scan profile
+*/
+typedef struct _bluetooth_profile {
+  const char *name;           // short name used via MQTT
+  const char *title;          // name shown in the web frontend
+  uint16_t interval;          // scan interval in ms
+  uint16_t window;            // scan window in ms
+  uint8_t dupl_mode;          // duplicate filter of the controller (device or data change)
+  uint16_t dupl_cache;        // size of the duplicate cache of the controller
+  int activescan;             // active scan cadence
+} BLUETOOTH_PROFILE_T;
 
 
 /*
@@ -68,9 +112,52 @@ bool BluetoothScanStart(void);
 bool BluetoothScanStop(void);
 
 /*
-   get battery level
+   return the length of a scan cycle in seconds
+
+   in continuous mode this is the virtual cycle length
+*/
+unsigned long BluetoothCycleTime(void);
+
+/*
+   get some stats
+
+   the rate is the number of scan results per second during the last scan
+*/
+void BluetoothStats(unsigned long *adverts_total, unsigned long *adverts_filtered, unsigned long *adverts_rate);
+
+/*
+   get the stats of a scan profile
+
+   the rate is the number of scan results per second, the duplicate ratio in percent
+*/
+void BluetoothProfileStats(int profile, unsigned long *adverts_rate, int *dupl_ratio);
+
+/*
+   return a scan profile
+*/
+const BLUETOOTH_PROFILE_T *BluetoothProfile(int profile);
+
+/*
+   return the current scan profile
+*/
+int BluetoothProfileCurrent(void);
+
+/*
+   select the scan profile by its name -- will be active with the next scan
+*/
+bool BluetoothProfileSelect(const char *name);
+
+/*
+   return the bluetooth status as JSON members
+*/
+String BluetoothStatus(void);
+
+/*
+   return the share of the time spent scanning during the last hour in percent
+
+   returns -1 if there was no complete hour yet
 */
-bool BluetoothBatteryCheck(BLEAddress device, uint8_t *battery_level);
+int BluetoothCoverage(void);
 
 #endif
 
@@ -0,0 +1,314 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  claims to elect one scanner publishing a device, out of several scanners
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+#include <stdlib.h>
+#include "claim.h"
+
+static_assert((CLAIM_LENGTH & (CLAIM_LENGTH - 1)) == 0, "CLAIM_LENGTH has to be a power of two");
+
+/*
+   the map uses open addressing with linear probing, keyed by the address
+*/
+static int ClaimSlot(uint64_t addr)
+{
+  return (int) ((addr ^ (addr >> 17) ^ (addr >> 31)) & (CLAIM_LENGTH - 1));
+}
+
+/*
+   find a device -- optionally add it, as long as the map isn't filled up to its capacity
+*/
+static CLAIM_T *ClaimFind(CLAIM_MAP_T *map, uint64_t addr, bool add)
+{
+  int slot = ClaimSlot(addr);
+
+  while (map->claims[slot].addr) {
+    if (map->claims[slot].addr == addr)
+      return &map->claims[slot];
+    slot = (slot + 1) & (CLAIM_LENGTH - 1);
+  }
+  if (!add)
+    return NULL;
+  if (map->count >= CLAIM_CAPACITY) {
+    map->dropped++;
+    return NULL;
+  }
+  memset(&map->claims[slot], 0, sizeof(CLAIM_T));
+  map->claims[slot].addr = addr;
+  map->count++;
+  return &map->claims[slot];
+}
+
+/*
+   remove a device -- the following entries of the cluster are shifted back
+*/
+static void ClaimRemove(CLAIM_MAP_T *map, CLAIM_T *claim)
+{
+  int hole = claim - map->claims;
+  int slot = hole;
+
+  for (;;) {
+    slot = (slot + 1) & (CLAIM_LENGTH - 1);
+    if (!map->claims[slot].addr)
+      break;
+
+    int home = ClaimSlot(map->claims[slot].addr);
+
+    if (((slot - home) & (CLAIM_LENGTH - 1)) >= ((slot - hole) & (CLAIM_LENGTH - 1))) {
+      map->claims[hole] = map->claims[slot];
+      hole = slot;
+    }
+  }
+  map->claims[hole].addr = 0;
+  map->count--;
+}
+
+/*
+   the age of a time in seconds modulo 2^16
+*/
+static inline int ClaimAge(uint16_t time, uint32_t now)
+{
+  return (uint16_t) (now - time);
+}
+
+/*
+   the owner stopped claiming the device
+*/
+static inline bool ClaimStale(const CLAIM_MAP_T *map, const CLAIM_T *claim, uint32_t now)
+{
+  return !claim->owner || ClaimAge(claim->updated, now) > map->timeout;
+}
+
+/*
+   decide between two concurrent claims
+*/
+static inline bool ClaimBeats(int rssi, uint32_t id, int other_rssi, uint32_t other_id)
+{
+  return rssi > other_rssi || (rssi == other_rssi && id > other_id);
+}
+
+/*
+   queue a claim
+*/
+static void ClaimQueue(CLAIM_MAP_T *map, uint64_t addr, int rssi, uint8_t flags)
+{
+  if (map->length + CLAIM_ENTRY_LENGTH > CLAIM_MESSAGE_LENGTH)
+    ClaimFlush(map);
+
+  uint8_t *entry = map->message + map->length;
+
+  for (int n = 0; n < 6; n++)
+    entry[n] = addr >> (40 - 8 * n);
+  entry[6] = (uint8_t) (int8_t) rssi;
+  entry[7] = flags;
+  map->length += CLAIM_ENTRY_LENGTH;
+  map->claims_sent++;
+}
+
+/*
+   setup an empty map
+*/
+void ClaimInit(CLAIM_MAP_T *map, uint32_t self, int hysteresis, int dwell, int timeout, void (*send)(const uint8_t *message, size_t length))
+{
+  memset(map, 0, sizeof(CLAIM_MAP_T));
+  map->self = self;
+  map->hysteresis = hysteresis;
+  map->dwell = (dwell > 0) ? dwell : 1;
+  map->timeout = timeout;
+  map->send = send;
+  map->message[0] = CLAIM_VERSION;
+  for (int n = 0; n < 4; n++)
+    map->message[1 + n] = self >> (24 - 8 * n);
+  map->length = CLAIM_HEADER_LENGTH;
+}
+
+/*
+   check the claim of a device we see
+*/
+bool ClaimDevice(CLAIM_MAP_T *map, uint64_t addr, bool present, int rssi, uint32_t now)
+{
+  CLAIM_T *claim = ClaimFind(map, addr, present);
+
+  if (!claim) {
+    /*
+       an unknown absent device, or the map is full -- publish it as without claims
+    */
+    return true;
+  }
+  rssi = (rssi < CLAIM_RSSI_NONE + 1) ? CLAIM_RSSI_NONE + 1 : (rssi > 127) ? 127 : rssi;
+
+  if (claim->owner == map->self) {
+    if (!present) {
+      /*
+         release the device, so another scanner seeing it takes over
+      */
+      ClaimQueue(map, addr, CLAIM_RSSI_NONE, CLAIM_FLAG_REFRESH);
+      ClaimRemove(map, claim);
+      return true;
+    }
+    if (ClaimAge(claim->sent, now) >= map->timeout / 3 || abs(rssi - claim->rssi) >= map->hysteresis) {
+      /*
+         repeat the claim
+      */
+      ClaimQueue(map, addr, rssi, CLAIM_FLAG_REFRESH);
+      claim->rssi = rssi;
+      claim->updated = claim->sent = now;
+    }
+    return true;
+  }
+
+  if (!present)
+    return ClaimStale(map, claim, now);
+
+  /*
+     a device walking between two scanners would change its owner with
+     each fluctuation of the RSSI, so we have to win for the dwell time
+  */
+  if (rssi <= claim->rssi + map->hysteresis)
+    claim->wins = 0;
+  else if (claim->wins < UINT8_MAX)
+    claim->wins++;
+
+  if (ClaimStale(map, claim, now) || claim->wins >= map->dwell) {
+    /*
+       take over the device
+    */
+    ClaimQueue(map, addr, rssi, 0);
+    claim->owner = map->self;
+    claim->wins = 0;
+    claim->rssi = rssi;
+    claim->since = claim->updated = claim->sent = now;
+    map->takeovers++;
+    return true;
+  }
+  return false;
+}
+
+/*
+   take over the claims of a message of another scanner
+*/
+void ClaimReceive(CLAIM_MAP_T *map, const uint8_t *message, size_t length, uint32_t now)
+{
+  uint32_t sender = 0;
+
+  if (length < CLAIM_HEADER_LENGTH || message[0] != CLAIM_VERSION)
+    return;
+  for (int n = 0; n < 4; n++)
+    sender = (sender << 8) | message[1 + n];
+  if (!sender || sender == map->self)
+    return;
+
+  for (const uint8_t *entry = message + CLAIM_HEADER_LENGTH; entry + CLAIM_ENTRY_LENGTH <= message + length; entry += CLAIM_ENTRY_LENGTH) {
+    uint64_t addr = 0;
+    int rssi = (int8_t) entry[6];
+    bool refresh = entry[7] & CLAIM_FLAG_REFRESH;
+    bool accept;
+
+    for (int n = 0; n < 6; n++)
+      addr = (addr << 8) | entry[n];
+    map->claims_received++;
+
+    CLAIM_T *claim = ClaimFind(map, addr, rssi != CLAIM_RSSI_NONE);
+
+    if (!claim)
+      continue;
+    if (rssi == CLAIM_RSSI_NONE) {
+      /*
+         the owner released the device
+      */
+      if (claim->owner == sender)
+        ClaimRemove(map, claim);
+      continue;
+    }
+
+    if (claim->owner == sender || ClaimStale(map, claim, now))
+      accept = true;
+    else if (refresh || ClaimAge(claim->since, now) < CLAIM_SETTLE) {
+      /*
+         two scanners claim the device at the same time -- all scanners decide alike
+      */
+      accept = ClaimBeats(rssi, sender, claim->rssi, claim->owner);
+    }
+    else
+      accept = rssi > claim->rssi + map->hysteresis;
+
+    if (!accept)
+      continue;
+    if (claim->owner != sender) {
+      if (claim->owner == map->self)
+        map->losses++;
+      claim->owner = sender;
+      claim->since = now;
+      claim->wins = 0;
+    }
+    claim->rssi = rssi;
+    claim->updated = now;
+  }
+}
+
+/*
+   send the queued claims
+*/
+void ClaimFlush(CLAIM_MAP_T *map)
+{
+  if (map->length > CLAIM_HEADER_LENGTH && map->send)
+    (*map->send)(map->message, map->length);
+  map->length = CLAIM_HEADER_LENGTH;
+}
+
+/*
+   remove the devices not claimed for twice the timeout
+*/
+void ClaimExpire(CLAIM_MAP_T *map, uint32_t now)
+{
+  for (int slot = 0; slot < CLAIM_LENGTH; slot++)
+    while (map->claims[slot].addr && ClaimAge(map->claims[slot].updated, now) > 2 * map->timeout)
+      ClaimRemove(map, &map->claims[slot]);
+}
+
+/*
+   return the number of devices owned by us
+*/
+int ClaimOwned(const CLAIM_MAP_T *map)
+{
+  int owned = 0;
+
+  for (int slot = 0; slot < CLAIM_LENGTH; slot++)
+    if (map->claims[slot].addr && map->claims[slot].owner == map->self)
+      owned++;
+  return owned;
+}
+
+/*
+   compute the id of a scanner out of its name
+*/
+uint32_t ClaimId(const char *name)
+{
+  uint32_t hash = 2166136261UL;
+
+  while (*name)
+    hash = (hash ^ (uint8_t) *name++) * 16777619UL;
+  return (hash) ? hash : 1;
+}/**/
@@ -0,0 +1,157 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  claims to elect one scanner publishing a device, out of several scanners
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __CLAIM_H__
+#define __CLAIM_H__ 1
+
+/*
+   scanners sharing a claims topic elect an owner per device, which is
+   the only one publishing it -- a scanner claims a device by its
+   smoothed RSSI, and takes over a device owned by another scanner once
+   its RSSI was stronger by the hysteresis for the dwell time, or the
+   owner stopped claiming
+
+   the owner repeats its claim every third of the timeout, or when its
+   RSSI moved by the hysteresis -- it releases the device once it's absent
+
+   claims are batched into binary messages:
+
+     version (1 byte), id of the scanner (4 bytes, big endian)
+     per claim: address (6 bytes, printed order), RSSI (1 byte), flags (1 byte)
+
+   this file and claim.cpp have no dependencies, so they are shared with
+   the simulation tool
+*/
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+   number of slots of the map -- has to be a power of two
+*/
+#define CLAIM_LENGTH                256
+
+/*
+   number of devices the map holds -- further devices are published as
+   without claims by every scanner seeing them, and counted as dropped
+*/
+#define CLAIM_CAPACITY              (CLAIM_LENGTH * 3 / 4)
+
+/*
+   claims per message -- keeps a message within the default packet size of PubSubClient
+*/
+#define CLAIM_BATCH                 20
+#define CLAIM_HEADER_LENGTH         5
+#define CLAIM_ENTRY_LENGTH          8
+#define CLAIM_MESSAGE_LENGTH        (CLAIM_HEADER_LENGTH + CLAIM_BATCH * CLAIM_ENTRY_LENGTH)
+#define CLAIM_VERSION               1
+
+/*
+   flags of a claim
+*/
+#define CLAIM_FLAG_REFRESH          0x01        // the sender owns the device, otherwise it takes over
+
+/*
+   RSSI of a released device
+*/
+#define CLAIM_RSSI_NONE             -128
+
+/*
+   a claim is settled once the owner held it for this time in seconds --
+   before, concurrent claims are decided by the RSSI without the hysteresis
+*/
+#define CLAIM_SETTLE                5
+
+typedef struct _claim {
+  uint64_t addr;                    // 0 marks an empty slot
+  uint32_t owner;                   // id of the owning scanner
+  uint16_t updated;                 // time of the last claim of the owner, in seconds modulo 2^16
+  uint16_t since;                   // time the owner took over
+  uint16_t sent;                    // time of our last claim
+  int8_t rssi;                      // RSSI of the last claim of the owner
+  uint8_t wins;                     // consecutive checks our RSSI was stronger by the hysteresis
+} CLAIM_T;
+
+typedef struct _claim_map {
+  CLAIM_T claims[CLAIM_LENGTH];
+  int count;
+  uint32_t self;                    // our id
+  int hysteresis;                   // in dB
+  int dwell;                        // checks our RSSI has to be stronger to take over
+  int timeout;                      // seconds after the last claim the owner is gone
+  void (*send)(const uint8_t *message, size_t length);
+  uint8_t message[CLAIM_MESSAGE_LENGTH];
+  size_t length;
+
+  /*
+     stats
+  */
+  unsigned long claims_sent;
+  unsigned long claims_received;
+  unsigned long takeovers;
+  unsigned long losses;
+  unsigned long dropped;
+} CLAIM_MAP_T;
+
+/*
+   setup an empty map
+*/
+void ClaimInit(CLAIM_MAP_T *map, uint32_t self, int hysteresis, int dwell, int timeout, void (*send)(const uint8_t *message, size_t length));
+
+/*
+   check the claim of a device we see -- claims are queued as needed,
+   the dwell counts the calls, which are done once per second
+
+   return true if we own the device
+*/
+bool ClaimDevice(CLAIM_MAP_T *map, uint64_t addr, bool present, int rssi, uint32_t now);
+
+/*
+   take over the claims of a message of another scanner
+*/
+void ClaimReceive(CLAIM_MAP_T *map, const uint8_t *message, size_t length, uint32_t now);
+
+/*
+   send the queued claims
+*/
+void ClaimFlush(CLAIM_MAP_T *map);
+
+/*
+   remove the devices not claimed for twice the timeout
+*/
+void ClaimExpire(CLAIM_MAP_T *map, uint32_t now);
+
+/*
+   return the number of devices owned by us
+*/
+int ClaimOwned(const CLAIM_MAP_T *map);
+
+/*
+   compute the id of a scanner out of its name
+*/
+uint32_t ClaimId(const char *name);
+
+#endif
+
+/**/
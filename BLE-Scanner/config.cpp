@@ -42,6 +42,16 @@ bool ConfigSetup(void)
   EepromInit(sizeof(CONFIG_T));
   EepromRead(0, sizeof(CONFIG_T), &_config);
 
+  /*
+     take over a config of version 5 -- the bytes behind it might not be zero
+  */
+  if (!strcmp(_config.magic, CONFIG_MAGIC) && _config.version == 5) {
+    LogMsg("CFG: upgrading config from version 5 to %d", CONFIG_VERSION);
+    memset((byte *) &_config + CONFIG_V5_LENGTH, 0, sizeof(CONFIG_T) - CONFIG_V5_LENGTH);
+    _config.version = CONFIG_VERSION;
+    EepromWrite(0, sizeof(CONFIG_T), &_config);
+  }
+
   /*
      check if the config version is ok
   */
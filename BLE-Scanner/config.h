@@ -38,16 +38,24 @@
    control the debugging messages
 */
 #define DBG               0
+#define DBG_BEACON        (DBG && 0)
 #define DBG_BT            (DBG && 1)
 #define DBG_CFG           (DBG && 0)
+#define DBG_DEDUP         (DBG && 0)
+#define DBG_FILTER        (DBG && 0)
+#define DBG_GROUP         (DBG && 0)
 #define DBG_HTTP          (DBG && 0)
 #define DBG_LED           (DBG && 0)
 #define DBG_MANUFACTURER  (DBG && 0)
 #define DBG_NTP           (DBG && 0)
 #define DBG_MQTT          (DBG && 1)
+#define DBG_PAYLOAD       (DBG && 0)
 #define DBG_SCANDEV       (DBG && 0)
+#define DBG_SCHEDULER     (DBG && 0)
+#define DBG_SENSOR        (DBG && 0)
 #define DBG_STATE         (DBG && 0)
 #define DBG_UTIL          (DBG && 0)
+#define DBG_WATCHLIST     (DBG && 0)
 #define DBG_WIFI          (DBG && 0)
 
 
@@ -55,7 +63,14 @@
   tags to mark the configuration in the EEPROM
 */
 #define CONFIG_MAGIC      __TITLE__ "-CONFIG"
-#define CONFIG_VERSION    5
+#define CONFIG_VERSION    6
+
+/*
+   version 5 ended with the first five fields of the bluetooth config and
+   its reserved bytes -- everything behind was added with version 6, so an
+   old config is taken over up to there and the rest is zeroed
+*/
+#define CONFIG_V5_LENGTH  (offsetof(CONFIG_T, bluetooth) + offsetof(CONFIG_BT_T, profile))
 
 /*
    sub-systems config structs
@@ -85,7 +100,10 @@ typedef struct _config_mqtt {
   char topicPrefix[64];
   bool publish_absence;             // only report presence, or also the absence
   unsigned long publish_timeout;    // don't report a device too often
-  char reserved[58];
+  bool occupancy;                   // only publish the number of present devices
+  bool sessions;                    // only publish a record per visit of a device
+  bool events;                      // publish a sequenced stream of arrivals & departures
+  char reserved[55];
 } CONFIG_MQTT_T;
 
 typedef struct _config_bluetooth {
@@ -94,9 +112,114 @@ typedef struct _config_bluetooth {
   unsigned long activescan_timeout; // don't report a device too often
   int absence_cycles;               // number of complete cycles before a device is set absent
   unsigned long battcheck_timeout;  // don't check the device battery too often
-  char reserved[70];
+  int profile;                      // scan profile
+  bool continuous;                  // keep the scan running instead of scan/pause cycles
+  unsigned long cycle_time;         // length of a virtual cycle in continuous mode
+  bool adaptive;                    // adapt scan and pause time to the device churn
+  unsigned long scan_time_min;      // bounds for the adaptive scan time
+  unsigned long scan_time_max;
+  unsigned long pause_time_min;     // bounds for the adaptive pause time
+  unsigned long pause_time_max;
+  bool enrich;                      // read the device information via GATT
+  unsigned long enrich_ttl;         // time to keep the device information in seconds
+  int connect_budget;               // maximum number of connections per minute
+  bool learn_absence;               // derive the absence timeout of each device from its detection rate
+  int absence_target;               // accepted rate of false absences in 0.1 %
+  bool presence_score;              // derive the presence from a score instead of a timeout
+  unsigned char presence_enter;     // score to become present
+  unsigned char presence_leave;     // score to become absent
+  int enrich_cache;                 // number of devices in the device information cache
+  char reserved[11];
 } CONFIG_BT_T;
 
+#define CONFIG_WATCHLIST_LENGTH   256
+
+typedef struct _config_watchlist {
+  bool enabled;                     // only scan for the devices on the watchlist
+  int count;                        // number of addresses in the list
+  unsigned char addr[CONFIG_WATCHLIST_LENGTH][6];
+  char reserved[64];
+} CONFIG_WATCHLIST_T;
+
+#define CONFIG_SENSOR_METRICS     8
+
+typedef struct _config_sensor {
+  bool enabled;                     // decode and publish the values of sensor tags
+  unsigned long min_interval;       // don't publish a metric more often (seconds)
+  unsigned long heartbeat;          // publish a metric at least this often (seconds)
+  int deadband_abs[CONFIG_SENSOR_METRICS];  // absolute change to publish, in the unit of the metric
+  int deadband_rel[CONFIG_SENSOR_METRICS];  // relative change to publish, in 0.1 %
+  char reserved[64];
+} CONFIG_SENSOR_T;
+
+#define CONFIG_BEACON_REGIONS     8
+
+typedef struct _config_beacon {
+  bool enabled;                     // track iBeacons by UUID, major & minor instead of their address
+  int regions;                      // number of region UUIDs
+  unsigned char region[CONFIG_BEACON_REGIONS][16];
+  char reserved[64];
+} CONFIG_BEACON_T;
+
+#define CONFIG_ZONES              3
+
+typedef struct _config_zone {
+  bool enabled;                     // publish zone transitions instead of each RSSI change
+  int threshold[CONFIG_ZONES];      // minimum smoothed RSSI of the immediate, near & far zone
+  int hysteresis[CONFIG_ZONES];     // margin around each threshold
+  bool configured;                  // the thresholds are set -- 0 dBm is a valid threshold
+  char reserved[31];
+} CONFIG_ZONE_T;
+
+#define CONFIG_GROUPS             8
+#define CONFIG_GROUP_MEMBERS      4
+#define CONFIG_GROUP_NAME_LENGTH  16
+
+typedef struct _config_group {
+  bool enabled;                     // publish the presence of groups of devices
+  unsigned long grace;              // time after the last member left in seconds
+  int count;                        // number of groups
+  struct {
+    char name[CONFIG_GROUP_NAME_LENGTH];
+    int members;
+    unsigned char addr[CONFIG_GROUP_MEMBERS][6];
+  } group[CONFIG_GROUPS];
+  char reserved[32];
+} CONFIG_GROUP_T;
+
+#define CONFIG_PAYLOAD_FIELDS     16
+#define CONFIG_PAYLOAD_DEVICES    8
+#define CONFIG_PAYLOAD_ALIAS_LENGTH 8
+
+typedef struct _config_payload {
+  bool enabled;                     // publish only the selected fields of the devices
+  unsigned short mask;              // fields published for all other devices
+  int count;                        // number of devices with fields of their own
+  struct {
+    unsigned char addr[6];
+    unsigned short mask;
+  } device[CONFIG_PAYLOAD_DEVICES];
+  char alias[CONFIG_PAYLOAD_FIELDS][CONFIG_PAYLOAD_ALIAS_LENGTH];   // short keys of the fields
+  char reserved[32];
+} CONFIG_PAYLOAD_T;
+
+#define CONFIG_FILTER_LENGTH      128
+
+typedef struct _config_filter {
+  bool enabled;                     // publish only the devices matching the rule
+  char rule[CONFIG_FILTER_LENGTH];  // expression over the values of a device, see rule.h
+  char reserved[32];
+} CONFIG_FILTER_T;
+
+typedef struct _config_dedup {
+  bool enabled;                     // publish only the devices this scanner owns
+  char topic[64];                   // topic shared by the scanners for their claims
+  int hysteresis;                   // RSSI in dB to take over a device from another scanner
+  unsigned long timeout;            // seconds after the last claim of the owner to take over
+  int dwell;                        // seconds the RSSI has to be stronger to take over
+  char reserved[28];
+} CONFIG_DEDUP_T;
+
 /*
    the configuration layout
 */
@@ -108,6 +231,14 @@ typedef struct _config {
   CONFIG_NTP_T ntp;
   CONFIG_MQTT_T mqtt;
   CONFIG_BT_T bluetooth;
+  CONFIG_WATCHLIST_T watchlist;
+  CONFIG_SENSOR_T sensor;
+  CONFIG_BEACON_T beacon;
+  CONFIG_ZONE_T zone;
+  CONFIG_GROUP_T group;
+  CONFIG_PAYLOAD_T payload;
+  CONFIG_FILTER_T filter;
+  CONFIG_DEDUP_T dedup;
 } CONFIG_T;
 
 /*
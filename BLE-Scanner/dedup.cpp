@@ -0,0 +1,151 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to publish each device by only one of several scanners
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "mqtt.h"
+#include "claim.h"
+#include "dedup.h"
+#include "util.h"
+
+/*
+   the scanners publish their claims to a topic shared by all of them,
+   so each device is published by the scanner receiving it best -- the
+   election itself is done in claim.cpp
+*/
+static CLAIM_MAP_T _map;
+
+/*
+   send a message of claims
+*/
+static void DedupSend(const uint8_t *message, size_t length)
+{
+  MqttPublishBinary(_config.dedup.topic, message, length);
+}
+
+/*
+   setup the claims
+*/
+void DedupSetup(void)
+{
+  /*
+     check and correct the config
+  */
+  _config.dedup.enabled = _config.dedup.enabled ? true : false;
+  _config.dedup.topic[sizeof(_config.dedup.topic) - 1] = '\0';
+  if (!*_config.dedup.topic)
+    strcpy(_config.dedup.topic, DEDUP_TOPIC_DEFAULT);
+  if (!_config.dedup.hysteresis && !_config.dedup.timeout)
+    _config.dedup.hysteresis = DEDUP_HYSTERESIS_DEFAULT;
+  FIX_RANGE(_config.dedup.hysteresis, DEDUP_HYSTERESIS_MIN, DEDUP_HYSTERESIS_MAX);
+  if (!_config.dedup.dwell)
+    _config.dedup.dwell = DEDUP_DWELL_DEFAULT;
+  FIX_RANGE(_config.dedup.dwell, DEDUP_DWELL_MIN, DEDUP_DWELL_MAX);
+  if (!_config.dedup.timeout)
+    _config.dedup.timeout = DEDUP_TIMEOUT_DEFAULT;
+  FIX_RANGE(_config.dedup.timeout, DEDUP_TIMEOUT_MIN, DEDUP_TIMEOUT_MAX);
+
+  ClaimInit(&_map, ClaimId(_config.mqtt.clientID), _config.dedup.hysteresis, _config.dedup.dwell, _config.dedup.timeout, DedupSend);
+
+  LogMsg("DEDUP: %s with topic %s", (_config.dedup.enabled) ? "enabled" : "disabled", _config.dedup.topic);
+}
+
+/*
+   check the claim of a device
+*/
+bool DedupDevice(const SCANDEV_T *device)
+{
+  if (!_config.dedup.enabled)
+    return true;
+
+  bool owned = ClaimDevice(&_map, (uint64_t) device->addr, device->present, device->rssi_smoothed >> 4, now());
+
+#if DBG_DEDUP
+  DbgMsg("DEDUP: device %s is %s", device->addr.toString().c_str(), (owned) ? "ours" : "owned by another scanner");
+#endif
+  return owned;
+}
+
+/*
+   do the cyclic update -- send the queued claims
+*/
+void DedupUpdate(void)
+{
+  static time_t _last = 0;
+  static time_t _last_full = 0;
+  static unsigned long _dropped = 0;
+
+  if (!_config.dedup.enabled)
+    return;
+
+  ClaimFlush(&_map);
+  if (now() > _last) {
+    ClaimExpire(&_map, now());
+    _last = now();
+
+    if (_map.dropped != _dropped && (!_last_full || now() - _last_full >= DEDUP_FULL_LOG_CYCLE)) {
+      /*
+         the devices not fitting into the map are published by every scanner seeing them
+      */
+      LogMsg("DEDUP: map of claims is full with %d devices -- %lu devices published without claims", CLAIM_CAPACITY, _map.dropped - _dropped);
+      _dropped = _map.dropped;
+      _last_full = now();
+    }
+  }
+}
+
+/*
+   return the topic to subscribe for the claims, or NULL
+*/
+const char *DedupTopic(void)
+{
+  return (_config.dedup.enabled) ? _config.dedup.topic : NULL;
+}
+
+/*
+   handle a message received on the claims topic
+*/
+bool DedupReceive(const char *topic, const uint8_t *payload, unsigned int length)
+{
+  if (!_config.dedup.enabled || strcmp(topic, _config.dedup.topic))
+    return false;
+
+  ClaimReceive(&_map, payload, length, now());
+  return true;
+}
+
+/*
+   get some stats
+*/
+void DedupStats(int *devices, int *owned, int *capacity, unsigned long *dropped, unsigned long *takeovers, unsigned long *losses, unsigned long *claims_sent, unsigned long *claims_received)
+{
+  *devices = _map.count;
+  *owned = ClaimOwned(&_map);
+  *capacity = CLAIM_CAPACITY;
+  *dropped = _map.dropped;
+  *takeovers = _map.takeovers;
+  *losses = _map.losses;
+  *claims_sent = _map.claims_sent;
+  *claims_received = _map.claims_received;
+}/**/
@@ -0,0 +1,88 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to publish each device by only one of several scanners
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __DEDUP_H__
+#define __DEDUP_H__ 1
+
+#include "config.h"
+#include "scandev.h"
+#include "claim.h"
+
+/*
+   ranges of the settings
+*/
+#define DEDUP_TOPIC_DEFAULT         "BLE-Scanner/claims"
+#define DEDUP_HYSTERESIS_MIN        0             // dB
+#define DEDUP_HYSTERESIS_MAX        30
+#define DEDUP_HYSTERESIS_DEFAULT    6
+#define DEDUP_DWELL_MIN             1             // seconds
+#define DEDUP_DWELL_MAX             60
+#define DEDUP_DWELL_DEFAULT         3
+#define DEDUP_TIMEOUT_MIN           10            // seconds
+#define DEDUP_TIMEOUT_MAX           (60 * 60)
+#define DEDUP_TIMEOUT_DEFAULT       60
+
+/*
+   cycle to log a full map of claims in seconds
+*/
+#define DEDUP_FULL_LOG_CYCLE        60
+
+/*
+   setup the claims
+*/
+void DedupSetup(void);
+
+/*
+   check the claim of a device -- called once per second for each device
+
+   return true if this scanner owns the device and has to publish it
+*/
+bool DedupDevice(const SCANDEV_T *device);
+
+/*
+   do the cyclic update -- send the queued claims
+*/
+void DedupUpdate(void);
+
+/*
+   return the topic to subscribe for the claims, or NULL
+*/
+const char *DedupTopic(void);
+
+/*
+   handle a message received on the claims topic
+
+   return false if the message wasn't received on the claims topic
+*/
+bool DedupReceive(const char *topic, const uint8_t *payload, unsigned int length);
+
+/*
+   get some stats
+*/
+void DedupStats(int *devices, int *owned, int *capacity, unsigned long *dropped, unsigned long *takeovers, unsigned long *losses, unsigned long *claims_sent, unsigned long *claims_received);
+
+#endif
+
+/**/
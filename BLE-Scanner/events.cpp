@@ -0,0 +1,266 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to publish a sequenced stream of presence events and a digest of the present devices
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "mqtt.h"
+#include "events.h"
+#include "scandev.h"
+#include "util.h"
+
+/*
+   each arrival and departure gets the next sequence number and is
+   published below PREFIX/events -- a consumer missing a number knows
+   that it lost an event
+
+   the digest is the XOR of the FNV-1a hashes of the present addresses,
+   each address taken as its six bytes in the printed order, so it
+   doesn't depend on the order of the events and every consumer can
+   compute it out of the set it holds -- the digest is published with
+   its sequence number below PREFIX/alive, and only if it doesn't match,
+   a consumer has to request a snapshot via PREFIX/control/snapshot
+
+   the snapshot is published below PREFIX/snapshot in parts, each with
+   the sequence number and the digest it matches, so the consumer takes
+   the events following that sequence number on top of it
+
+   the digest follows the present devices even while the stream is off,
+   so it matches them once the stream is switched on
+
+   the boot id changes with each start, as the sequence starts over
+*/
+typedef struct _event {
+  uint64_t addr;
+  uint32_t seq;
+  time_t time;
+  bool present;
+} EVENT_T;
+
+static EVENT_T _queue[EVENTS_QUEUE_LENGTH];
+static int _queue_head = 0;
+static int _queue_count = 0;
+static portMUX_TYPE _events_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static char _boot[9] = "";
+static uint32_t _seq = 0;
+static int _present = 0;
+static uint32_t _digest = 0;
+static unsigned long _dropped = 0;
+static time_t _last_alive = 0;
+static volatile bool _snapshot = false;
+
+/*
+   hash an address
+*/
+static uint32_t EventsHash(uint64_t addr)
+{
+  uint32_t hash = 2166136261UL;
+
+  for (int shift = 40; shift >= 0; shift -= 8)
+    hash = (hash ^ (uint8_t) (addr >> shift)) * 16777619UL;
+  return hash;
+}
+
+/*
+   setup the event stream
+*/
+void EventsSetup(void)
+{
+  if (!*_boot)
+    snprintf(_boot, sizeof(_boot), "%08x", (unsigned int) esp_random());
+}
+
+/*
+   a device arrived or left -- may be called from any task
+*/
+bool EventsPresence(const BLEAddress &addr, bool present)
+{
+  bool queued = false;
+  time_t t = now();       // might sync the time, so not within the lock
+
+  portENTER_CRITICAL(&_events_mux);
+  _seq++;
+  _digest ^= EventsHash((uint64_t) addr);
+  _present += (present) ? 1 : -1;
+  if (!_config.mqtt.events || _config.mqtt.occupancy)
+    queued = true;
+  else if (_queue_count < EVENTS_QUEUE_LENGTH) {
+    EVENT_T *event = &_queue[(_queue_head + _queue_count++) % EVENTS_QUEUE_LENGTH];
+
+    event->addr = (uint64_t) addr;
+    event->seq = _seq;
+    event->time = t;
+    event->present = present;
+    queued = true;
+  }
+  else
+    _dropped++;
+  portEXIT_CRITICAL(&_events_mux);
+  return queued;
+}
+
+/*
+   a consumer requested a snapshot -- it is published with the next update
+*/
+void EventsSnapshot(void)
+{
+  _snapshot = true;
+}
+
+/*
+   publish the addresses counted in the digest
+*/
+static void EventsPublishSnapshot(void)
+{
+  uint64_t *addrs;
+  uint32_t seq, digest, check;
+  int count = 0;
+  bool match = false;
+  char hex[9];
+
+  if (!(addrs = (uint64_t *) malloc(SCANDEV_LIST_MAX_LENGTH * sizeof(uint64_t)))) {
+    LogMsg("EVENTS: no memory for the snapshot");
+    return;
+  }
+
+  /*
+     a device might arrive or leave while the list is taken, so
+     the list has to match the digest of the same sequence number
+  */
+  for (int attempt = 0; attempt < EVENTS_SNAPSHOT_ATTEMPTS && !match; attempt++) {
+    portENTER_CRITICAL(&_events_mux);
+    seq = _seq;
+    portEXIT_CRITICAL(&_events_mux);
+
+    count = ScanDevEventAddresses(addrs, SCANDEV_LIST_MAX_LENGTH);
+    check = 0;
+    for (int n = 0; n < count; n++)
+      check ^= EventsHash(addrs[n]);
+
+    portENTER_CRITICAL(&_events_mux);
+    digest = _digest;
+    match = _seq == seq && digest == check;
+    portEXIT_CRITICAL(&_events_mux);
+  }
+  if (!match) {
+    LogMsg("EVENTS: the device list didn't settle for a snapshot");
+    free(addrs);
+    return;
+  }
+
+  snprintf(hex, sizeof(hex), "%08x", (unsigned int) digest);
+  int parts = (count + EVENTS_SNAPSHOT_CHUNK - 1) / EVENTS_SNAPSHOT_CHUNK;
+
+  if (!parts)
+    parts = 1;
+  for (int part = 0; part < parts; part++) {
+    String json = "\"seq\":" + String(seq) + ","
+                  "\"count\":" + String(count) + ","
+                  "\"digest\":\"" + String(hex) + "\","
+                  "\"part\":" + String(part + 1) + ","
+                  "\"parts\":" + String(parts) + ","
+                  "\"addresses\":[";
+
+    for (int n = part * EVENTS_SNAPSHOT_CHUNK; n < count && n < (part + 1) * EVENTS_SNAPSHOT_CHUNK; n++)
+      json += String((n > part * EVENTS_SNAPSHOT_CHUNK) ? "," : "") + "\"" + String(BLEAddress(addrs[n], BLE_ADDR_PUBLIC).toString().c_str()) + "\"";
+    json += "],"
+            "\"boot\":\"" + String(_boot) + "\","
+            "\"Scanner\":\"" + String(_config.device.name) + "\"";
+
+    MqttPublishPrefixed("snapshot", "{" + json + "}");
+  }
+  free(addrs);
+}
+
+/*
+   do the cyclic update -- publish the queued events and the digest
+*/
+void EventsUpdate(void)
+{
+  EVENT_T event;
+
+  if (!_config.mqtt.events || _config.mqtt.occupancy)
+    return;
+
+  for (;;) {
+    portENTER_CRITICAL(&_events_mux);
+    if (!_queue_count) {
+      portEXIT_CRITICAL(&_events_mux);
+      break;
+    }
+    event = _queue[_queue_head];
+    _queue_head = (_queue_head + 1) % EVENTS_QUEUE_LENGTH;
+    _queue_count--;
+    portEXIT_CRITICAL(&_events_mux);
+
+    MqttPublishPrefixed("events", "{"
+                        "\"seq\":" + String(event.seq) + ","
+                        "\"event\":\"" + String((event.present) ? "enter" : "leave") + "\","
+                        "\"address\":\"" + String(BLEAddress(event.addr, BLE_ADDR_PUBLIC).toString().c_str()) + "\","
+                        "\"time\":\"" + String(TimeToString(event.time)) + "\","
+                        "\"boot\":\"" + String(_boot) + "\","
+                        "\"Scanner\":\"" + String(_config.device.name) + "\""
+                        "}");
+  }
+
+  if (_snapshot) {
+    _snapshot = false;
+    EventsPublishSnapshot();
+  }
+
+  if (now() - _last_alive >= EVENTS_ALIVE_CYCLE) {
+    uint32_t seq, digest;
+    int present;
+    char hex[9];
+
+    _last_alive = now();
+    portENTER_CRITICAL(&_events_mux);
+    seq = _seq;
+    digest = _digest;
+    present = _present;
+    portEXIT_CRITICAL(&_events_mux);
+
+    snprintf(hex, sizeof(hex), "%08x", (unsigned int) digest);
+    MqttPublishPrefixed("alive", "{"
+                        "\"seq\":" + String(seq) + ","
+                        "\"count\":" + String(present) + ","
+                        "\"digest\":\"" + String(hex) + "\","
+                        "\"boot\":\"" + String(_boot) + "\","
+                        "\"Scanner\":\"" + String(_config.device.name) + "\""
+                        "}");
+  }
+}
+
+/*
+   get some stats
+*/
+void EventsStats(uint32_t *seq, int *present, uint32_t *digest, unsigned long *dropped)
+{
+  portENTER_CRITICAL(&_events_mux);
+  *seq = _seq;
+  *present = _present;
+  *digest = _digest;
+  *dropped = _dropped;
+  portEXIT_CRITICAL(&_events_mux);
+}/**/
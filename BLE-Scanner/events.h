@@ -0,0 +1,81 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to publish a sequenced stream of presence events and a digest of the present devices
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __EVENTS_H__
+#define __EVENTS_H__ 1
+
+#include <NimBLEDevice.h>
+#include "config.h"
+
+/*
+   number of events waiting to be published
+*/
+#define EVENTS_QUEUE_LENGTH         32
+
+/*
+   cycle to publish the digest of the present devices in seconds
+*/
+#define EVENTS_ALIVE_CYCLE          60
+
+/*
+   number of addresses per snapshot message, and attempts to take a
+   snapshot matching the digest
+*/
+#define EVENTS_SNAPSHOT_CHUNK       64
+#define EVENTS_SNAPSHOT_ATTEMPTS    3
+
+/*
+   setup the event stream
+*/
+void EventsSetup(void);
+
+/*
+   a device arrived or left -- may be called from any task
+
+   the event is counted in the digest even while the stream is off
+
+   return false if the event couldn't be queued, the gap in the
+   sequence numbers tells the consumers to request a snapshot
+*/
+bool EventsPresence(const BLEAddress &addr, bool present);
+
+/*
+   a consumer requested a snapshot -- it is published with the next update
+*/
+void EventsSnapshot(void);
+
+/*
+   do the cyclic update -- publish the queued events and the digest
+*/
+void EventsUpdate(void);
+
+/*
+   get some stats
+*/
+void EventsStats(uint32_t *seq, int *present, uint32_t *digest, unsigned long *dropped);
+
+#endif
+
+/**/
@@ -0,0 +1,134 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to select the devices to publish by a rule
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "rule.h"
+#include "filter.h"
+#include "util.h"
+
+/*
+   the rule is compiled once, so checking a device only collects its
+   values and runs the code of the rule
+*/
+static RULE_T _rule;
+static char _error[RULE_ERROR_LENGTH] = "";
+static unsigned long _evaluated = 0;
+static unsigned long _matched = 0;
+
+/*
+   setup the filter -- compile the rule of the configuration
+*/
+void FilterSetup(void)
+{
+  /*
+     check and correct the config
+  */
+  _config.filter.enabled = _config.filter.enabled ? true : false;
+  _config.filter.rule[CONFIG_FILTER_LENGTH - 1] = '\0';
+
+  if (!RuleCompile(&_rule, _config.filter.rule, _error, sizeof(_error)))
+    LogMsg("FILTER: invalid rule %s: %s", _config.filter.rule, _error);
+
+  LogMsg("FILTER: %s with rule %s", (_config.filter.enabled) ? "enabled" : "disabled", _config.filter.rule);
+}
+
+/*
+   select a new rule and store it in the configuration
+*/
+bool FilterSelect(const char *rule)
+{
+  RULE_T compiled;
+  CONFIG_FILTER_T filter = _config.filter;
+
+  if (strlen(rule) >= CONFIG_FILTER_LENGTH) {
+    snprintf(_error, sizeof(_error), "rule too long");
+    return false;
+  }
+  if (!RuleCompile(&compiled, rule, _error, sizeof(_error))) {
+    LogMsg("FILTER: invalid rule %s: %s", rule, _error);
+    return false;
+  }
+
+  /*
+     take over the rule and write it back
+  */
+  _rule = compiled;
+  filter.enabled = (*rule) ? true : false;
+  memset(filter.rule, 0, sizeof(filter.rule));
+  strncpy(filter.rule, rule, CONFIG_FILTER_LENGTH - 1);
+  CONFIG_SET(CONFIG_FILTER_T, filter, &filter);
+
+  LogMsg("FILTER: selecting rule %s", _config.filter.rule);
+  return true;
+}
+
+/*
+   check if a device matches the rule
+*/
+bool FilterMatch(const SCANDEV_T *device)
+{
+  int32_t vars[RULE_VARS];
+  bool match;
+
+  if (!_config.filter.enabled || !_rule.length)
+    return true;
+
+  vars[RULE_VAR_RSSI] = device->rssi;
+  vars[RULE_VAR_MANUFACTURER] = device->manufacturer_id;
+  vars[RULE_VAR_PRESENT] = device->present;
+  vars[RULE_VAR_BATTERY] = (device->has_battery) ? device->battery_level : -1;
+  vars[RULE_VAR_INTERVAL] = device->interval;
+  vars[RULE_VAR_ZONE] = device->zone;
+  vars[RULE_VAR_CONNECTABLE] = device->connectable;
+  vars[RULE_VAR_AGE] = now() - device->last_seen;
+  vars[RULE_VAR_SIGHTINGS] = device->session_sightings;
+
+  match = RuleEval(&_rule, vars);
+  _evaluated++;
+  if (match)
+    _matched++;
+
+#if DBG_FILTER
+  DbgMsg("FILTER: device %s %s", device->addr.toString().c_str(), (match) ? "matches" : "doesn't match");
+#endif
+  return match;
+}
+
+/*
+   return the error of the last rule which couldn't be compiled
+*/
+const char *FilterError(void)
+{
+  return _error;
+}
+
+/*
+   get some stats
+*/
+void FilterStats(unsigned long *evaluated, unsigned long *matched)
+{
+  *evaluated = _evaluated;
+  *matched = _matched;
+}/**/
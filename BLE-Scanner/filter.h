@@ -0,0 +1,61 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to select the devices to publish by a rule
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __FILTER_H__
+#define __FILTER_H__ 1
+
+#include "config.h"
+#include "scandev.h"
+
+/*
+   setup the filter -- compile the rule of the configuration
+*/
+void FilterSetup(void);
+
+/*
+   select a new rule and store it in the configuration -- an empty rule selects all devices
+
+   return false if the rule is invalid, the current rule is kept then
+*/
+bool FilterSelect(const char *rule);
+
+/*
+   check if a device matches the rule
+*/
+bool FilterMatch(const SCANDEV_T *device);
+
+/*
+   return the error of the last rule which couldn't be compiled
+*/
+const char *FilterError(void);
+
+/*
+   get some stats
+*/
+void FilterStats(unsigned long *evaluated, unsigned long *matched);
+
+#endif
+
+/**/
@@ -0,0 +1,53 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  fingerprint of the advertisement payloads
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __FINGERPRINT_H__
+#define __FINGERPRINT_H__ 1
+
+/*
+   a known device sending the same payload as before takes the fast path,
+   which only updates its RSSI and the time it was seen last
+
+   this file has no dependencies, so it is shared with the fast path bench
+*/
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+   return the fingerprint of an advertisement payload (FNV-1a) -- never 0,
+   which marks devices which always take the full path
+*/
+static inline uint32_t FingerprintPayload(const uint8_t *payload, size_t length)
+{
+  uint32_t hash = 2166136261UL;
+
+  while (length--)
+    hash = (hash ^ *payload++) * 16777619UL;
+  return (hash) ? hash : 1;
+}
+
+#endif
+
+/**/
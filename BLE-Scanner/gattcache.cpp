@@ -0,0 +1,319 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to cache the device information read via GATT
+
+  The entries are kept in fixed slots, each slot is stored under its
+  own key in the NVS, so only changed entries are written. A sorted
+  index over the slots is used for the lookup. When the cache is full,
+  the entry used least recently is replaced.
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include <Preferences.h>
+#include <nvs.h>
+#include "config.h"
+#include "gattcache.h"
+#include "util.h"
+
+/*
+   the namespace in the NVS, and the version of its layout -- a namespace
+   of another version is cleared
+*/
+#define GATTCACHE_NAMESPACE   "gattcache"
+#define GATTCACHE_VERSION     2
+
+/*
+   the cache slots and the time each slot was used last
+*/
+static GATTCACHE_ENTRY_T *_cache = NULL;
+static time_t *_used = NULL;
+static int _length = 0;
+
+/*
+   the sorted index over the used slots
+*/
+static struct _gattcache_index {
+  uint64_t addr;
+  int slot;
+} *_index = NULL;
+static int _count = 0;
+
+/*
+   the index is changed by the loop and searched by the NimBLE task
+*/
+static portMUX_TYPE _gattcache_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static Preferences _nvs;
+static bool _nvs_ok = false;
+static bool _nvs_full = false;
+
+/*
+   get the key of a slot
+*/
+static const char *GattCacheKey(int slot)
+{
+  static char key[8];
+
+  sprintf(key, "e%d", slot);
+  return key;
+}
+
+/*
+   find the position of an address in the index
+
+   return the position where it should be inserted, if it's not found
+*/
+static int GattCacheFind(uint64_t addr, bool *found)
+{
+  int low = 0;
+  int high = _count - 1;
+  int mid;
+
+  *found = false;
+  while (low <= high) {
+    mid = low + (high - low) / 2;
+    if (_index[mid].addr < addr)
+      low = mid + 1;
+    else if (_index[mid].addr > addr)
+      high = mid - 1;
+    else {
+      *found = true;
+      return mid;
+    }
+  }
+  return low;
+}
+
+/*
+   insert a slot into the index
+*/
+static void GattCacheIndex(int slot)
+{
+  bool found;
+  int pos = GattCacheFind(_cache[slot].addr, &found);
+
+  if (found)
+    return;
+  portENTER_CRITICAL(&_gattcache_mux);
+  memmove(&_index[pos + 1], &_index[pos], (_count - pos) * sizeof(_index[0]));
+  _index[pos].addr = _cache[slot].addr;
+  _index[pos].slot = slot;
+  _count++;
+  portEXIT_CRITICAL(&_gattcache_mux);
+}
+
+/*
+   setup the cache and load it from the flash
+*/
+void GattCacheSetup(void)
+{
+  /*
+     check and correct the config
+  */
+  if (!_config.bluetooth.enrich_cache)
+    _config.bluetooth.enrich_cache = GATTCACHE_LENGTH_DEFAULT;
+  FIX_RANGE(_config.bluetooth.enrich_cache, GATTCACHE_LENGTH_MIN, GATTCACHE_LENGTH_MAX);
+
+  if (_cache && _length == _config.bluetooth.enrich_cache)
+    return;
+
+  /*
+     (re-)allocate the cache
+  */
+  GATTCACHE_ENTRY_T *cache = (GATTCACHE_ENTRY_T *) calloc(_config.bluetooth.enrich_cache, sizeof(GATTCACHE_ENTRY_T));
+  time_t *used = (time_t *) calloc(_config.bluetooth.enrich_cache, sizeof(time_t));
+  struct _gattcache_index *index = (struct _gattcache_index *) calloc(_config.bluetooth.enrich_cache, sizeof(struct _gattcache_index));
+
+  if (!cache || !used || !index) {
+    LogMsg("GATTCACHE: couldn't allocate the cache for %d devices", _config.bluetooth.enrich_cache);
+    free(cache);
+    free(used);
+    free(index);
+    return;
+  }
+
+  portENTER_CRITICAL(&_gattcache_mux);
+  free(_cache);
+  free(_used);
+  free(_index);
+  _cache = cache;
+  _used = used;
+  _index = index;
+  _length = _config.bluetooth.enrich_cache;
+  _count = 0;
+  portEXIT_CRITICAL(&_gattcache_mux);
+
+  if (!_nvs_ok && !(_nvs_ok = _nvs.begin(GATTCACHE_NAMESPACE))) {
+    LogMsg("GATTCACHE: couldn't open the NVS namespace");
+    return;
+  }
+  _nvs_full = false;
+  if (_nvs.getUChar("version") != GATTCACHE_VERSION) {
+    /*
+       earlier versions stored a slot for each device of the cache
+    */
+    _nvs.clear();
+    _nvs.putUChar("version", GATTCACHE_VERSION);
+  }
+
+  for (int slot = 0; slot < GATTCACHE_NVS_LENGTH; slot++) {
+    const char *key = GattCacheKey(slot);
+
+    if (slot >= _length) {
+      /*
+         the cache shrunk -- drop the slots beyond its end
+      */
+      if (_nvs.isKey(key))
+        _nvs.remove(key);
+    }
+    else if (_nvs.getBytesLength(key) == sizeof(GATTCACHE_ENTRY_T)
+        && _nvs.getBytes(key, &_cache[slot], sizeof(GATTCACHE_ENTRY_T)) == sizeof(GATTCACHE_ENTRY_T)
+        && _cache[slot].addr) {
+      GattCacheIndex(slot);
+      _used[slot] = _cache[slot].updated;
+    }
+    else
+      memset(&_cache[slot], 0, sizeof(GATTCACHE_ENTRY_T));
+  }
+  LogMsg("GATTCACHE: loaded %d of %d devices", _count, _length);
+}
+
+/*
+   return the cached information of a device, or NULL if there is none
+*/
+const GATTCACHE_ENTRY_T *GattCacheLookup(const BLEAddress &addr)
+{
+  bool found;
+  int pos = GattCacheFind((uint64_t) addr, &found);
+
+  if (!found)
+    return NULL;
+  _used[_index[pos].slot] = now();
+  return &_cache[_index[pos].slot];
+}
+
+/*
+   copy the cached name of a device -- safe to be called from the NimBLE task
+*/
+bool GattCacheName(const BLEAddress &addr, char *name, size_t size)
+{
+  bool found;
+  time_t t = now();       // might sync the time, so not within the lock
+
+  portENTER_CRITICAL(&_gattcache_mux);
+  int pos = GattCacheFind((uint64_t) addr, &found);
+
+  if (found) {
+    GATTCACHE_ENTRY_T *entry = &_cache[_index[pos].slot];
+
+    if ((found = entry->valid && *entry->name))
+      strncpy(name, entry->name, size);
+    _used[_index[pos].slot] = t;
+  }
+  portEXIT_CRITICAL(&_gattcache_mux);
+  return found;
+}
+
+/*
+   return true if the device information should be read again
+*/
+bool GattCacheExpired(const BLEAddress &addr)
+{
+  const GATTCACHE_ENTRY_T *entry = GattCacheLookup(addr);
+
+  if (!entry)
+    return true;
+  return now() - entry->updated > (time_t) (entry->valid ? _config.bluetooth.enrich_ttl : GATTCACHE_RETRY_TIMEOUT);
+}
+
+/*
+   store the information read from a device
+*/
+void GattCacheUpdate(const BLEAddress &addr, const GATTCACHE_ENTRY_T *entry)
+{
+  bool found;
+  int pos = GattCacheFind((uint64_t) addr, &found);
+  int slot;
+
+  if (found)
+    slot = _index[pos].slot;
+  else if (_count < _length) {
+    /*
+       take the next free slot
+    */
+    for (slot = 0; _cache[slot].addr; slot++);
+  }
+  else {
+    /*
+       replace the entry used least recently -- the devices around keep their entries
+    */
+    pos = 0;
+    for (int n = 1; n < _count; n++)
+      if (_used[_index[n].slot] < _used[_index[pos].slot])
+        pos = n;
+    slot = _index[pos].slot;
+    portENTER_CRITICAL(&_gattcache_mux);
+    memmove(&_index[pos], &_index[pos + 1], (_count - pos - 1) * sizeof(_index[0]));
+    _count--;
+    portEXIT_CRITICAL(&_gattcache_mux);
+  }
+
+  time_t t = now();
+
+  portENTER_CRITICAL(&_gattcache_mux);
+  _cache[slot] = *entry;
+  _cache[slot].addr = (uint64_t) addr;
+  _cache[slot].updated = _used[slot] = t;
+  portEXIT_CRITICAL(&_gattcache_mux);
+  GattCacheIndex(slot);
+
+  if (!_nvs_ok || slot >= GATTCACHE_NVS_LENGTH)
+    return;
+
+  nvs_stats_t stats;
+
+  if (nvs_get_stats(NULL, &stats) == ESP_OK && stats.free_entries < GATTCACHE_NVS_RESERVE) {
+    /*
+       keep the space for the config -- the slot keeps no outdated entry
+    */
+    if (_nvs.isKey(GattCacheKey(slot)))
+      _nvs.remove(GattCacheKey(slot));
+    if (!_nvs_full)
+      LogMsg("GATTCACHE: only %d entries of the NVS partition are free, device %s is kept in memory only", (int) stats.free_entries, addr.toString().c_str());
+    _nvs_full = true;
+    return;
+  }
+  if (_nvs.putBytes(GattCacheKey(slot), &_cache[slot], sizeof(GATTCACHE_ENTRY_T)) != sizeof(GATTCACHE_ENTRY_T)) {
+    _nvs.remove(GattCacheKey(slot));
+    if (!_nvs_full)
+      LogMsg("GATTCACHE: couldn't store device %s, it is kept in memory only", addr.toString().c_str());
+    _nvs_full = true;
+  }
+}
+
+/*
+   return the number of cached devices
+*/
+int GattCacheCount(void)
+{
+  return _count;
+}/**/
@@ -0,0 +1,123 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to cache the device information read via GATT
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __GATTCACHE_H__
+#define __GATTCACHE_H__ 1
+
+#include <NimBLEDevice.h>
+#include "config.h"
+#include "scandev.h"
+#include "util.h"
+
+/*
+   number of devices in the cache -- limited by the device table
+*/
+#define GATTCACHE_LENGTH_MIN        16
+#define GATTCACHE_LENGTH_MAX        SCANDEV_LIST_MAX_LENGTH
+#define GATTCACHE_LENGTH_DEFAULT    64
+
+/*
+   each entry is stored in its own key in the NVS partition, taking four
+   entries of 32 bytes -- the partition has only 20 KB by default and
+   holds the config and the WiFi data too, so only the first slots are
+   stored, and only while enough entries stay free to write the config
+   twice -- the other slots are kept in memory only
+*/
+#define GATTCACHE_NVS_LENGTH        48
+#define GATTCACHE_NVS_RESERVE       (2 * (sizeof(CONFIG_T) / 32 + 2) + 32)
+
+/*
+   length of the strings in a cache entry
+*/
+#define GATTCACHE_NAME_LENGTH       20
+#define GATTCACHE_MODEL_LENGTH      16
+#define GATTCACHE_MANUFACTURER_LENGTH 16
+#define GATTCACHE_FIRMWARE_LENGTH   12
+
+/*
+   if the device information couldn't be read, try again after this time in seconds
+*/
+#define GATTCACHE_RETRY_TIMEOUT     (60 * 60)
+
+/*
+   service & characteristic UUIDs of the device information
+*/
+#define GATTCACHE_GAP_SERVICE             BLEUUID((uint16_t)0x1800)
+#define GATTCACHE_DEVICE_NAME             BLEUUID((uint16_t)0x2A00)
+#define GATTCACHE_DEVICE_INFO_SERVICE     BLEUUID((uint16_t)0x180A)
+#define GATTCACHE_MODEL_NUMBER            BLEUUID((uint16_t)0x2A24)
+#define GATTCACHE_FIRMWARE_REVISION       BLEUUID((uint16_t)0x2A26)
+#define GATTCACHE_MANUFACTURER_NAME       BLEUUID((uint16_t)0x2A29)
+
+/*
+   the cached information of a device
+*/
+typedef struct _gattcache_entry {
+  uint64_t addr;
+  time_t updated;                   // time of the last connection
+  bool valid;                       // the device information could be read
+  char name[GATTCACHE_NAME_LENGTH + 1];
+  char model[GATTCACHE_MODEL_LENGTH + 1];
+  char manufacturer[GATTCACHE_MANUFACTURER_LENGTH + 1];
+  char firmware[GATTCACHE_FIRMWARE_LENGTH + 1];
+} GATTCACHE_ENTRY_T;
+
+/*
+   setup the cache and load it from the flash
+*/
+void GattCacheSetup(void);
+
+/*
+   return the cached information of a device, or NULL if there is none
+
+   NOTE: only to be called from the loop, which is the only writer
+*/
+const GATTCACHE_ENTRY_T *GattCacheLookup(const BLEAddress &addr);
+
+/*
+   copy the cached name of a device -- safe to be called from the NimBLE task
+
+   return false if there is none
+*/
+bool GattCacheName(const BLEAddress &addr, char *name, size_t size);
+
+/*
+   return true if the device information should be read again
+*/
+bool GattCacheExpired(const BLEAddress &addr);
+
+/*
+   store the information read from a device
+*/
+void GattCacheUpdate(const BLEAddress &addr, const GATTCACHE_ENTRY_T *entry);
+
+/*
+   return the number of cached devices
+*/
+int GattCacheCount(void);
+
+#endif
+
+/**/
@@ -0,0 +1,281 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to publish the presence of groups of devices
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "mqtt.h"
+#include "group.h"
+#include "util.h"
+
+/*
+   a group is present while any of its members is present, and leaves
+   once all members left plus the grace time
+
+   the members are kept as sorted numbers for a binary search, so a
+   device record resolves its group once and keeps the index
+*/
+static struct {
+  uint64_t addr;
+  int group;
+} _members[CONFIG_GROUPS * CONFIG_GROUP_MEMBERS];
+static int _member_count = 0;
+static uint8_t _generation = 0;
+
+/*
+   the state of the groups
+*/
+static struct {
+  int present_members;        // number of members present
+  bool present;
+  time_t left;                // time the last member left
+  bool publish;
+} _groups[CONFIG_GROUPS];
+
+/*
+   compare two members for qsort
+*/
+static int GroupCompare(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *) a;
+  uint64_t y = *(const uint64_t *) b;
+
+  return (x > y) - (x < y);
+}
+
+/*
+   setup the groups out of the configuration
+*/
+void GroupSetup(void)
+{
+  /*
+     check and correct the config
+  */
+  _config.group.enabled = _config.group.enabled ? true : false;
+  FIX_RANGE(_config.group.count, 0, CONFIG_GROUPS);
+  if (!_config.group.count && !_config.group.grace)
+    _config.group.grace = GROUP_GRACE_DEFAULT;
+  FIX_RANGE(_config.group.grace, GROUP_GRACE_MIN, GROUP_GRACE_MAX);
+
+  /*
+     build the sorted index of the members
+  */
+  _member_count = 0;
+  for (int n = 0; n < _config.group.count; n++) {
+    _config.group.group[n].name[CONFIG_GROUP_NAME_LENGTH - 1] = '\0';
+    FIX_RANGE(_config.group.group[n].members, 0, CONFIG_GROUP_MEMBERS);
+    for (int m = 0; m < _config.group.group[n].members; m++) {
+      _members[_member_count].addr = (uint64_t) BLEAddress(std::string(AddressToString(_config.group.group[n].addr[m], MAC_ADDR_LEN, false, ':')), BLE_ADDR_PUBLIC);
+      _members[_member_count].group = n;
+      _member_count++;
+    }
+  }
+  qsort(_members, _member_count, sizeof(_members[0]), GroupCompare);
+
+  /*
+     the device records will resolve their group again and count their presence
+  */
+  memset(_groups, 0, sizeof(_groups));
+  if (!++_generation)
+    _generation++;
+
+  LogMsg("GROUP: %s with %d groups of %d members", (_config.group.enabled) ? "enabled" : "disabled", _config.group.count, _member_count);
+}
+
+/*
+   return the generation of the group index -- it changes whenever the groups are set up
+*/
+uint8_t GroupGeneration(void)
+{
+  return _generation;
+}
+
+/*
+   return the group of the given address, or GROUP_NONE
+*/
+int GroupLookup(const BLEAddress &addr)
+{
+  uint64_t key = (uint64_t) addr;
+  int low = 0;
+  int high = _member_count - 1;
+  int mid;
+
+  if (!_config.group.enabled)
+    return GROUP_NONE;
+
+  while (low <= high) {
+    mid = low + (high - low) / 2;
+    if (_members[mid].addr < key)
+      low = mid + 1;
+    else if (_members[mid].addr > key)
+      high = mid - 1;
+    else
+      return _members[mid].group;
+  }
+  return GROUP_NONE;
+}
+
+/*
+   a member of a group arrived or left
+*/
+void GroupMember(int group, bool present)
+{
+  if (group < 0 || group >= _config.group.count)
+    return;
+
+  _groups[group].present_members += (present) ? 1 : -1;
+  if (_groups[group].present_members < 0)
+    _groups[group].present_members = 0;
+  if (!_groups[group].present_members)
+    _groups[group].left = now();
+
+#if DBG_GROUP
+  DbgMsg("GROUP: %s: member %s, %d present", _config.group.group[group].name, (present) ? "arrived" : "left", _groups[group].present_members);
+#endif
+}
+
+/*
+   do the cyclic update -- publish the group transitions
+*/
+void GroupUpdate(void)
+{
+  static time_t _last = 0;
+
+  if (!_config.group.enabled || now() <= _last)
+    return;
+  _last = now();
+
+  for (int n = 0; n < _config.group.count; n++) {
+    if (_groups[n].present_members && !_groups[n].present) {
+      /*
+         the first member arrived
+      */
+      _groups[n].present = true;
+      _groups[n].publish = true;
+    }
+    else if (!_groups[n].present_members && _groups[n].present && now() - _groups[n].left >= (time_t) _config.group.grace) {
+      /*
+         all members left and the grace time passed
+      */
+      _groups[n].present = false;
+      _groups[n].publish = true;
+    }
+
+    if (_groups[n].publish) {
+      String json = "\"presence\":\"" + String((_groups[n].present) ? "present" : "absent") + "\","
+                    "\"members\":" + String(_groups[n].present_members) + ","
+                    "\"Scanner\":\"" + String(_config.device.name) + "\"";
+
+      MqttPublishPrefixed("person/" + String(_config.group.group[n].name), "{" + json + "}");
+      _groups[n].publish = false;
+    }
+  }
+}
+
+/*
+   parse a list of groups into the configuration
+
+   each line holds a group as name followed by a colon and the addresses
+   of its members, separated by white spaces, commas or semicolons
+
+   return the number of groups taken over
+*/
+int GroupParse(const char *list)
+{
+  int count = 0;
+
+  while (*list && count < CONFIG_GROUPS) {
+    int len = strcspn(list, "\r\n");
+    const char *colon = (const char *) memchr(list, ':', len);
+
+    /*
+       the name is in front of the first colon -- the addresses contain colons as well
+    */
+    if (colon && strspn(list, " \t") < (size_t) (colon - list)) {
+      const char *name = list + strspn(list, " \t");
+      int name_len = MIN((int) (colon - name), CONFIG_GROUP_NAME_LENGTH - 1);
+      const char *addr = colon + 1;
+      int members = 0;
+
+      while (name_len > 0 && strchr(" \t", name[name_len - 1]))
+        name_len--;
+      memset(_config.group.group[count].name, 0, CONFIG_GROUP_NAME_LENGTH);
+      strncpy(_config.group.group[count].name, name, name_len);
+      for (char *c = _config.group.group[count].name; *c; c++)
+        if (strchr("/+# ", *c))
+          *c = '_';
+
+      while (addr < list + len && members < CONFIG_GROUP_MEMBERS) {
+        addr += strspn(addr, " \t,;");
+
+        int addr_len = MIN((int) strcspn(addr, " \t,;\r\n"), (int) (list + len - addr));
+
+        if (addr_len == 17)
+          memcpy(_config.group.group[count].addr[members++], StringToAddress(addr, MAC_ADDR_LEN, false), MAC_ADDR_LEN);
+        else if (addr_len > 0)
+          LogMsg("GROUP: ignoring invalid address %.*s", addr_len, addr);
+        addr += addr_len;
+      }
+      _config.group.group[count].members = members;
+      count++;
+    }
+    else if (len > (int) strspn(list, " \t"))
+      LogMsg("GROUP: ignoring invalid group %.*s", len, list);
+    list += len;
+    list += strspn(list, "\r\n");
+  }
+  _config.group.count = count;
+
+#if DBG_GROUP
+  DbgMsg("GROUP: parsed %d groups", count);
+#endif
+  return count;
+}
+
+/*
+   return the groups as a string -- one group per line
+*/
+String GroupToString(void)
+{
+  String list = "";
+
+  for (int n = 0; n < _config.group.count && n < CONFIG_GROUPS; n++) {
+    list += String(_config.group.group[n].name) + ":";
+    for (int m = 0; m < _config.group.group[n].members && m < CONFIG_GROUP_MEMBERS; m++)
+      list += String(" ") + AddressToString(_config.group.group[n].addr[m], MAC_ADDR_LEN, false, ':');
+    list += "\n";
+  }
+  return list;
+}
+
+/*
+   get some stats
+*/
+void GroupStats(int *groups, int *present)
+{
+  *groups = _config.group.count;
+  *present = 0;
+  for (int n = 0; n < _config.group.count; n++)
+    if (_groups[n].present)
+      (*present)++;
+}/**/
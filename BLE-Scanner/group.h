@@ -0,0 +1,89 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to publish the presence of groups of devices
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __GROUP_H__
+#define __GROUP_H__ 1
+
+#include <NimBLEDevice.h>
+#include "config.h"
+
+/*
+   ranges of the settings
+*/
+#define GROUP_GRACE_MIN             0             // seconds
+#define GROUP_GRACE_MAX             (60 * 60)
+#define GROUP_GRACE_DEFAULT         (5 * 60)
+
+/*
+   the group index of devices not belonging to a group
+*/
+#define GROUP_NONE                  -1
+
+/*
+   setup the groups out of the configuration
+*/
+void GroupSetup(void);
+
+/*
+   return the generation of the group index -- it changes whenever the groups are set up,
+   and is never 0, which marks a device record with an unresolved group
+*/
+uint8_t GroupGeneration(void);
+
+/*
+   return the group of the given address, or GROUP_NONE
+*/
+int GroupLookup(const BLEAddress &addr);
+
+/*
+   a member of a group arrived or left
+*/
+void GroupMember(int group, bool present);
+
+/*
+   do the cyclic update -- publish the group transitions
+*/
+void GroupUpdate(void);
+
+/*
+   parse a list of groups into the configuration
+
+   return the number of groups taken over
+*/
+int GroupParse(const char *list);
+
+/*
+   return the groups as a string -- one group per line
+*/
+String GroupToString(void);
+
+/*
+   get some stats
+*/
+void GroupStats(int *groups, int *present);
+
+#endif
+
+/**/
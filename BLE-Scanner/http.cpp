@@ -33,6 +33,20 @@
 #include "bluetooth.h"
 #include "watchdog.h"
 #include "scandev.h"
+#include "watchlist.h"
+#include "scheduler.h"
+#include "battery.h"
+#include "gattcache.h"
+#include "resolver.h"
+#include "sensor.h"
+#include "beacon.h"
+#include "presence.h"
+#include "group.h"
+#include "events.h"
+#include "payload.h"
+#include "filter.h"
+#include "dedup.h"
+#include "rule.h"
 
 /*
    the web server object
@@ -52,6 +66,66 @@ static void HttpSendHelper(const String& content)
 */
 static unsigned long _last_http_request = 0;
 
+/*
+   return the scan profiles as options for a selection
+*/
+static String HttpProfileOptions(void)
+{
+  String options = "";
+
+  for (int n = 0; n < BLUETOOTH_PROFILES; n++)
+    options += "<option value='" + String(n) + "'" + ((_config.bluetooth.profile == n) ? " selected" : "") + ">" + BluetoothProfile(n)->title + "</option>";
+  return options;
+}
+
+/*
+   return the statistics of the scan profiles as table rows
+*/
+static String HttpProfileStats(void)
+{
+  String rows = "";
+
+  for (int n = 0; n < BLUETOOTH_PROFILES; n++) {
+    unsigned long adverts_rate;
+    int dupl_ratio;
+
+    BluetoothProfileStats(n, &adverts_rate, &dupl_ratio);
+    rows += "<tr>"
+            "<td>" + String(BluetoothProfile(n)->title) + " Results/Duplicates</td>"
+            "<td>" + String(adverts_rate) + " 1/s / " + String(dupl_ratio) + " %</td>"
+            "</tr>";
+  }
+  return rows;
+}
+
+/*
+   return the deadbands of the sensor metrics as input fields
+*/
+static String HttpSensorDeadbands(void)
+{
+  String fields = "";
+
+  for (int n = 0; n < ADVDECODE_METRICS; n++)
+    fields += "<br>"
+              "<input name='sensor_deadband_abs_" + String(n) + "' type='text' size='6' value='" + String(_config.sensor.deadband_abs[n]) + "'> " + SensorMetricUnit(n) +
+              " / <input name='sensor_deadband_rel_" + String(n) + "' type='text' size='4' value='" + String(_config.sensor.deadband_rel[n]) + "'> &permil; " + SensorMetricName(n);
+  return fields;
+}
+
+/*
+   return the zone thresholds as input fields
+*/
+static String HttpZoneThresholds(void)
+{
+  String fields = "";
+
+  for (int n = 0; n < CONFIG_ZONES; n++)
+    fields += "<br>"
+              "<input name='zone_threshold_" + String(n) + "' type='text' size='5' value='" + String(_config.zone.threshold[n]) + "'> dBm"
+              " &plusmn; <input name='zone_hysteresis_" + String(n) + "' type='text' size='3' value='" + String(_config.zone.hysteresis[n]) + "'> dB " + ScanDevZoneName(SCANDEV_ZONE_IMMEDIATE + n);
+  return fields;
+}
+
 /*
    setup the webserver
 */
@@ -114,6 +188,8 @@ void HttpSetup(void)
                     "body { margin:1rem; padding:0; font-familiy:'sans-serif'; color:#202020; text-align:center; font-size:1rem; }"
                     "input { width:100%; font-size:1rem; box-sizing: border-box; -webkit-box-sizing: border-box; }"
                     "input[type=radio] { width:2rem; }"
+                    "select { width:100%; font-size:1rem; }"
+                    "textarea { width:100%; font-size:1rem; font-family:monospace; box-sizing: border-box; -webkit-box-sizing: border-box; }"
                     "button { border: 0; border-radius: 0.3rem; background: #1881ba; color: #ffffff; line-height: 2.4rem; font-size: 1.2rem; width: 100%; -webkit-transition-duration: 0.5s; transition-duration: 0.5s; cursor: pointer; opacity:0.8; }"
                     "button:hover { opacity: 1.0; }"
                     ".header { text-align:center; }"
@@ -172,11 +248,75 @@ void HttpSetup(void)
       CHECK_AND_SET_STRING(mqtt, topicPrefix);
       CHECK_AND_SET_NUMBER(mqtt, publish_timeout, MQTT_PUBLISH_TIMEOUT_MIN, MQTT_PUBLISH_TIMEOUT_MAX);
       CHECK_AND_SET_BOOL(mqtt, publish_absence);
+      CHECK_AND_SET_BOOL(mqtt, occupancy);
+      CHECK_AND_SET_BOOL(mqtt, sessions);
+      CHECK_AND_SET_BOOL(mqtt, events);
       CHECK_AND_SET_NUMBER(bluetooth, scan_time, BLUETOOTH_SCAN_TIME_MIN, BLUETOOTH_SCAN_TIME_MAX);
       CHECK_AND_SET_NUMBER(bluetooth, pause_time, BLUETOOTH_PAUSE_TIME_MIN, BLUETOOTH_PAUSE_TIME_MAX);
       CHECK_AND_SET_NUMBER(bluetooth, absence_cycles, BLUETOOTH_ABSENCE_CYCLES_MIN, BLUETOOTH_ABSENCE_CYCLES_MAX);
+      CHECK_AND_SET_BOOL(bluetooth, learn_absence);
+      CHECK_AND_SET_NUMBER(bluetooth, absence_target, BLUETOOTH_ABSENCE_TARGET_MIN, BLUETOOTH_ABSENCE_TARGET_MAX);
+      CHECK_AND_SET_BOOL(bluetooth, presence_score);
+      CHECK_AND_SET_NUMBER(bluetooth, presence_enter, 1, 255);
+      CHECK_AND_SET_NUMBER(bluetooth, presence_leave, 0, 254);
       CHECK_AND_SET_NUMBER(bluetooth, activescan_timeout, BLUETOOTH_ACTIVESCAN_TIMEOUT_MIN, BLUETOOTH_ACTIVESCAN_TIMEOUT_MAX);
       CHECK_AND_SET_NUMBER(bluetooth, battcheck_timeout, BLUETOOTH_BATTCHECK_TIMEOUT_MIN, BLUETOOTH_BATTCHECK_TIMEOUT_MAX);
+      CHECK_AND_SET_NUMBER(bluetooth, profile, 0, BLUETOOTH_PROFILES - 1);
+      CHECK_AND_SET_BOOL(bluetooth, continuous);
+      CHECK_AND_SET_BOOL(bluetooth, adaptive);
+      CHECK_AND_SET_NUMBER(bluetooth, scan_time_min, BLUETOOTH_SCAN_TIME_MIN, BLUETOOTH_SCAN_TIME_MAX);
+      CHECK_AND_SET_NUMBER(bluetooth, scan_time_max, BLUETOOTH_SCAN_TIME_MIN, BLUETOOTH_SCAN_TIME_MAX);
+      CHECK_AND_SET_NUMBER(bluetooth, pause_time_min, BLUETOOTH_PAUSE_TIME_MIN, BLUETOOTH_PAUSE_TIME_MAX);
+      CHECK_AND_SET_NUMBER(bluetooth, pause_time_max, BLUETOOTH_PAUSE_TIME_MIN, BLUETOOTH_PAUSE_TIME_MAX);
+      CHECK_AND_SET_NUMBER(bluetooth, cycle_time, BLUETOOTH_CYCLE_TIME_MIN, BLUETOOTH_CYCLE_TIME_MAX);
+      CHECK_AND_SET_BOOL(bluetooth, enrich);
+      CHECK_AND_SET_NUMBER(bluetooth, enrich_ttl, BLUETOOTH_ENRICH_TTL_MIN, BLUETOOTH_ENRICH_TTL_MAX);
+      CHECK_AND_SET_NUMBER(bluetooth, enrich_cache, GATTCACHE_LENGTH_MIN, GATTCACHE_LENGTH_MAX);
+      CHECK_AND_SET_NUMBER(bluetooth, connect_budget, BLUETOOTH_CONNECT_BUDGET_MIN, BLUETOOTH_CONNECT_BUDGET_MAX);
+      CHECK_AND_SET_BOOL(watchlist, enabled);
+      CHECK_AND_SET_BOOL(sensor, enabled);
+      CHECK_AND_SET_NUMBER(sensor, min_interval, SENSOR_MIN_INTERVAL_MIN, SENSOR_MIN_INTERVAL_MAX);
+      CHECK_AND_SET_NUMBER(sensor, heartbeat, SENSOR_HEARTBEAT_MIN, SENSOR_HEARTBEAT_MAX);
+      for (int n = 0; n < ADVDECODE_METRICS; n++) {
+        String abs_name = "sensor_deadband_abs_" + String(n);
+        String rel_name = "sensor_deadband_rel_" + String(n);
+
+        if (_WebServer.hasArg(abs_name))
+          _config.sensor.deadband_abs[n] = CHECK_RANGE(atoi(_WebServer.arg(abs_name).c_str()), 0, SENSOR_DEADBAND_ABS_MAX);
+        if (_WebServer.hasArg(rel_name))
+          _config.sensor.deadband_rel[n] = CHECK_RANGE(atoi(_WebServer.arg(rel_name).c_str()), 0, SENSOR_DEADBAND_REL_MAX);
+      }
+      CHECK_AND_SET_BOOL(beacon, enabled);
+      CHECK_AND_SET_BOOL(zone, enabled);
+      CHECK_AND_SET_BOOL(group, enabled);
+      CHECK_AND_SET_NUMBER(group, grace, GROUP_GRACE_MIN, GROUP_GRACE_MAX);
+      if (_WebServer.hasArg("group_list"))
+        GroupParse(_WebServer.arg("group_list").c_str());
+      CHECK_AND_SET_BOOL(payload, enabled);
+      if (_WebServer.hasArg("payload_fields"))
+        PayloadParseFields(_WebServer.arg("payload_fields").c_str());
+      if (_WebServer.hasArg("payload_aliases"))
+        PayloadParseAliases(_WebServer.arg("payload_aliases").c_str());
+      CHECK_AND_SET_BOOL(filter, enabled);
+      CHECK_AND_SET_STRING(filter, rule);
+      CHECK_AND_SET_BOOL(dedup, enabled);
+      CHECK_AND_SET_STRING(dedup, topic);
+      CHECK_AND_SET_NUMBER(dedup, hysteresis, DEDUP_HYSTERESIS_MIN, DEDUP_HYSTERESIS_MAX);
+      CHECK_AND_SET_NUMBER(dedup, dwell, DEDUP_DWELL_MIN, DEDUP_DWELL_MAX);
+      CHECK_AND_SET_NUMBER(dedup, timeout, DEDUP_TIMEOUT_MIN, DEDUP_TIMEOUT_MAX);
+      for (int n = 0; n < CONFIG_ZONES; n++) {
+        String threshold_name = "zone_threshold_" + String(n);
+        String hysteresis_name = "zone_hysteresis_" + String(n);
+
+        if (_WebServer.hasArg(threshold_name))
+          _config.zone.threshold[n] = CHECK_RANGE(atoi(_WebServer.arg(threshold_name).c_str()), SCANDEV_ZONE_RSSI_MIN, SCANDEV_ZONE_RSSI_MAX);
+        if (_WebServer.hasArg(hysteresis_name))
+          _config.zone.hysteresis[n] = CHECK_RANGE(atoi(_WebServer.arg(hysteresis_name).c_str()), 0, SCANDEV_ZONE_HYSTERESIS_MAX);
+      }
+      if (_WebServer.hasArg("beacon_regions"))
+        BeaconParseRegions(_WebServer.arg("beacon_regions").c_str());
+      if (_WebServer.hasArg("watchlist_addr"))
+        WatchlistParse(_WebServer.arg("watchlist_addr").c_str());
 
       /*
          write the config back
@@ -190,6 +330,14 @@ void HttpSetup(void)
         NtpSetup();
         MqttSetup();
         BluetoothSetup();
+        BatterySetup();
+        SensorSetup();
+        BeaconSetup();
+        ScanDevSetup();
+        GroupSetup();
+        PayloadSetup();
+        FilterSetup();
+        DedupSetup();
         WatchdogSetup(_config.bluetooth.scan_time);
       }
     }
@@ -201,6 +349,13 @@ void HttpSetup(void)
                     "<form action='/config/ntp' method='get'><button>Configure NTP</button></form><p>"
                     "<form action='/config/mqtt' method='get'><button>Configure MQTT</button></form><p>"
                     "<form action='/config/bluetooth' method='get'><button>Configure Bluetooth</button></form><p>"
+                    "<form action='/config/sensor' method='get'><button>Configure Sensors</button></form><p>"
+                    "<form action='/config/beacon' method='get'><button>Configure Beacons</button></form><p>"
+                    "<form action='/config/zone' method='get'><button>Configure Zones</button></form><p>"
+                    "<form action='/config/group' method='get'><button>Configure Persons</button></form><p>"
+                    "<form action='/config/payload' method='get'><button>Configure Payload</button></form><p>"
+                    "<form action='/config/filter' method='get'><button>Configure Filter</button></form><p>"
+                    "<form action='/config/dedup' method='get'><button>Configure Scanner Cooperation</button></form><p>"
                     "<form action='/config/reset' method='get' onsubmit=\"return confirm('Are you sure to reset the configuration?');\"><button class='button redbg'>Reset configuration</button></form><p>"
                     "<p><form action='/' method='get'><button>Main Menu</button></form><p>"
                     + _html_footer);
@@ -369,6 +524,39 @@ void HttpSetup(void)
                     "<b>Note:</b> Selecting <i>Publish only presence</i> might help if multiple scanners are publishing to the same object."
                     "</p>"
 
+                    "<p>"
+                    "<b>Publishing of Devices</b>"
+                    "<br>"
+                    "<input name='mqtt_occupancy' type='radio' value='0'" + (_config.mqtt.occupancy ? "" : " checked") + "> Publish each device" +
+                    "<br>"
+                    "<input name='mqtt_occupancy' type='radio' value='1'" + (_config.mqtt.occupancy ? " checked" : "") + "> Publish only the number of present devices" +
+                    "<br>"
+                    "<b>Note:</b> In occupancy mode, the number of present devices per manufacturer and zone is published once per cycle below <i>" + _config.mqtt.topicPrefix + "/occupancy</i>, and nothing per device."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Publishing of Visits</b>"
+                    "<br>"
+                    "<input name='mqtt_sessions' type='radio' value='0'" + (_config.mqtt.sessions ? "" : " checked") + "> Publish the device state &amp; a record per visit" +
+                    "<br>"
+                    "<input name='mqtt_sessions' type='radio' value='1'" + (_config.mqtt.sessions ? " checked" : "") + "> Publish only a record per visit" +
+                    "<br>"
+                    "<b>Note:</b> Once a device left, its visit is published below <i>ADDRESS/session</i> with start, end, dwell time, maximum RSSI and number of sightings."
+                    " A visit is only published if the device matched the filter rule, and with the scanner cooperation only by the owner of the device."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Event Stream</b>"
+                    "<br>"
+                    "<input name='mqtt_events' type='radio' value='0'" + (_config.mqtt.events ? "" : " checked") + "> Off" +
+                    "<br>"
+                    "<input name='mqtt_events' type='radio' value='1'" + (_config.mqtt.events ? " checked" : "") + "> Publish numbered arrivals &amp; departures" +
+                    "<br>"
+                    "<b>Note:</b> Each arrival and departure is published with a sequence number below <i>" + _config.mqtt.topicPrefix + "/events</i>. "
+                    "A digest of the present devices is published every " + String(EVENTS_ALIVE_CYCLE) + " s below <i>" + _config.mqtt.topicPrefix + "/alive</i>. "
+                    "On a gap or a mismatch, publish to <i>" + _config.mqtt.topicPrefix + "/control/snapshot</i> to get the present devices with their sequence number &amp; digest published below <i>" + _config.mqtt.topicPrefix + "/snapshot</i>."
+                    "</p>"
+
                     "<p>"
                     "<b>Publishing Timeout (" + MQTT_PUBLISH_TIMEOUT_MIN + " s - " + MQTT_PUBLISH_TIMEOUT_MAX + " s)</b>"
                     "<br>"
@@ -395,7 +583,25 @@ void HttpSetup(void)
                     "<legend>"
                     "<b>&nbsp;Bluetooth&nbsp;</b>"
                     "</legend>"
-                    "<form method='get' action='/config'>"
+                    "<form method='post' action='/config'>"
+
+                    "<p>"
+                    "<b>Scan Mode</b>"
+                    "<br>"
+                    "<input name='bluetooth_continuous' type='radio' value='0'" + (_config.bluetooth.continuous ? "" : " checked") + "> Scan &amp; pause cycles" +
+                    "<br>"
+                    "<input name='bluetooth_continuous' type='radio' value='1'" + (_config.bluetooth.continuous ? " checked" : "") + "> Continuous scan" +
+                    "<br>"
+                    "<b>Note:</b> In continuous mode the scan is never stopped, scan &amp; pause time are not used."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Virtual Cycle Time (" + BLUETOOTH_CYCLE_TIME_MIN + " s - " + BLUETOOTH_CYCLE_TIME_MAX + " s)</b>"
+                    "<br>"
+                    "<input name='bluetooth_cycle_time' type='text' placeholder='Bluetooth virtual cycle time' value='" + String(_config.bluetooth.cycle_time) + "'>"
+                    "<br>"
+                    "<b>Note:</b> Only used in continuous mode: after each cycle the duplicate filter is reset."
+                    "</p>"
 
                     "<p>"
                     "<b>LE Scan Time (" + BLUETOOTH_SCAN_TIME_MIN + " s - " + BLUETOOTH_SCAN_TIME_MAX + " s; 0=off)</b>"
@@ -409,12 +615,63 @@ void HttpSetup(void)
                     "<input name='bluetooth_pause_time' type='text' placeholder='Bluetooth pause time' value='" + String(_config.bluetooth.pause_time) + "'>"
                     "</p>"
 
+                    "<p>"
+                    "<b>Adaptive Scan &amp; Pause Time</b>"
+                    "<br>"
+                    "<input name='bluetooth_adaptive' type='radio' value='0'" + (_config.bluetooth.adaptive ? "" : " checked") + "> Fixed times" +
+                    "<br>"
+                    "<input name='bluetooth_adaptive' type='radio' value='1'" + (_config.bluetooth.adaptive ? " checked" : "") + "> Adapt to arrivals &amp; departures" +
+                    "<br>"
+                    "<b>Scan Time Min/Max</b>"
+                    "<br>"
+                    "<input name='bluetooth_scan_time_min' type='text' placeholder='Minimum scan time' value='" + String(_config.bluetooth.scan_time_min) + "'>"
+                    "<input name='bluetooth_scan_time_max' type='text' placeholder='Maximum scan time' value='" + String(_config.bluetooth.scan_time_max) + "'>"
+                    "<br>"
+                    "<b>Pause Time Min/Max</b>"
+                    "<br>"
+                    "<input name='bluetooth_pause_time_min' type='text' placeholder='Minimum pause time' value='" + String(_config.bluetooth.pause_time_min) + "'>"
+                    "<input name='bluetooth_pause_time_max' type='text' placeholder='Maximum pause time' value='" + String(_config.bluetooth.pause_time_max) + "'>"
+                    "<br>"
+                    "<b>Note:</b> Busy cycles lengthen the scans and shorten the pauses, quiet cycles do the opposite."
+                    "</p>"
+
                     "<p>"
                     "<b>Absence Timeout Cycles (" + BLUETOOTH_ABSENCE_CYCLES_MIN + " - " + BLUETOOTH_ABSENCE_CYCLES_MAX + ")</b>"
                     "<br>"
                     "<input name='bluetooth_absence_cycles' type='text' placeholder='Bluetooth absence timeout cycles' value='" + String(_config.bluetooth.absence_cycles) + "'>"
                     "<br>"
-                    "<b>Note:</b> One cycle is the sum of the time values above."
+                    "<b>Note:</b> One cycle is the sum of scan &amp; pause time, or the virtual cycle time in continuous mode."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Absence Timeout per Device</b>"
+                    "<br>"
+                    "<input name='bluetooth_learn_absence' type='radio' value='0'" + (_config.bluetooth.learn_absence ? "" : " checked") + "> Use the absence timeout cycles for all devices" +
+                    "<br>"
+                    "<input name='bluetooth_learn_absence' type='radio' value='1'" + (_config.bluetooth.learn_absence ? " checked" : "") + "> Learn the absence timeout from the detection rate of each device" +
+                    "<br>"
+                    "<b>False Absence Rate (" + BLUETOOTH_ABSENCE_TARGET_MIN + " - " + BLUETOOTH_ABSENCE_TARGET_MAX + " &permil;)</b>"
+                    "<br>"
+                    "<input name='bluetooth_absence_target' type='text' placeholder='False absence rate' value='" + String(_config.bluetooth.absence_target) + "'>"
+                    "<br>"
+                    "<b>Note:</b> Devices detected in every cycle are set absent sooner, devices missed in some cycles later."
+                    " A device uses its learned timeout after " + SCANDEV_LEARN_CYCLES + " cycles, up to " + SCANDEV_ABSENCE_CYCLES_MAX + " cycles."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Presence Detection</b>"
+                    "<br>"
+                    "<input name='bluetooth_presence_score' type='radio' value='0'" + (_config.bluetooth.presence_score ? "" : " checked") + "> Present when seen, absent after the timeout" +
+                    "<br>"
+                    "<input name='bluetooth_presence_score' type='radio' value='1'" + (_config.bluetooth.presence_score ? " checked" : "") + "> Presence score with hysteresis" +
+                    "<br>"
+                    "<b>Enter &amp; Leave Score (0 - 255)</b>"
+                    "<br>"
+                    "<input name='bluetooth_presence_enter' type='text' size='4' value='" + String(_config.bluetooth.presence_enter) + "'>"
+                    " / <input name='bluetooth_presence_leave' type='text' size='4' value='" + String(_config.bluetooth.presence_leave) + "'>"
+                    "<br>"
+                    "<b>Note:</b> Each sighting raises the score of a device by " + (PRESENCE_GAIN_WEAK >> 8) + " to " + (PRESENCE_GAIN_STRONG >> 8) + " depending on the RSSI, the score is kept while the device is seen once per cycle and decays to the leave score with the missed cycles of the absence timeout."
+                    " A device becomes present once its score reaches the enter score, and absent once it falls to the leave score."
                     "</p>"
 
                     "<p>"
@@ -423,12 +680,377 @@ void HttpSetup(void)
                     "<input name='bluetooth_activescan_timeout' type='text' placeholder='Active Scan Timeout' value='" + String(_config.bluetooth.activescan_timeout) + "'>"
                     "<br>"
                     "<b>Note:</b> If this timeout is reached, the next scan will be an active scan. Otherwise only passive scans will be performed."
+                    " While there are devices without a name, each scan starts with a short active burst."
                     "</p>"
 
                     "<p>"
                     "<b>Battery Check Timeout (" + BLUETOOTH_BATTCHECK_TIMEOUT_MIN + " s - " + BLUETOOTH_BATTCHECK_TIMEOUT_MAX + " s)</b>"
                     "<br>"
                     "<input name='bluetooth_battcheck_timeout' type='text' placeholder='Battery Check Timeout' value='" + String(_config.bluetooth.battcheck_timeout) + "'>"
+                    "<br>"
+                    "<b>Note:</b> An advertised battery level is taken over directly. Otherwise the battery level is read while the scan pauses, which is not done in continuous scan mode."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Device Information</b>"
+                    "<br>"
+                    "<input name='bluetooth_enrich' type='radio' value='0'" + (_config.bluetooth.enrich ? "" : " checked") + "> Don't read" +
+                    "<br>"
+                    "<input name='bluetooth_enrich' type='radio' value='1'" + (_config.bluetooth.enrich ? " checked" : "") + "> Read name, model, manufacturer &amp; firmware of connectable devices" +
+                    "<br>"
+                    "<b>Cache Time (" + BLUETOOTH_ENRICH_TTL_MIN + " s - " + BLUETOOTH_ENRICH_TTL_MAX + " s)</b>"
+                    "<br>"
+                    "<input name='bluetooth_enrich_ttl' type='text' placeholder='Device information cache time' value='" + String(_config.bluetooth.enrich_ttl) + "'>"
+                    "<br>"
+                    "<b>Cached Devices (" + GATTCACHE_LENGTH_MIN + " - " + GATTCACHE_LENGTH_MAX + ")</b>"
+                    "<br>"
+                    "<input name='bluetooth_enrich_cache' type='text' placeholder='Cached devices' value='" + String(_config.bluetooth.enrich_cache) + "'>"
+                    "<br>"
+                    "<b>Connections per Minute (" + BLUETOOTH_CONNECT_BUDGET_MIN + " - " + BLUETOOTH_CONNECT_BUDGET_MAX + ")</b>"
+                    "<br>"
+                    "<input name='bluetooth_connect_budget' type='text' placeholder='Connections per minute' value='" + String(_config.bluetooth.connect_budget) + "'>"
+                    "<br>"
+                    "<b>Note:</b> The device information is kept in the flash, so a device is only contacted again once its cache entry expired."
+                    " Up to " + String(GATTCACHE_NVS_LENGTH) + " devices are kept in the flash, the others only until the next restart."
+                    " When the cache is full, the device seen least recently is dropped."
+                    " The connections per minute apply to the battery checks as well."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Scan Profile</b>"
+                    "<br>"
+                    "<select name='bluetooth_profile'>" + HttpProfileOptions() + "</select>"
+                    "<br>"
+                    "<b>Note:</b> The profile sets the scan interval &amp; window, the duplicate filter and the active scan cadence."
+                    " It can also be changed temporarily via MQTT."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Watchlist</b>"
+                    "<br>"
+                    "<input name='watchlist_enabled' type='radio' value='0'" + (_config.watchlist.enabled ? "" : " checked") + "> Scan all devices" +
+                    "<br>"
+                    "<input name='watchlist_enabled' type='radio' value='1'" + (_config.watchlist.enabled ? " checked" : "") + "> Scan only devices on the watchlist" +
+                    "<br>"
+                    "<textarea name='watchlist_addr' rows='8' placeholder='aa:bb:cc:dd:ee:ff'>" + WatchlistToString() + "</textarea>"
+                    "<br>"
+                    "<b>Note:</b> Up to " + CONFIG_WATCHLIST_LENGTH + " addresses, one per line."
+                    " Lists with up to " + WATCHLIST_CONTROLLER_MAX + " addresses are filtered by the Bluetooth controller, longer lists by the scanner itself."
+                    "</p>"
+
+                    "<button name='save' type='submit' class='button greenbg'>Speichern</button>"
+                    "</form>"
+                    "</fieldset>"
+                    "<p><form action='/config' method='get'><button>Configuration Menu</button></form><p>"
+                    + _html_footer);
+  });
+
+  _WebServer.on("/config/sensor", []() {
+    if (!StateCheck(STATE_CONFIGURING) && _config.device.password[0] && !_WebServer.authenticate(HTTP_WEB_USER, _config.device.password))
+      return _WebServer.requestAuthentication();
+
+    _last_http_request = millis();
+    _WebServer.send(200, "text/html",
+                    _html_header +
+                    "<fieldset>"
+                    "<legend>"
+                    "<b>&nbsp;Sensors&nbsp;</b>"
+                    "</legend>"
+                    "<form method='post' action='/config'>"
+
+                    "<p>"
+                    "<b>Sensor Values</b>"
+                    "<br>"
+                    "<input name='sensor_enabled' type='radio' value='0'" + (_config.sensor.enabled ? "" : " checked") + "> Don't publish" +
+                    "<br>"
+                    "<input name='sensor_enabled' type='radio' value='1'" + (_config.sensor.enabled ? " checked" : "") + "> Publish the values of BTHome &amp; Ruuvi sensors" +
+                    "<br>"
+                    "<b>Note:</b> Each value is published to its own topic below the address of the sensor, even for sensors using random addresses."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Minimum Interval (" + SENSOR_MIN_INTERVAL_MIN + " s - " + SENSOR_MIN_INTERVAL_MAX + " s)</b>"
+                    "<br>"
+                    "<input name='sensor_min_interval' type='text' placeholder='Minimum interval' value='" + String(_config.sensor.min_interval) + "'>"
+                    "<br>"
+                    "<b>Heartbeat Interval (" + SENSOR_HEARTBEAT_MIN + " s - " + SENSOR_HEARTBEAT_MAX + " s)</b>"
+                    "<br>"
+                    "<input name='sensor_heartbeat' type='text' placeholder='Heartbeat interval' value='" + String(_config.sensor.heartbeat) + "'>"
+                    "<br>"
+                    "<b>Note:</b> A changed value is published at most once per minimum interval, an unchanged value once per heartbeat interval."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Deadbands (absolute / relative)</b>"
+                    + HttpSensorDeadbands() +
+                    "<br>"
+                    "<b>Note:</b> A value is only published if it differs by more than the larger of both deadbands from the last published value."
+                    "</p>"
+
+                    "<button name='save' type='submit' class='button greenbg'>Speichern</button>"
+                    "</form>"
+                    "</fieldset>"
+                    "<p><form action='/config' method='get'><button>Configuration Menu</button></form><p>"
+                    + _html_footer);
+  });
+
+  _WebServer.on("/config/beacon", []() {
+    if (!StateCheck(STATE_CONFIGURING) && _config.device.password[0] && !_WebServer.authenticate(HTTP_WEB_USER, _config.device.password))
+      return _WebServer.requestAuthentication();
+
+    _last_http_request = millis();
+    _WebServer.send(200, "text/html",
+                    _html_header +
+                    "<fieldset>"
+                    "<legend>"
+                    "<b>&nbsp;Beacons&nbsp;</b>"
+                    "</legend>"
+                    "<form method='post' action='/config'>"
+
+                    "<p>"
+                    "<b>iBeacons</b>"
+                    "<br>"
+                    "<input name='beacon_enabled' type='radio' value='0'" + (_config.beacon.enabled ? "" : " checked") + "> Handle like any other device" +
+                    "<br>"
+                    "<input name='beacon_enabled' type='radio' value='1'" + (_config.beacon.enabled ? " checked" : "") + "> Track by UUID, major &amp; minor" +
+                    "<br>"
+                    "<b>Note:</b> Tracked beacons are published below <i>beacon/UUID-major-minor</i> and no longer show up as devices, so beacons rotating their address are seen as one."
+                    " Up to " + BEACON_LOAD_MAX + " beacons are tracked."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Regions</b>"
+                    "<br>"
+                    "<textarea name='beacon_regions' rows='8' placeholder='E2C56DB5-DFFB-48D2-B060-D0F5A71096E0'>" + BeaconRegionsToString() + "</textarea>"
+                    "<br>"
+                    "<b>Note:</b> Up to " + CONFIG_BEACON_REGIONS + " UUIDs, one per line."
+                    " A region is present below <i>region/UUID</i> as long as any beacon with its UUID is present."
+                    "</p>"
+
+                    "<button name='save' type='submit' class='button greenbg'>Speichern</button>"
+                    "</form>"
+                    "</fieldset>"
+                    "<p><form action='/config' method='get'><button>Configuration Menu</button></form><p>"
+                    + _html_footer);
+  });
+
+  _WebServer.on("/config/zone", []() {
+    if (!StateCheck(STATE_CONFIGURING) && _config.device.password[0] && !_WebServer.authenticate(HTTP_WEB_USER, _config.device.password))
+      return _WebServer.requestAuthentication();
+
+    _last_http_request = millis();
+    _WebServer.send(200, "text/html",
+                    _html_header +
+                    "<fieldset>"
+                    "<legend>"
+                    "<b>&nbsp;Zones&nbsp;</b>"
+                    "</legend>"
+                    "<form method='post' action='/config'>"
+
+                    "<p>"
+                    "<b>Proximity Zones</b>"
+                    "<br>"
+                    "<input name='zone_enabled' type='radio' value='0'" + (_config.zone.enabled ? "" : " checked") + "> Publish each RSSI change" +
+                    "<br>"
+                    "<input name='zone_enabled' type='radio' value='1'" + (_config.zone.enabled ? " checked" : "") + "> Publish zone transitions" +
+                    "<br>"
+                    "<b>Note:</b> Zone transitions are published below <i>ADDRESS/zone</i>, the RSSI is then only published with the complete device state."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Thresholds (" + SCANDEV_ZONE_RSSI_MIN + " dBm - " + SCANDEV_ZONE_RSSI_MAX + " dBm) &amp; Hysteresis (0 dB - " + SCANDEV_ZONE_HYSTERESIS_MAX + " dB)</b>"
+                    + HttpZoneThresholds() +
+                    "<br>"
+                    "<b>Note:</b> A device is in the closest zone whose threshold its smoothed RSSI reaches, otherwise it is remote."
+                    " To change the zone, the RSSI has to pass the threshold by the hysteresis."
+                    "</p>"
+
+                    "<button name='save' type='submit' class='button greenbg'>Speichern</button>"
+                    "</form>"
+                    "</fieldset>"
+                    "<p><form action='/config' method='get'><button>Configuration Menu</button></form><p>"
+                    + _html_footer);
+  });
+
+  _WebServer.on("/config/group", []() {
+    if (!StateCheck(STATE_CONFIGURING) && _config.device.password[0] && !_WebServer.authenticate(HTTP_WEB_USER, _config.device.password))
+      return _WebServer.requestAuthentication();
+
+    _last_http_request = millis();
+    _WebServer.send(200, "text/html",
+                    _html_header +
+                    "<fieldset>"
+                    "<legend>"
+                    "<b>&nbsp;Persons&nbsp;</b>"
+                    "</legend>"
+                    "<form method='post' action='/config'>"
+
+                    "<p>"
+                    "<b>Person Presence</b>"
+                    "<br>"
+                    "<input name='group_enabled' type='radio' value='0'" + (_config.group.enabled ? "" : " checked") + "> Don't publish" +
+                    "<br>"
+                    "<input name='group_enabled' type='radio' value='1'" + (_config.group.enabled ? " checked" : "") + "> Publish the presence of persons carrying several devices" +
+                    "<br>"
+                    "<textarea name='group_list' rows='8' placeholder='name: aa:bb:cc:dd:ee:ff aa:bb:cc:dd:ee:ff'>" + GroupToString() + "</textarea>"
+                    "<br>"
+                    "<b>Note:</b> Up to " + CONFIG_GROUPS + " persons with up to " + CONFIG_GROUP_MEMBERS + " devices each, one person per line."
+                    " A person is published below <i>" + _config.mqtt.topicPrefix + "/person/name</i>, and is present while any of the devices is present."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Grace Time (" + GROUP_GRACE_MIN + " s - " + GROUP_GRACE_MAX + " s)</b>"
+                    "<br>"
+                    "<input name='group_grace' type='text' placeholder='Grace time' value='" + String(_config.group.grace) + "'>"
+                    "<br>"
+                    "<b>Note:</b> A person leaves once all devices left and the grace time passed."
+                    "</p>"
+
+                    "<button name='save' type='submit' class='button greenbg'>Speichern</button>"
+                    "</form>"
+                    "</fieldset>"
+                    "<p><form action='/config' method='get'><button>Configuration Menu</button></form><p>"
+                    + _html_footer);
+  });
+
+  _WebServer.on("/config/payload", []() {
+    if (!StateCheck(STATE_CONFIGURING) && _config.device.password[0] && !_WebServer.authenticate(HTTP_WEB_USER, _config.device.password))
+      return _WebServer.requestAuthentication();
+
+    String fields = "";
+
+    for (int n = 0; n < PAYLOAD_FIELDS; n++)
+      fields += String((n) ? ", " : "") + "<i>" + PayloadFieldName(n) + "</i>";
+
+    _last_http_request = millis();
+    _WebServer.send(200, "text/html",
+                    _html_header +
+                    "<fieldset>"
+                    "<legend>"
+                    "<b>&nbsp;Payload&nbsp;</b>"
+                    "</legend>"
+                    "<form method='post' action='/config'>"
+
+                    "<p>"
+                    "<b>Published Fields</b>"
+                    "<br>"
+                    "<input name='payload_enabled' type='radio' value='0'" + (_config.payload.enabled ? "" : " checked") + "> Publish all fields" +
+                    "<br>"
+                    "<input name='payload_enabled' type='radio' value='1'" + (_config.payload.enabled ? " checked" : "") + "> Publish only the selected fields" +
+                    "<br>"
+                    "<textarea name='payload_fields' rows='8' placeholder='* presence RSSI'>" + PayloadFieldsToString() + "</textarea>"
+                    "<br>"
+                    "<b>Note:</b> The line starting with <i>*</i> selects the fields of all devices, followed by up to " + CONFIG_PAYLOAD_DEVICES + " lines starting with the address of a device selecting its own fields."
+                    " The fields are " + fields + ", where <i>Frame</i> is the decoded beacon frame."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Aliases</b>"
+                    "<br>"
+                    "<textarea name='payload_aliases' rows='4' placeholder='RSSI=r'>" + PayloadAliasesToString() + "</textarea>"
+                    "<br>"
+                    "<b>Note:</b> Each line gives a field a shorter key of up to " + String(CONFIG_PAYLOAD_ALIAS_LENGTH - 1) + " characters, e.g. <i>presence=p</i>."
+                    "</p>"
+
+                    "<button name='save' type='submit' class='button greenbg'>Speichern</button>"
+                    "</form>"
+                    "</fieldset>"
+                    "<p><form action='/config' method='get'><button>Configuration Menu</button></form><p>"
+                    + _html_footer);
+  });
+
+  _WebServer.on("/config/filter", []() {
+    if (!StateCheck(STATE_CONFIGURING) && _config.device.password[0] && !_WebServer.authenticate(HTTP_WEB_USER, _config.device.password))
+      return _WebServer.requestAuthentication();
+
+    String names = "";
+
+    for (int n = 0; n < RULE_VARS; n++)
+      names += String((n) ? ", " : "") + "<i>" + RuleVarName(n) + "</i>";
+
+    _last_http_request = millis();
+    _WebServer.send(200, "text/html",
+                    _html_header +
+                    "<fieldset>"
+                    "<legend>"
+                    "<b>&nbsp;Filter&nbsp;</b>"
+                    "</legend>"
+                    "<form method='post' action='/config'>"
+
+                    "<p>"
+                    "<b>Published Devices</b>"
+                    "<br>"
+                    "<input name='filter_enabled' type='radio' value='0'" + (_config.filter.enabled ? "" : " checked") + "> Publish all devices" +
+                    "<br>"
+                    "<input name='filter_enabled' type='radio' value='1'" + (_config.filter.enabled ? " checked" : "") + "> Publish only the devices matching the rule" +
+                    "<br>"
+                    "<input name='filter_rule' type='text' maxlength='" + String(CONFIG_FILTER_LENGTH - 1) + "' placeholder='rssi > -80 &amp;&amp; manufacturer == 0x004C &amp;&amp; present' value='" + String(_config.filter.rule) + "'>"
+                    "<br>"
+                    + (*FilterError() ? "<b>Error:</b> " + String(FilterError()) + "<br>" : String("")) +
+                    "<b>Note:</b> The rule compares the values " + names + " with numbers, combined by <i>&amp;&amp;</i>, <i>||</i>, <i>!</i> and parentheses."
+                    " The rule can also be set by publishing it to <i>" + _config.mqtt.topicPrefix + "/control/rule</i>."
+                    "</p>"
+
+                    "<button name='save' type='submit' class='button greenbg'>Speichern</button>"
+                    "</form>"
+                    "</fieldset>"
+                    "<p><form action='/config' method='get'><button>Configuration Menu</button></form><p>"
+                    + _html_footer);
+  });
+
+  _WebServer.on("/config/dedup", []() {
+    if (!StateCheck(STATE_CONFIGURING) && _config.device.password[0] && !_WebServer.authenticate(HTTP_WEB_USER, _config.device.password))
+      return _WebServer.requestAuthentication();
+
+    _last_http_request = millis();
+    _WebServer.send(200, "text/html",
+                    _html_header +
+                    "<fieldset>"
+                    "<legend>"
+                    "<b>&nbsp;Scanner Cooperation&nbsp;</b>"
+                    "</legend>"
+                    "<form method='post' action='/config'>"
+
+                    "<p>"
+                    "<b>Publishing of Devices seen by several Scanners</b>"
+                    "<br>"
+                    "<input name='dedup_enabled' type='radio' value='0'" + (_config.dedup.enabled ? "" : " checked") + "> Publish all devices" +
+                    "<br>"
+                    "<input name='dedup_enabled' type='radio' value='1'" + (_config.dedup.enabled ? " checked" : "") + "> Publish only the devices received best by this scanner" +
+                    "<br>"
+                    "<b>Note:</b> The scanners publish their claims on the devices to a shared topic, and the scanner receiving a device best publishes it. "
+                    "Give all scanners the same topic and different MQTT client IDs. "
+                    "Up to " + String(CLAIM_CAPACITY) + " devices are claimed, further devices are published by every scanner seeing them."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Claims Topic</b>"
+                    "<br>"
+                    "<input name='dedup_topic' type='text' placeholder='Claims topic' value='" + String(_config.dedup.topic) + "'>"
+                    "</p>"
+
+                    "<p>"
+                    "<b>Hysteresis (" + DEDUP_HYSTERESIS_MIN + " dB - " + DEDUP_HYSTERESIS_MAX + " dB)</b>"
+                    "<br>"
+                    "<input name='dedup_hysteresis' type='text' placeholder='Hysteresis' value='" + String(_config.dedup.hysteresis) + "'>"
+                    "<br>"
+                    "<b>Note:</b> A scanner takes over a device once its smoothed RSSI is stronger than the one of the owner by the hysteresis."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Dwell Time (" + DEDUP_DWELL_MIN + " s - " + DEDUP_DWELL_MAX + " s)</b>"
+                    "<br>"
+                    "<input name='dedup_dwell' type='text' placeholder='Dwell time' value='" + String(_config.dedup.dwell) + "'>"
+                    "<br>"
+                    "<b>Note:</b> The RSSI has to be stronger by the hysteresis for the dwell time, so a device between two scanners doesn't change its owner with each fluctuation."
+                    "</p>"
+
+                    "<p>"
+                    "<b>Timeout (" + DEDUP_TIMEOUT_MIN + " s - " + DEDUP_TIMEOUT_MAX + " s)</b>"
+                    "<br>"
+                    "<input name='dedup_timeout' type='text' placeholder='Timeout' value='" + String(_config.dedup.timeout) + "'>"
+                    "<br>"
+                    "<b>Note:</b> The owner repeats its claim every third of the timeout. Once the owner didn't claim a device for the timeout, another scanner takes over."
                     "</p>"
 
                     "<button name='save' type='submit' class='button greenbg'>Speichern</button>"
@@ -474,6 +1096,62 @@ void HttpSetup(void)
 
     NtpStats(&ntp_requests,&ntp_replies_total,&ntp_replies_good);
 
+    unsigned long adverts_total,adverts_filtered,adverts_rate;
+
+    BluetoothStats(&adverts_total,&adverts_filtered,&adverts_rate);
+
+    unsigned long adverts_fast,adverts_slow;
+
+    ScanDevFastPathStats(&adverts_fast,&adverts_slow);
+
+    unsigned long battery_advertised,battery_checks,battery_failures,battery_enriched;
+    int battery_queued;
+
+    BatteryStats(&battery_advertised,&battery_checks,&battery_failures,&battery_enriched,&battery_queued);
+
+    int resolver_pending;
+    unsigned long resolver_bursts,resolver_resolved,resolver_failed;
+
+    ResolverStats(&resolver_pending,&resolver_bursts,&resolver_resolved,&resolver_failed);
+    String resolver_list = ResolverToString();
+
+    int sensor_count;
+    unsigned long sensor_samples,sensor_published;
+
+    SensorStats(&sensor_count,&sensor_samples,&sensor_published);
+
+    int beacon_count,beacon_present,beacon_regions;
+    unsigned long beacon_rotations,beacon_dropped;
+
+    BeaconStats(&beacon_count,&beacon_present,&beacon_regions,&beacon_rotations,&beacon_dropped);
+
+    int group_count,group_present;
+
+    GroupStats(&group_count,&group_present);
+
+    uint32_t events_seq,events_digest;
+    int events_present;
+    unsigned long events_dropped;
+    char events_hex[9];
+
+    EventsStats(&events_seq,&events_present,&events_digest,&events_dropped);
+
+    unsigned long payload_published,payload_saved;
+
+    PayloadStats(&payload_published,&payload_saved);
+
+    unsigned long filter_evaluated,filter_matched;
+
+    FilterStats(&filter_evaluated,&filter_matched);
+
+    int dedup_devices,dedup_owned,dedup_capacity;
+    unsigned long dedup_dropped,dedup_takeovers,dedup_losses,dedup_sent,dedup_received;
+
+    DedupStats(&dedup_devices,&dedup_owned,&dedup_capacity,&dedup_dropped,&dedup_takeovers,&dedup_losses,&dedup_sent,&dedup_received);
+    snprintf(events_hex, sizeof(events_hex), "%08x", (unsigned int) events_digest);
+
+    resolver_list.replace("\n", "<br>");
+
     _WebServer.send(200, "text/html",
                     _html_header +
                     "<div class='info'>"
@@ -492,6 +1170,10 @@ void HttpSetup(void)
                     "<td>Device Name</td>"
                     "<td>" + String(_config.device.name) + "</td>"
                     "</tr>"
+                    "<tr>"
+                    "<td>Free Heap (Minimum)</td>"
+                    "<td>" + String(ESP.getFreeHeap()) + " (" + String(ESP.getMinFreeHeap()) + ") Bytes</td>"
+                    "</tr>"
 
                     "<tr><th colspan=2>WiFi</th></tr>"
                     "<tr>"
@@ -591,9 +1273,33 @@ void HttpSetup(void)
                     "<td>" + _config.mqtt.publish_timeout + " s</td>"
                     "</tr>"
                     "<tr>"
+                    "<td>Event Sequence/Present/Digest/Dropped</td>"
+                    "<td>" + (_config.mqtt.events ? String(events_seq) + "/" + String(events_present) + "/" + String(events_hex) + "/" + String(events_dropped) : String("off")) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Payload Bytes Published/Saved per Hour</td>"
+                    "<td>" + (_config.payload.enabled ? String(payload_published) + "/" + String(payload_saved) : String("all fields")) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Filter Evaluated/Matched</td>"
+                    "<td>" + (_config.filter.enabled ? String(filter_evaluated) + "/" + String(filter_matched) : String("all devices")) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Claimed Devices/Owned, Capacity/Dropped</td>"
+                    "<td>" + (_config.dedup.enabled ? String(dedup_devices) + "/" + String(dedup_owned) + ", " + String(dedup_capacity) + "/" + String(dedup_dropped) : String("off")) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Claims Sent/Received, Takeovers/Losses</td>"
+                    "<td>" + (_config.dedup.enabled ? String(dedup_sent) + "/" + String(dedup_received) + ", " + String(dedup_takeovers) + "/" + String(dedup_losses) : String("off")) + "</td>"
+                    "</tr>"
+                    "<tr>"
 
                     "<tr><th colspan=2>Bluetooth</th></tr>"
                     "<tr>"
+                    "<td>Scan Mode</td>"
+                    "<td>" + (_config.bluetooth.continuous ? "continuous with a virtual cycle of " + String(_config.bluetooth.cycle_time) + " s" : String("scan &amp; pause cycles")) + "</td>"
+                    "</tr>"
+                    "<tr>"
                     "<td>LE Scan Time</td>"
                     "<td>" + _config.bluetooth.scan_time + " s</td>"
                     "</tr>"
@@ -602,6 +1308,18 @@ void HttpSetup(void)
                     "<td>" + _config.bluetooth.pause_time + " s</td>"
                     "</tr>"
                     "<tr>"
+                    "<td>Adaptive Scan/Pause Time</td>"
+                    "<td>" + (_config.bluetooth.adaptive ? String(SchedulerScanTime()) + " s / " + String(SchedulerPauseTime()) + " s (" + SchedulerReason() + ")" : String("disabled")) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Duty Cycle</td>"
+                    "<td>" + String(SchedulerDutyCycle()) + " %</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Scan Coverage (last hour)</td>"
+                    "<td>" + ((BluetoothCoverage() < 0) ? String("-") : String(BluetoothCoverage()) + " %") + "</td>"
+                    "</tr>"
+                    "<tr>"
                     "<td>Active Scan Timeout</td>"
                     "<td>" + _config.bluetooth.activescan_timeout + " s</td>"
                     "</tr>"
@@ -609,9 +1327,82 @@ void HttpSetup(void)
                     "<td>Absence Timeout Cycles</td>"
                     "<td>" + _config.bluetooth.absence_cycles + "</td>"
                     "</tr>"
+                    "<tr>"
+                    "<td>Devices with learned Absence Timeout</td>"
+                    "<td>" + (_config.bluetooth.learn_absence ? String(ScanDevCountLearned()) : String("disabled")) + "</td>"
+                    "</tr>"
                     "<td>Battery Check Timeout</td>"
                     "<td>" + _config.bluetooth.battcheck_timeout + " s</td>"
                     "</tr>"
+                    "<tr>"
+                    "<td>Battery Levels Advertised</td>"
+                    "<td>" + String(battery_advertised) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Battery Checks Total/Failed/Queued</td>"
+                    "<td>" + String(battery_checks) + "/" + String(battery_failures) + "/" + String(battery_queued) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Device Information</td>"
+                    "<td>" + (_config.bluetooth.enrich ? String(battery_enriched) + " reads, " + String(GattCacheCount()) + " devices cached" : String("disabled")) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Connections per Minute</td>"
+                    "<td>" + String(_config.bluetooth.connect_budget) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Name Resolution Bursts/Resolved/Failed</td>"
+                    "<td>" + String(resolver_bursts) + "/" + String(resolver_resolved) + "/" + String(resolver_failed) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Devices without Name</td>"
+                    "<td>" + String(resolver_pending) + ((resolver_pending) ? "<br>" + resolver_list : String("")) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Sensors</td>"
+                    "<td>" + (_config.sensor.enabled ? String(sensor_count) : String("disabled")) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Sensor Values Published/Suppressed</td>"
+                    "<td>" + String(sensor_published) + "/" + String(sensor_samples - sensor_published) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Persons Present</td>"
+                    "<td>" + (_config.group.enabled ? String(group_present) + "/" + String(group_count) : String("disabled")) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Beacons Tracked/Present</td>"
+                    "<td>" + (_config.beacon.enabled ? String(beacon_count) + "/" + String(beacon_present) : String("disabled")) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Beacon Regions Present</td>"
+                    "<td>" + String(beacon_regions) + "/" + String(_config.beacon.regions) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Beacon Address Rotations/Dropped</td>"
+                    "<td>" + String(beacon_rotations) + "/" + String(beacon_dropped) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Scan Profile</td>"
+                    "<td>" + BluetoothProfile(BluetoothProfileCurrent())->title + "</td>"
+                    "</tr>"
+                    + HttpProfileStats() +
+                    "<tr>"
+                    "<td>Watchlist</td>"
+                    "<td>" + (WatchlistEnabled() ? String(WatchlistCount()) + " addresses filtered by the " + (WatchlistControllerFiltering() ? "controller" : "host") : String("disabled")) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Scan Results Total/Filtered</td>"
+                    "<td>" + String(adverts_total) + "/" + String(adverts_filtered) + "</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Scan Results Rate</td>"
+                    "<td>" + String(adverts_rate) + " 1/s</td>"
+                    "</tr>"
+                    "<tr>"
+                    "<td>Unchanged Scan Results (Fast Path)</td>"
+                    "<td>" + String(adverts_fast) + " (" + String((adverts_fast + adverts_slow) ? adverts_fast * 100 / (adverts_fast + adverts_slow) : 0) + " %)</td>"
+                    "</tr>"
 
                     "</table>"
                     "</div>"
@@ -28,6 +28,11 @@
 #include "wifi.h"
 #include "util.h"
 #include "ntp.h"
+#include "bluetooth.h"
+#include "scheduler.h"
+#include "filter.h"
+#include "dedup.h"
+#include "events.h"
 
 /*
    MQTT context
@@ -40,6 +45,61 @@ static time_t _last_reconnect = 0;
 static time_t _last_status_update = 0;
 static bool _publish_all = true;
 
+/*
+   a consumer requested a snapshot of all devices, as its digest didn't match
+*/
+static bool MqttSnapshot(const char *value)
+{
+  _publish_all = true;
+  EventsSnapshot();
+  return true;
+}
+
+/*
+   commands which can be received on the control topic
+
+   the command is the last part of the topic, the value is the payload
+*/
+static const struct {
+  const char *command;
+  bool (*handler)(const char *value);
+} _control_commands[] = {
+  { "profile", BluetoothProfileSelect },
+  { "snapshot", MqttSnapshot },
+  { "rule", FilterSelect },
+};
+
+/*
+   handle a message received on the control topic or on the claims topic
+*/
+static void MqttControl(char *topic, byte *payload, unsigned int length)
+{
+  char value[MQTT_CONTROL_VALUE_LENGTH + 1];
+  const char *command = topic + _topic_control.length();
+
+  if (DedupReceive(topic, payload, length))
+    return;
+  if (strncmp(topic, _topic_control.c_str(), _topic_control.length()) || *command++ != '/')
+    return;
+
+  length = MIN(length, MQTT_CONTROL_VALUE_LENGTH);
+  memcpy(value, payload, length);
+  value[length] = '\0';
+
+#if DBG_MQTT
+  DbgMsg("MQTT: control command received: %s=%s", command, value);
+#endif
+
+  for (int n = 0; n < sizeof(_control_commands) / sizeof(_control_commands[0]); n++) {
+    if (!strcmp(_control_commands[n].command, command)) {
+      if (!(*_control_commands[n].handler)(value))
+        LogMsg("MQTT: control command %s failed for value %s", command, value);
+      return;
+    }
+  }
+  LogMsg("MQTT: unknown control command %s", command);
+}
+
 /*
    initialize the MQTT context
 */
@@ -52,6 +112,9 @@ void MqttSetup(void)
     _config.mqtt.port = MQTT_PORT_DEFAULT;
   FIX_RANGE(_config.mqtt.port,MQTT_PORT_MIN, MQTT_PORT_MAX);
   _config.mqtt.publish_absence = _config.mqtt.publish_absence ? true : false;
+  _config.mqtt.occupancy = _config.mqtt.occupancy ? true : false;
+  _config.mqtt.sessions = _config.mqtt.sessions ? true : false;
+  _config.mqtt.events = _config.mqtt.events ? true : false;
   FIX_RANGE(_config.mqtt.publish_timeout, MQTT_PUBLISH_TIMEOUT_MIN, MQTT_PUBLISH_TIMEOUT_MAX);
 
   if (StateCheck(STATE_CONFIGURING))
@@ -61,6 +124,7 @@ void MqttSetup(void)
 
   _mqtt = new PubSubClient(_wifiClient);
   _mqtt->setServer(_config.mqtt.server, _config.mqtt.port);
+  _mqtt->setCallback(MqttControl);
 
   _topic_announce = String(_config.mqtt.topicPrefix) + MQTT_TOPIC_ANNOUNCE;
   _topic_control = String(_config.mqtt.topicPrefix) + MQTT_TOPIC_CONTROL;
@@ -106,7 +170,9 @@ void MqttUpdate(void)
         _mqtt->publish((_topic_announce + "/state").c_str(), "connected", true);
 
         // ... and resubscribe
-        _mqtt->subscribe(_topic_control.c_str());
+        _mqtt->subscribe((_topic_control + "/#").c_str());
+        if (DedupTopic())
+          _mqtt->subscribe(DedupTopic());
         _last_status_update = 0;
       }
       else {
@@ -144,6 +210,7 @@ void MqttUpdate(void)
                     "\"Time\":\"" + String(TimeToString(now())) + "\","
                     "\"Uptime\":\"" + String(TimeToString(NtpUptime())) + "\","
                     "\"UptimeSec\":" + String(NtpUptime()) + ","
+                    "\"Heap\":" + String(ESP.getFreeHeap()) + ","
                     "\"Wifi\":{"
                     "\"SSId\":\"" + WifiGetSSID() + "\","
                     "\"MacAddress\":\"" + WifiGetMacAddr() + "\","
@@ -152,6 +219,8 @@ void MqttUpdate(void)
                     "\"RSSI\":" + WifiGetRSSI() + ","
                     "\"Signal\":\"" + String(WIFI_RSSI_TO_QUALITY(WifiGetRSSI())) + "%\""
                     "},"
+                    "\"Bluetooth\":{" + BluetoothStatus() + "},"
+                    "\"Scheduler\":{" + SchedulerStatus() + "},"
                     "\"Version\":\"" + GIT_VERSION + "\""
                     "}";
 #if DBG_MQTT
@@ -180,6 +249,13 @@ bool MqttPublishAll(void)
 */
 void MqttPublish(String suffix, String msg)
 {
+  if (_config.mqtt.occupancy) {
+    /*
+       nothing is published per device in occupancy mode
+    */
+    return;
+  }
+
   String topic = _topic_device + String("/") + suffix;
 
 #if DBG_MQTT
@@ -187,4 +263,33 @@ void MqttPublish(String suffix, String msg)
 #endif
 
   _mqtt->publish_P(topic.c_str(), msg.c_str(), msg.length());
+}
+
+/*
+   publish the given message below the topic prefix instead of the device topic
+*/
+void MqttPublishPrefixed(String suffix, String msg)
+{
+  String topic = String(_config.mqtt.topicPrefix) + String("/") + suffix;
+
+#if DBG_MQTT
+  DbgMsg("MQTT: publishing: %s=%s", topic.c_str(), msg.c_str());
+#endif
+
+  _mqtt->publish_P(topic.c_str(), msg.c_str(), msg.length());
+}
+
+/*
+   publish a binary message to the given topic
+*/
+void MqttPublishBinary(const char *topic, const uint8_t *payload, unsigned int length)
+{
+  if (StateCheck(STATE_CONFIGURING) || !_mqtt->connected())
+    return;
+
+#if DBG_MQTT
+  DbgMsg("MQTT: publishing: %s=%u bytes", topic, length);
+#endif
+
+  _mqtt->publish(topic, payload, length, false);
 }/**/
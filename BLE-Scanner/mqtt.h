@@ -40,6 +40,11 @@
 #define MQTT_TOPIC_CONTROL        "/control"
 #define MQTT_TOPIC_DEVICE         "/device"
 
+/*
+   maximum length of a value received via the control topic
+*/
+#define MQTT_CONTROL_VALUE_LENGTH 128
+
 #define MQTT_PUBLISH_TIMEOUT_MIN  10            // seconds
 #define MQTT_PUBLISH_TIMEOUT_MAX  (60 * 60)
 
@@ -71,10 +76,22 @@ void MqttUpdate(void);
 bool MqttPublishAll(void);
 
 /*
-   publish the given message
+   publish the given message below the device topic
+
+   nothing is published in occupancy mode
 */
 void MqttPublish(String suffix, String msg);
 
+/*
+   publish the given message below the topic prefix instead of the device topic
+*/
+void MqttPublishPrefixed(String suffix, String msg);
+
+/*
+   publish a binary message to the given topic -- it isn't retained, and dropped if not connected
+*/
+void MqttPublishBinary(const char *topic, const uint8_t *payload, unsigned int length);
+
 #endif
 
 /**/
@@ -0,0 +1,170 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to count the present devices
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "mqtt.h"
+#include "ble-manufacturer.h"
+#include "scandev.h"
+#include "occupancy.h"
+#include "util.h"
+
+/*
+   the counts are changed whenever a device changes its state, so
+   publishing them doesn't need to walk through the device list
+
+   in occupancy mode nothing is published per device, see MqttPublish()
+
+   the counts are changed from the scan callbacks and from the loop, so
+   they are only touched within the lock
+*/
+static_assert(OCCUPANCY_ZONES == SCANDEV_ZONE_REMOTE + 1, "zones don't match");
+
+static int _present = 0;
+static int _zones[OCCUPANCY_ZONES];
+static struct {
+  uint16_t id;
+  int count;
+} _manufacturers[OCCUPANCY_MANUFACTURERS];
+static int _other = 0;
+static portMUX_TYPE _occupancy_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/*
+   count a device of a manufacturer -- return its bucket
+*/
+static int8_t OccupancyAddManufacturer(uint16_t id)
+{
+  int free = -1;
+
+  for (int n = 0; n < OCCUPANCY_MANUFACTURERS; n++) {
+    if (_manufacturers[n].count && _manufacturers[n].id == id) {
+      _manufacturers[n].count++;
+      return n;
+    }
+    if (!_manufacturers[n].count && free < 0)
+      free = n;
+  }
+  if (free >= 0) {
+    _manufacturers[free].id = id;
+    _manufacturers[free].count = 1;
+    return free;
+  }
+  _other++;
+  return OCCUPANCY_OTHER;
+}
+
+/*
+   take a device from the bucket it was counted in
+*/
+static void OccupancyRemoveManufacturer(int8_t bucket)
+{
+  if (bucket >= 0 && bucket < OCCUPANCY_MANUFACTURERS)
+    _manufacturers[bucket].count = MAX(_manufacturers[bucket].count - 1, 0);
+  else
+    _other = MAX(_other - 1, 0);
+}
+
+/*
+   a device arrived (delta 1) or left (delta -1)
+*/
+void OccupancyCount(int8_t *bucket, uint16_t manufacturer_id, int zone, int delta)
+{
+  portENTER_CRITICAL(&_occupancy_mux);
+  _present = MAX(_present + delta, 0);
+  if (zone >= 0 && zone < OCCUPANCY_ZONES)
+    _zones[zone] = MAX(_zones[zone] + delta, 0);
+  if (delta > 0)
+    *bucket = OccupancyAddManufacturer(manufacturer_id);
+  else
+    OccupancyRemoveManufacturer(*bucket);
+  portEXIT_CRITICAL(&_occupancy_mux);
+}
+
+/*
+   a present device changed its manufacturer
+*/
+void OccupancyManufacturer(int8_t *bucket, uint16_t to)
+{
+  portENTER_CRITICAL(&_occupancy_mux);
+  OccupancyRemoveManufacturer(*bucket);
+  *bucket = OccupancyAddManufacturer(to);
+  portEXIT_CRITICAL(&_occupancy_mux);
+}
+
+/*
+   a present device changed its zone
+*/
+void OccupancyZone(int from, int to)
+{
+  portENTER_CRITICAL(&_occupancy_mux);
+  if (from >= 0 && from < OCCUPANCY_ZONES)
+    _zones[from] = MAX(_zones[from] - 1, 0);
+  if (to >= 0 && to < OCCUPANCY_ZONES)
+    _zones[to]++;
+  portEXIT_CRITICAL(&_occupancy_mux);
+}
+
+/*
+   publish the counts -- called once per cycle
+*/
+void OccupancyPublish(void)
+{
+  int present, zones[OCCUPANCY_ZONES], other;
+  struct {
+    uint16_t id;
+    int count;
+  } manufacturers[OCCUPANCY_MANUFACTURERS];
+
+  if (!_config.mqtt.occupancy)
+    return;
+
+  /*
+     take a consistent copy of the counts, the JSON is built outside of the lock
+  */
+  portENTER_CRITICAL(&_occupancy_mux);
+  present = _present;
+  memcpy(zones, _zones, sizeof(zones));
+  memcpy(manufacturers, _manufacturers, sizeof(manufacturers));
+  other = _other;
+  portEXIT_CRITICAL(&_occupancy_mux);
+
+  String json = "\"present\":" + String(present);
+
+  if (_config.zone.enabled) {
+    json += ",\"zones\":{";
+    for (int n = SCANDEV_ZONE_IMMEDIATE; n < OCCUPANCY_ZONES; n++)
+      json += String((n > SCANDEV_ZONE_IMMEDIATE) ? "," : "") + "\"" + ScanDevZoneName(n) + "\":" + String(zones[n]);
+    json += "}";
+  }
+
+  json += ",\"manufacturers\":{";
+  for (int n = 0; n < OCCUPANCY_MANUFACTURERS; n++)
+    if (manufacturers[n].count > 0)
+      json += "\"" + String(BLEManufacturerLookup(manufacturers[n].id, BLEManufacturerIdHex(manufacturers[n].id))) + "\":" + String(manufacturers[n].count) + ",";
+  json += "\"other\":" + String(other) + "}";
+
+  json += ",\"Scanner\":\"" + String(_config.device.name) + "\"";
+
+  MqttPublishPrefixed("occupancy", "{" + json + "}");
+}/**/
@@ -0,0 +1,67 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to count the present devices
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __OCCUPANCY_H__
+#define __OCCUPANCY_H__ 1
+
+#include "config.h"
+
+/*
+   number of manufacturers counted on their own -- all others are counted as other
+*/
+#define OCCUPANCY_MANUFACTURERS     16
+
+/*
+   the bucket of the devices counted as other
+*/
+#define OCCUPANCY_OTHER             -1
+
+/*
+   number of zones, see SCANDEV_ZONE
+*/
+#define OCCUPANCY_ZONES             5
+
+/*
+   a device arrived (delta 1) or left (delta -1)
+
+   an arriving device gets the bucket of its manufacturer, and is taken
+   from the same bucket when it leaves
+*/
+void OccupancyCount(int8_t *bucket, uint16_t manufacturer_id, int zone, int delta);
+
+/*
+   a present device changed its manufacturer or its zone
+*/
+void OccupancyManufacturer(int8_t *bucket, uint16_t to);
+void OccupancyZone(int from, int to);
+
+/*
+   publish the counts -- called once per cycle
+*/
+void OccupancyPublish(void);
+
+#endif
+
+/**/
@@ -0,0 +1,517 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to compile the published fields of the devices into an emit plan
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "mqtt.h"
+#include "ble-manufacturer.h"
+#include "gattcache.h"
+#include "advdecode.h"
+#include "payload.h"
+#include "util.h"
+
+/*
+   the field masks and the aliases are compiled into one emit plan per
+   mask when the configuration is set up, so publishing a device just
+   runs the steps of its plan -- each step holds the writer of its field,
+   the reason to publish it and the key, already quoted
+
+   the fields not selected stay in the plan to count the bytes saved,
+   without being written
+*/
+#define PAYLOAD_KEY_LENGTH    20
+
+typedef size_t (*PAYLOAD_WRITER_T)(String *json, const char *key, const SCANDEV_T *device);
+
+typedef struct _payload_step {
+  PAYLOAD_WRITER_T write;
+  uint8_t dirty;                    // the reasons to publish the field
+  bool emit;                        // the field is selected
+  uint8_t shrink;                   // bytes saved by the alias
+  char key[PAYLOAD_KEY_LENGTH];
+} PAYLOAD_STEP_T;
+
+typedef struct _payload_plan {
+  int head;                         // number of steps in front of the changed fields
+  PAYLOAD_STEP_T step[PAYLOAD_FIELDS];
+} PAYLOAD_PLAN_T;
+
+static PAYLOAD_PLAN_T _plans[1 + CONFIG_PAYLOAD_DEVICES];
+static uint64_t _addrs[CONFIG_PAYLOAD_DEVICES];
+static uint8_t _generation = 0;
+
+/*
+   bytes published and saved
+*/
+static unsigned long _published = 0;
+static unsigned long _saved = 0;
+static unsigned long _published_hour = 0;
+static unsigned long _saved_hour = 0;
+static time_t _hour_start = 0;
+
+/*
+   write a member -- without a JSON string, only its length is returned
+*/
+static size_t PayloadNumber(String *json, const char *key, long value)
+{
+  char number[16];
+  int len = snprintf(number, sizeof(number), "%ld", value);
+
+  if (json) {
+    if (json->length() > 0)
+      *json += ",";
+    *json += key;
+    *json += number;
+  }
+  return strlen(key) + len + 1;
+}
+
+static size_t PayloadString(String *json, const char *key, const char *value)
+{
+  if (json) {
+    if (json->length() > 0)
+      *json += ",";
+    *json += key;
+    *json += "\"";
+    *json += value;
+    *json += "\"";
+  }
+  return strlen(key) + strlen(value) + 3;
+}
+
+/*
+   the writers of the fields
+*/
+static size_t PayloadPresence(String *json, const char *key, const SCANDEV_T *device)
+{
+  return PayloadString(json, key, (device->present) ? "present" : "absent");
+}
+
+static size_t PayloadLastSeen(String *json, const char *key, const SCANDEV_T *device)
+{
+  return PayloadNumber(json, key, device->last_seen);
+}
+
+static size_t PayloadScanner(String *json, const char *key, const SCANDEV_T *device)
+{
+  return PayloadString(json, key, _config.device.name);
+}
+
+static size_t PayloadScannerCID(String *json, const char *key, const SCANDEV_T *device)
+{
+  return PayloadString(json, key, _config.mqtt.clientID);
+}
+
+static size_t PayloadRSSI(String *json, const char *key, const SCANDEV_T *device)
+{
+  return PayloadNumber(json, key, device->rssi);
+}
+
+static size_t PayloadAdvInterval(String *json, const char *key, const SCANDEV_T *device)
+{
+  return (device->interval) ? PayloadNumber(json, key, device->interval) : 0;
+}
+
+static size_t PayloadName(String *json, const char *key, const SCANDEV_T *device)
+{
+  return PayloadString(json, key, device->name);
+}
+
+static size_t PayloadManufacturerId(String *json, const char *key, const SCANDEV_T *device)
+{
+  return PayloadString(json, key, BLEManufacturerIdHex(device->manufacturer_id));
+}
+
+static size_t PayloadManufacturer(String *json, const char *key, const SCANDEV_T *device)
+{
+  return PayloadString(json, key, (device->manufacturer) ? device->manufacturer : "");
+}
+
+static size_t PayloadBattery(String *json, const char *key, const SCANDEV_T *device)
+{
+  return PayloadNumber(json, key, device->has_battery ? 1 : 0);
+}
+
+static size_t PayloadBatteryLevel(String *json, const char *key, const SCANDEV_T *device)
+{
+  return PayloadNumber(json, key, device->battery_level);
+}
+
+static size_t PayloadModel(String *json, const char *key, const SCANDEV_T *device)
+{
+  const GATTCACHE_ENTRY_T *entry = GattCacheLookup(device->addr);
+
+  return (entry && entry->valid) ? PayloadString(json, key, entry->model) : 0;
+}
+
+static size_t PayloadManufacturerName(String *json, const char *key, const SCANDEV_T *device)
+{
+  const GATTCACHE_ENTRY_T *entry = GattCacheLookup(device->addr);
+
+  return (entry && entry->valid) ? PayloadString(json, key, entry->manufacturer) : 0;
+}
+
+static size_t PayloadFirmware(String *json, const char *key, const SCANDEV_T *device)
+{
+  const GATTCACHE_ENTRY_T *entry = GattCacheLookup(device->addr);
+
+  return (entry && entry->valid) ? PayloadString(json, key, entry->firmware) : 0;
+}
+
+static size_t PayloadFrame(String *json, const char *key, const SCANDEV_T *device)
+{
+  /*
+     the decoded frame brings its own key
+  */
+  String frame = AdvDecodeToJSON(&device->frame);
+
+  if (frame.length() == 0)
+    return 0;
+  if (json) {
+    if (json->length() > 0)
+      *json += ",";
+    *json += frame;
+  }
+  return frame.length() + 1;
+}
+
+/*
+   the fields in the order they are published -- presence, last_seen and
+   the scanner are published in front, whenever any other field is published
+*/
+static const struct {
+  const char *name;
+  PAYLOAD_WRITER_T write;
+  uint8_t dirty;
+} _fields[PAYLOAD_FIELDS] = {
+  { "presence", PayloadPresence, PAYLOAD_DIRTY_PRESENCE },
+  { "last_seen", PayloadLastSeen, PAYLOAD_DIRTY_META },
+  { "Scanner", PayloadScanner, PAYLOAD_DIRTY_META },
+  { "ScannerCID", PayloadScannerCID, PAYLOAD_DIRTY_META },
+  { "RSSI", PayloadRSSI, PAYLOAD_DIRTY_RSSI },
+  { "AdvInterval", PayloadAdvInterval, PAYLOAD_DIRTY_RSSI },
+  { "Name", PayloadName, PAYLOAD_DIRTY_NAME },
+  { "ManufacturerId", PayloadManufacturerId, PAYLOAD_DIRTY_MANUFACTURER },
+  { "Manufacturer", PayloadManufacturer, PAYLOAD_DIRTY_MANUFACTURER },
+  { "Battery", PayloadBattery, PAYLOAD_DIRTY_BATTERY },
+  { "BatteryLevel", PayloadBatteryLevel, PAYLOAD_DIRTY_BATTERY },
+  { "Model", PayloadModel, PAYLOAD_DIRTY_INFO },
+  { "ManufacturerName", PayloadManufacturerName, PAYLOAD_DIRTY_INFO },
+  { "Firmware", PayloadFirmware, PAYLOAD_DIRTY_INFO },
+  { "Frame", PayloadFrame, PAYLOAD_DIRTY_FRAME },
+};
+
+static_assert(PAYLOAD_FIELDS <= CONFIG_PAYLOAD_FIELDS, "too many fields for the configuration");
+
+/*
+   compile a field mask into an emit plan
+*/
+static void PayloadCompile(PAYLOAD_PLAN_T *plan, uint16_t mask)
+{
+  plan->head = 0;
+  for (int n = 0; n < PAYLOAD_FIELDS; n++) {
+    PAYLOAD_STEP_T *step = &plan->step[n];
+    const char *key = _fields[n].name;
+
+    step->write = _fields[n].write;
+    step->dirty = _fields[n].dirty;
+    step->emit = (mask & (1 << n)) ? true : false;
+    step->shrink = 0;
+    if (step->emit && _config.payload.alias[n][0] && n != PAYLOAD_FIELD_FRAME) {
+      key = _config.payload.alias[n];
+      step->shrink = MAX((int) strlen(_fields[n].name) - (int) strlen(key), 0);
+    }
+    snprintf(step->key, sizeof(step->key), "\"%s\":", key);
+    if (_fields[n].dirty & (PAYLOAD_DIRTY_PRESENCE | PAYLOAD_DIRTY_META))
+      plan->head = n + 1;
+  }
+}
+
+/*
+   setup the emit plans out of the configuration
+*/
+void PayloadSetup(void)
+{
+  /*
+     check and correct the config
+  */
+  _config.payload.enabled = _config.payload.enabled ? true : false;
+  if (!_config.payload.mask)
+    _config.payload.mask = PAYLOAD_FIELDS_ALL;
+  FIX_RANGE(_config.payload.count, 0, CONFIG_PAYLOAD_DEVICES);
+  for (int n = 0; n < CONFIG_PAYLOAD_FIELDS; n++) {
+    char *alias = _config.payload.alias[n];
+
+    alias[CONFIG_PAYLOAD_ALIAS_LENGTH - 1] = '\0';
+    for (char *c = alias; *c; c++)
+      if (strchr("\"\\ ,=", *c) || *c < ' ')
+        *c = '_';
+  }
+
+  /*
+     compile the plans -- without masks, all fields are published with their names
+  */
+  PayloadCompile(&_plans[PAYLOAD_PLAN_DEFAULT], (_config.payload.enabled) ? _config.payload.mask : PAYLOAD_FIELDS_ALL);
+  for (int n = 0; n < _config.payload.count; n++) {
+    _addrs[n] = (uint64_t) BLEAddress(std::string(AddressToString(_config.payload.device[n].addr, MAC_ADDR_LEN, false, ':')), BLE_ADDR_PUBLIC);
+    PayloadCompile(&_plans[1 + n], _config.payload.device[n].mask);
+  }
+
+  /*
+     the device records will resolve their plan again
+  */
+  if (!++_generation)
+    _generation++;
+
+  LogMsg("PAYLOAD: %s with %d devices of their own", (_config.payload.enabled) ? "enabled" : "disabled", _config.payload.count);
+}
+
+/*
+   return the generation of the emit plans -- it changes whenever the plans are set up
+*/
+uint8_t PayloadGeneration(void)
+{
+  return _generation;
+}
+
+/*
+   return the emit plan of the given address
+*/
+int PayloadLookup(const BLEAddress &addr)
+{
+  uint64_t key = (uint64_t) addr;
+
+  if (_config.payload.enabled)
+    for (int n = 0; n < _config.payload.count; n++)
+      if (_addrs[n] == key)
+        return 1 + n;
+  return PAYLOAD_PLAN_DEFAULT;
+}
+
+/*
+   run the steps of a plan
+*/
+static void PayloadRun(const PAYLOAD_STEP_T *step, const PAYLOAD_STEP_T *end, String *json, const SCANDEV_T *device, uint8_t dirty)
+{
+  for (; step < end; step++) {
+    if (!(step->dirty & dirty))
+      continue;
+    if (step->emit) {
+      if ((*step->write)(json, step->key, device))
+        _saved += step->shrink;
+    }
+    else
+      _saved += (*step->write)(NULL, step->key, device);
+  }
+}
+
+/*
+   serialize the fields of a device by running its emit plan
+*/
+String PayloadSerialize(const SCANDEV_T *device, int plan, uint8_t dirty)
+{
+  const PAYLOAD_PLAN_T *p = &_plans[(plan >= 0 && plan <= _config.payload.count) ? plan : PAYLOAD_PLAN_DEFAULT];
+  String head = "";
+  String json = "";
+
+  if (now() - _hour_start >= 60 * 60) {
+    /*
+       an hour passed
+    */
+    if (_hour_start && _config.payload.enabled)
+      LogMsg("PAYLOAD: %lu bytes published, %lu bytes saved in the last hour", _published, _saved);
+    _published_hour = _published;
+    _saved_hour = _saved;
+    _published = _saved = 0;
+    _hour_start = now();
+  }
+
+  /*
+     the changed fields first, as they decide on the fields in front
+  */
+  PayloadRun(&p->step[p->head], &p->step[PAYLOAD_FIELDS], &json, device, dirty);
+  if (json.length() > 0)
+    dirty |= PAYLOAD_DIRTY_META | PAYLOAD_DIRTY_PRESENCE;
+  if (dirty & PAYLOAD_DIRTY_META)
+    dirty |= PAYLOAD_DIRTY_PRESENCE;
+  if (!device->present && !_config.mqtt.publish_absence)
+    dirty &= ~PAYLOAD_DIRTY_PRESENCE;
+  PayloadRun(&p->step[0], &p->step[p->head], &head, device, dirty);
+
+  if (head.length() > 0 && json.length() > 0)
+    head += ",";
+  head += json;
+  if (head.length() > 0)
+    _published += head.length() + 2;
+
+#if DBG_PAYLOAD
+  DbgMsg("PAYLOAD: plan %d, dirty 0x%02x: %s", plan, dirty, head.c_str());
+#endif
+  return head;
+}
+
+/*
+   return the field of the given name, or -1
+*/
+static int PayloadField(const char *name, int len)
+{
+  for (int n = 0; n < PAYLOAD_FIELDS; n++)
+    if ((int) strlen(_fields[n].name) == len && !strncasecmp(_fields[n].name, name, len))
+      return n;
+  LogMsg("PAYLOAD: ignoring unknown field %.*s", len, name);
+  return -1;
+}
+
+/*
+   parse a list of field names into a mask
+*/
+static uint16_t PayloadParseMask(const char *list, int len)
+{
+  const char *end = list + len;
+  uint16_t mask = 0;
+
+  while (list < end) {
+    list += strspn(list, " \t,;");
+
+    int name_len = MIN((int) strcspn(list, " \t,;\r\n"), (int) (end - list));
+    int field = (name_len > 0) ? PayloadField(list, name_len) : -1;
+
+    if (field >= 0)
+      mask |= 1 << field;
+    list += name_len;
+  }
+  return mask;
+}
+
+/*
+   parse the field masks into the configuration
+*/
+int PayloadParseFields(const char *list)
+{
+  int count = 0;
+
+  while (*list) {
+    int len = strcspn(list, "\r\n");
+    const char *word = list + strspn(list, " \t");
+    int word_len = MIN((int) strcspn(word, " \t\r\n"), (int) (list + len - word));
+
+    if (word_len == 1 && *word == '*')
+      _config.payload.mask = PayloadParseMask(word + 1, list + len - word - 1);
+    else if (word_len == 17 && count < CONFIG_PAYLOAD_DEVICES) {
+      memcpy(_config.payload.device[count].addr, StringToAddress(word, MAC_ADDR_LEN, false), MAC_ADDR_LEN);
+      _config.payload.device[count].mask = PayloadParseMask(word + word_len, list + len - word - word_len);
+      count++;
+    }
+    else if (word_len > 0)
+      LogMsg("PAYLOAD: ignoring invalid line %.*s", len, list);
+    list += len;
+    list += strspn(list, "\r\n");
+  }
+  _config.payload.count = count;
+
+#if DBG_PAYLOAD
+  DbgMsg("PAYLOAD: parsed %d devices", count);
+#endif
+  return count;
+}
+
+/*
+   return a mask as a list of field names
+*/
+static String PayloadMaskToString(uint16_t mask)
+{
+  String list = "";
+
+  for (int n = 0; n < PAYLOAD_FIELDS; n++)
+    if (mask & (1 << n))
+      list += String(" ") + _fields[n].name;
+  return list;
+}
+
+/*
+   return the field masks as a string -- one mask per line
+*/
+String PayloadFieldsToString(void)
+{
+  String list = "*" + PayloadMaskToString(_config.payload.mask) + "\n";
+
+  for (int n = 0; n < _config.payload.count && n < CONFIG_PAYLOAD_DEVICES; n++)
+    list += String(AddressToString(_config.payload.device[n].addr, MAC_ADDR_LEN, false, ':')) + PayloadMaskToString(_config.payload.device[n].mask) + "\n";
+  return list;
+}
+
+/*
+   parse the key aliases into the configuration -- a list of field=alias
+*/
+void PayloadParseAliases(const char *list)
+{
+  memset(_config.payload.alias, 0, sizeof(_config.payload.alias));
+
+  while (*list) {
+    list += strspn(list, " \t,;\r\n");
+
+    int len = strcspn(list, " \t,;\r\n");
+    const char *equal = (const char *) memchr(list, '=', len);
+
+    if (equal) {
+      int field = PayloadField(list, equal - list);
+
+      if (field >= 0)
+        strncpy(_config.payload.alias[field], equal + 1, MIN((int) (list + len - equal - 1), CONFIG_PAYLOAD_ALIAS_LENGTH - 1));
+    }
+    else if (len > 0)
+      LogMsg("PAYLOAD: ignoring invalid alias %.*s", len, list);
+    list += len;
+  }
+}
+
+/*
+   return the key aliases as a string
+*/
+String PayloadAliasesToString(void)
+{
+  String list = "";
+
+  for (int n = 0; n < PAYLOAD_FIELDS; n++)
+    if (_config.payload.alias[n][0])
+      list += String(_fields[n].name) + "=" + _config.payload.alias[n] + "\n";
+  return list;
+}
+
+/*
+   return the name of a field
+*/
+const char *PayloadFieldName(int field)
+{
+  return (field >= 0 && field < PAYLOAD_FIELDS) ? _fields[field].name : "";
+}
+
+/*
+   get some stats -- the bytes published and saved in the last full hour
+*/
+void PayloadStats(unsigned long *published, unsigned long *saved)
+{
+  *published = _published_hour;
+  *saved = _saved_hour;
+}/**/
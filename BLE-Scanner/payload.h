@@ -0,0 +1,134 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to compile the published fields of the devices into an emit plan
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PAYLOAD_H__
+#define __PAYLOAD_H__ 1
+
+#include <NimBLEDevice.h>
+#include "config.h"
+#include "scandev.h"
+
+/*
+   the fields of a device -- the bits of the field masks
+*/
+enum PAYLOAD_FIELD {
+  PAYLOAD_FIELD_PRESENCE = 0,
+  PAYLOAD_FIELD_LAST_SEEN,
+  PAYLOAD_FIELD_SCANNER,
+  PAYLOAD_FIELD_SCANNER_CID,
+  PAYLOAD_FIELD_RSSI,
+  PAYLOAD_FIELD_ADV_INTERVAL,
+  PAYLOAD_FIELD_NAME,
+  PAYLOAD_FIELD_MANUFACTURER_ID,
+  PAYLOAD_FIELD_MANUFACTURER,
+  PAYLOAD_FIELD_BATTERY,
+  PAYLOAD_FIELD_BATTERY_LEVEL,
+  PAYLOAD_FIELD_MODEL,
+  PAYLOAD_FIELD_MANUFACTURER_NAME,
+  PAYLOAD_FIELD_FIRMWARE,
+  PAYLOAD_FIELD_FRAME,
+  PAYLOAD_FIELDS
+};
+
+#define PAYLOAD_FIELDS_ALL          ((1 << PAYLOAD_FIELDS) - 1)
+
+/*
+   the reasons to publish a field -- a device sets them as it changes
+*/
+#define PAYLOAD_DIRTY_PRESENCE      0x01
+#define PAYLOAD_DIRTY_META          0x02        // publish last_seen & the scanner, even if nothing else changed
+#define PAYLOAD_DIRTY_RSSI          0x04
+#define PAYLOAD_DIRTY_NAME          0x08
+#define PAYLOAD_DIRTY_MANUFACTURER  0x10
+#define PAYLOAD_DIRTY_BATTERY       0x20
+#define PAYLOAD_DIRTY_INFO          0x40
+#define PAYLOAD_DIRTY_FRAME         0x80
+#define PAYLOAD_DIRTY_ALL           0xff
+
+/*
+   the plan of the devices not listed on their own
+*/
+#define PAYLOAD_PLAN_DEFAULT        0
+
+/*
+   setup the emit plans out of the configuration
+*/
+void PayloadSetup(void);
+
+/*
+   return the generation of the emit plans -- it changes whenever the plans are set up
+*/
+uint8_t PayloadGeneration(void);
+
+/*
+   return the emit plan of the given address
+*/
+int PayloadLookup(const BLEAddress &addr);
+
+/*
+   serialize the fields of a device by running its emit plan
+
+   return the JSON members without the braces, or an empty string if nothing is to be published
+*/
+String PayloadSerialize(const SCANDEV_T *device, int plan, uint8_t dirty);
+
+/*
+   parse the field masks into the configuration
+
+   the first word of each line is either an address or a * for all
+   other devices, followed by the names of the fields
+
+   return the number of devices taken over
+*/
+int PayloadParseFields(const char *list);
+
+/*
+   return the field masks as a string -- one mask per line
+*/
+String PayloadFieldsToString(void);
+
+/*
+   parse the key aliases into the configuration -- a list of field=alias
+*/
+void PayloadParseAliases(const char *list);
+
+/*
+   return the key aliases as a string
+*/
+String PayloadAliasesToString(void);
+
+/*
+   return the name of a field
+*/
+const char *PayloadFieldName(int field);
+
+/*
+   get some stats -- the bytes published and saved in the last full hour
+*/
+void PayloadStats(unsigned long *published, unsigned long *saved);
+
+#endif
+
+/**/
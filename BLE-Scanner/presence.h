@@ -0,0 +1,110 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  presence score of the scanned devices
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PRESENCE_H__
+#define __PRESENCE_H__ 1
+
+/*
+   the presence score of a device rises with each sighting, weighted by
+   the RSSI, and decays linearly with each missed scan cycle -- a device
+   seen once per cycle keeps its score, so even a weak one enters after
+   enough cycles, while a strong one enters sooner -- a device enters once the
+   score reaches the enter threshold and leaves once the score falls to
+   the leave threshold, so a device at the edge of the range doesn't flap
+
+   the score is a fixed point value with 8 fractional bits
+
+   this file has no dependencies, so it is shared with the replay tool
+*/
+#include <stdint.h>
+
+#define PRESENCE_SCORE_MAX          0xffff
+
+/*
+   gain of a sighting -- linear between the weak and the strong RSSI
+*/
+#define PRESENCE_RSSI_WEAK          -100
+#define PRESENCE_RSSI_STRONG        -60
+#define PRESENCE_GAIN_WEAK          (8 << 8)
+#define PRESENCE_GAIN_STRONG        (64 << 8)
+
+/*
+   default thresholds, without the fractional bits
+*/
+#define PRESENCE_ENTER_DEFAULT      96
+#define PRESENCE_LEAVE_DEFAULT      32
+
+/*
+   return the score after a sighting with the given RSSI
+*/
+static inline uint16_t PresenceSighting(uint16_t score, int rssi)
+{
+  int weight = (rssi < PRESENCE_RSSI_WEAK) ? 0 : (rssi > PRESENCE_RSSI_STRONG) ? PRESENCE_RSSI_STRONG - PRESENCE_RSSI_WEAK : rssi - PRESENCE_RSSI_WEAK;
+  uint32_t gain = PRESENCE_GAIN_WEAK + (uint32_t) (PRESENCE_GAIN_STRONG - PRESENCE_GAIN_WEAK) * weight / (PRESENCE_RSSI_STRONG - PRESENCE_RSSI_WEAK);
+  uint32_t sum = (uint32_t) score + gain;
+
+  return (sum > PRESENCE_SCORE_MAX) ? PRESENCE_SCORE_MAX : sum;
+}
+
+/*
+   return the score after the device was unseen from the given number of
+   seconds since its last sighting until the other
+
+   the first cycle after a sighting doesn't count, as the next sighting is
+   only due in the next cycle -- the missed time then decays the score from
+   its maximum to the leave threshold, so that a device with the maximum
+   score leaves after the timeout
+*/
+static inline uint16_t PresenceDecay(uint16_t score, uint32_t from, uint32_t to, uint32_t cycle, uint8_t leave, uint32_t timeout)
+{
+  uint32_t missed, decay;
+
+  if (from < cycle)
+    from = cycle;
+  if (to <= from)
+    return score;
+  missed = to - from;
+  if (timeout <= cycle)
+    return 0;
+  decay = (uint32_t) (PRESENCE_SCORE_MAX - (leave << 8)) * missed / (timeout - cycle);
+
+  return (score > decay) ? score - decay : 0;
+}
+
+/*
+   return the new presence state for the score
+*/
+static inline bool PresenceState(bool present, uint16_t score, uint8_t enter, uint8_t leave)
+{
+  if (!present && score >= (enter << 8))
+    return true;
+  if (present && score <= (leave << 8))
+    return false;
+  return present;
+}
+
+#endif
+
+/**/
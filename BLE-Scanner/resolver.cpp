@@ -0,0 +1,170 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to resolve the names of devices by active scan bursts
+
+  Names are only sent in scan responses. Instead of doing an active
+  scan for all devices from time to time, the devices without a name
+  are tracked here, and a short active scan burst is only done while
+  there are such devices. A device gets a limited number of bursts --
+  after that it stays on the list as failed, so it isn't requested
+  again.
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "resolver.h"
+#include "util.h"
+
+/*
+   the devices waiting for their name
+*/
+static struct {
+  uint64_t addr;
+  int bursts;
+} _resolver[RESOLVER_LENGTH];
+static int _resolver_count = 0;
+static int _resolver_pending = 0;
+
+/*
+   some stats
+*/
+static unsigned long _bursts = 0;
+static unsigned long _resolved = 0;
+static unsigned long _failed = 0;
+
+/*
+   find a device in the list
+*/
+static int ResolverFind(uint64_t addr)
+{
+  for (int n = 0; n < _resolver_count; n++)
+    if (_resolver[n].addr == addr)
+      return n;
+  return -1;
+}
+
+/*
+   remove a device from the list
+*/
+static void ResolverRemove(int n)
+{
+  if (_resolver[n].bursts < RESOLVER_RETRIES)
+    _resolver_pending--;
+  _resolver[n] = _resolver[--_resolver_count];
+}
+
+/*
+   a scannable device without a name was seen
+*/
+void ResolverRequest(const BLEAddress &addr)
+{
+  uint64_t key = (uint64_t) addr;
+
+  if (ResolverFind(key) >= 0)
+    return;
+
+  if (_resolver_count >= RESOLVER_LENGTH) {
+    /*
+       make room by dropping a failed device
+    */
+    int n;
+
+    for (n = 0; n < _resolver_count && _resolver[n].bursts < RESOLVER_RETRIES; n++);
+    if (n >= _resolver_count)
+      return;
+    ResolverRemove(n);
+  }
+
+  _resolver[_resolver_count].addr = key;
+  _resolver[_resolver_count].bursts = 0;
+  _resolver_count++;
+  _resolver_pending++;
+}
+
+/*
+   a device got its name
+*/
+void ResolverResolved(const BLEAddress &addr)
+{
+  if (!_resolver_count)
+    return;
+
+  int n = ResolverFind((uint64_t) addr);
+
+  if (n >= 0) {
+    if (_resolver[n].bursts > 0)
+      _resolved++;
+    ResolverRemove(n);
+  }
+}
+
+/*
+   return true if there are devices waiting for their name
+*/
+bool ResolverPending(void)
+{
+  return _resolver_pending > 0;
+}
+
+/*
+   an active scan burst is started
+*/
+void ResolverBurst(void)
+{
+  _bursts++;
+  for (int n = 0; n < _resolver_count; n++) {
+    if (_resolver[n].bursts < RESOLVER_RETRIES && ++_resolver[n].bursts >= RESOLVER_RETRIES) {
+      /*
+         this was the last try for this device
+      */
+      _resolver_pending--;
+      _failed++;
+    }
+  }
+}
+
+/*
+   get some stats
+*/
+void ResolverStats(int *pending, unsigned long *bursts, unsigned long *resolved, unsigned long *failed)
+{
+  *pending = _resolver_pending;
+  *bursts = _bursts;
+  *resolved = _resolved;
+  *failed = _failed;
+}
+
+/*
+   return the addresses of the devices waiting for their name -- one address per line
+*/
+String ResolverToString(void)
+{
+  String list = "";
+
+  for (int n = 0; n < _resolver_count; n++) {
+    if (_resolver[n].bursts < RESOLVER_RETRIES) {
+      list += BLEAddress(_resolver[n].addr, BLE_ADDR_PUBLIC).toString().c_str();
+      list += "\n";
+    }
+  }
+  return list;
+}/**/
@@ -0,0 +1,80 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to resolve the names of devices by active scan bursts
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __RESOLVER_H__
+#define __RESOLVER_H__ 1
+
+#include <NimBLEDevice.h>
+#include "config.h"
+#include "util.h"
+
+/*
+   number of devices without a name we keep track of
+*/
+#define RESOLVER_LENGTH         32
+
+/*
+   number of active scan bursts before we give up on a device
+*/
+#define RESOLVER_RETRIES        5
+
+/*
+   duration of an active scan burst in seconds
+*/
+#define RESOLVER_BURST_TIME     3
+
+/*
+   a scannable device without a name was seen
+*/
+void ResolverRequest(const BLEAddress &addr);
+
+/*
+   a device got its name
+*/
+void ResolverResolved(const BLEAddress &addr);
+
+/*
+   return true if there are devices waiting for their name
+*/
+bool ResolverPending(void);
+
+/*
+   an active scan burst is started
+*/
+void ResolverBurst(void);
+
+/*
+   get some stats
+*/
+void ResolverStats(int *pending, unsigned long *bursts, unsigned long *resolved, unsigned long *failed);
+
+/*
+   return the addresses of the devices waiting for their name -- one address per line
+*/
+String ResolverToString(void);
+
+#endif
+
+/**/
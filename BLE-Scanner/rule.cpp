@@ -0,0 +1,271 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  compiler & interpreter of the rules selecting the devices to publish
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "rule.h"
+
+/*
+   the grammar, by rising precedence
+
+     or      := and { "||" and }
+     and     := not { "&&" not }
+     not     := "!" not | compare
+     compare := operand [ ( "==" | "!=" | "<" | "<=" | ">" | ">=" ) operand ]
+     operand := number | name | "(" or ")"
+
+   numbers are decimal or hex with a leading 0x, and might be negative
+*/
+static const char *_var_names[RULE_VARS] = {
+  "rssi",
+  "manufacturer",
+  "present",
+  "battery",
+  "interval",
+  "zone",
+  "connectable",
+  "age",
+  "sightings",
+};
+
+static const struct {
+  const char *token;
+  uint8_t op;
+} _compare_ops[] = {
+  { "==", RULE_OP_EQ },
+  { "!=", RULE_OP_NE },
+  { "<=", RULE_OP_LE },
+  { ">=", RULE_OP_GE },
+  { "<", RULE_OP_LT },
+  { ">", RULE_OP_GT },
+};
+
+/*
+   the state of the compiler
+*/
+typedef struct _rule_parser {
+  RULE_T *rule;
+  const char *expression;
+  const char *pos;
+  int depth;                        // current depth of the stack
+  char *error;
+  size_t size;
+  bool failed;
+} RULE_PARSER_T;
+
+static void RuleOr(RULE_PARSER_T *p);
+
+/*
+   record the first error
+*/
+static void RuleError(RULE_PARSER_T *p, const char *msg)
+{
+  if (!p->failed)
+    snprintf(p->error, p->size, "%s at position %d", msg, (int) (p->pos - p->expression) + 1);
+  p->failed = true;
+}
+
+/*
+   skip white spaces and check for a token
+*/
+static bool RuleToken(RULE_PARSER_T *p, const char *token)
+{
+  while (isspace((unsigned char) *p->pos))
+    p->pos++;
+  if (strncmp(p->pos, token, strlen(token)))
+    return false;
+  p->pos += strlen(token);
+  return true;
+}
+
+/*
+   emit an instruction
+*/
+static int RuleEmit(RULE_PARSER_T *p, uint8_t op, int operand, int depth)
+{
+  RULE_T *rule = p->rule;
+  int at = rule->length;
+
+  if (rule->length + ((operand >= 0) ? 2 : 1) > RULE_CODE_LENGTH - 1) {
+    RuleError(p, "rule too long");
+    return at;
+  }
+  rule->code[rule->length++] = op;
+  if (operand >= 0)
+    rule->code[rule->length++] = operand;
+
+  p->depth += depth;
+  if (p->depth > RULE_STACK_DEPTH)
+    RuleError(p, "rule nested too deep");
+  return at;
+}
+
+/*
+   the target of a jump is the end of the code
+*/
+static void RulePatch(RULE_PARSER_T *p, int at)
+{
+  if (!p->failed)
+    p->rule->code[at + 1] = p->rule->length - (at + 1);
+}
+
+static void RuleOperand(RULE_PARSER_T *p)
+{
+  RULE_T *rule = p->rule;
+  char *end;
+
+  while (isspace((unsigned char) *p->pos))
+    p->pos++;
+
+  if (RuleToken(p, "(")) {
+    RuleOr(p);
+    if (!RuleToken(p, ")"))
+      RuleError(p, "missing )");
+    return;
+  }
+
+  if (isdigit((unsigned char) *p->pos) || (*p->pos == '-' && isdigit((unsigned char) p->pos[1]))) {
+    const char *digits = p->pos + ((*p->pos == '-') ? 1 : 0);
+    long value = strtol(p->pos, &end, (digits[0] == '0' && tolower(digits[1]) == 'x') ? 16 : 10);
+    int n;
+
+    for (n = 0; n < rule->count; n++)
+      if (rule->consts[n] == value)
+        break;
+    if (n >= RULE_CONSTS) {
+      RuleError(p, "too many numbers");
+      return;
+    }
+    if (n == rule->count)
+      rule->consts[rule->count++] = value;
+    p->pos = end;
+    RuleEmit(p, RULE_OP_CONST, n, 1);
+    return;
+  }
+
+  if (isalpha((unsigned char) *p->pos)) {
+    int len = 0;
+
+    while (isalnum((unsigned char) p->pos[len]) || p->pos[len] == '_')
+      len++;
+    for (int n = 0; n < RULE_VARS; n++)
+      if ((int) strlen(_var_names[n]) == len && !strncasecmp(_var_names[n], p->pos, len)) {
+        p->pos += len;
+        rule->vars |= 1 << n;
+        RuleEmit(p, RULE_OP_VAR, n, 1);
+        return;
+      }
+    RuleError(p, "unknown name");
+    return;
+  }
+  RuleError(p, (*p->pos) ? "unexpected character" : "unexpected end");
+}
+
+static void RuleCompare(RULE_PARSER_T *p)
+{
+  RuleOperand(p);
+  for (size_t n = 0; n < sizeof(_compare_ops) / sizeof(_compare_ops[0]); n++)
+    if (RuleToken(p, _compare_ops[n].token)) {
+      RuleOperand(p);
+      RuleEmit(p, _compare_ops[n].op, -1, -1);
+      return;
+    }
+}
+
+static void RuleNot(RULE_PARSER_T *p)
+{
+  while (isspace((unsigned char) *p->pos))
+    p->pos++;
+  if (*p->pos == '!' && p->pos[1] != '=') {
+    p->pos++;
+    RuleNot(p);
+    RuleEmit(p, RULE_OP_NOT, -1, 0);
+  }
+  else
+    RuleCompare(p);
+}
+
+static void RuleAnd(RULE_PARSER_T *p)
+{
+  RuleNot(p);
+  while (!p->failed && RuleToken(p, "&&")) {
+    int at = RuleEmit(p, RULE_OP_JZ, 0, -1);
+
+    RuleNot(p);
+    RulePatch(p, at);
+  }
+}
+
+static void RuleOr(RULE_PARSER_T *p)
+{
+  RuleAnd(p);
+  while (!p->failed && RuleToken(p, "||")) {
+    int at = RuleEmit(p, RULE_OP_JNZ, 0, -1);
+
+    RuleAnd(p);
+    RulePatch(p, at);
+  }
+}
+
+/*
+   compile an expression -- an empty expression gives an empty rule
+*/
+bool RuleCompile(RULE_T *rule, const char *expression, char *error, size_t size)
+{
+  RULE_PARSER_T p = { rule, expression, expression, 0, error, size, false };
+
+  memset(rule, 0, sizeof(RULE_T));
+  if (size)
+    *error = '\0';
+
+  while (isspace((unsigned char) *p.pos))
+    p.pos++;
+  if (!*p.pos)
+    return true;
+
+  RuleOr(&p);
+  while (isspace((unsigned char) *p.pos))
+    p.pos++;
+  if (!p.failed && *p.pos)
+    RuleError(&p, "unexpected character");
+  if (!p.failed)
+    rule->code[rule->length++] = RULE_OP_END;
+
+  if (p.failed) {
+    memset(rule, 0, sizeof(RULE_T));
+    return false;
+  }
+  return true;
+}
+
+/*
+   return the name of a value
+*/
+const char *RuleVarName(int var)
+{
+  return (var >= 0 && var < RULE_VARS) ? _var_names[var] : "";
+}/**/
@@ -0,0 +1,180 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  compiler & interpreter of the rules selecting the devices to publish
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __RULE_H__
+#define __RULE_H__ 1
+
+/*
+   a rule is an expression over the values of a device, like
+
+     rssi > -80 && manufacturer == 0x004C && present
+
+   it is compiled into the code of a small stack machine, so evaluating
+   it neither parses nor allocates anything -- the compiler checks the
+   depth of the stack, so the interpreter doesn't need to
+
+   this file and rule.cpp have no dependencies, so they are shared with
+   the rule check tool
+*/
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+   the values of a device a rule can refer to
+*/
+enum RULE_VAR {
+  RULE_VAR_RSSI = 0,
+  RULE_VAR_MANUFACTURER,
+  RULE_VAR_PRESENT,
+  RULE_VAR_BATTERY,
+  RULE_VAR_INTERVAL,
+  RULE_VAR_ZONE,
+  RULE_VAR_CONNECTABLE,
+  RULE_VAR_AGE,
+  RULE_VAR_SIGHTINGS,
+  RULE_VARS
+};
+
+/*
+   the instructions -- CONST & VAR take the index of the operand,
+   JZ & JNZ take the offset of the jump
+*/
+enum RULE_OP {
+  RULE_OP_END = 0,
+  RULE_OP_CONST,
+  RULE_OP_VAR,
+  RULE_OP_EQ,
+  RULE_OP_NE,
+  RULE_OP_LT,
+  RULE_OP_LE,
+  RULE_OP_GT,
+  RULE_OP_GE,
+  RULE_OP_NOT,
+  RULE_OP_JZ,             // jump if the top is zero, otherwise drop it
+  RULE_OP_JNZ,            // jump if the top is not zero, otherwise drop it
+};
+
+/*
+   limits of a compiled rule
+*/
+#define RULE_CODE_LENGTH            96
+#define RULE_CONSTS                 16
+#define RULE_STACK_DEPTH            8
+#define RULE_ERROR_LENGTH           64
+
+typedef struct _rule {
+  int length;                       // length of the code, 0 for no rule
+  uint8_t code[RULE_CODE_LENGTH];
+  int32_t consts[RULE_CONSTS];
+  int count;                        // number of constants
+  uint16_t vars;                    // mask of the values used
+} RULE_T;
+
+/*
+   compile an expression -- an empty expression gives an empty rule
+
+   return false and set the error message if the expression is invalid
+*/
+bool RuleCompile(RULE_T *rule, const char *expression, char *error, size_t size);
+
+/*
+   evaluate a rule for the given values -- an empty rule always matches
+*/
+static inline bool RuleEval(const RULE_T *rule, const int32_t *vars)
+{
+  int32_t stack[RULE_STACK_DEPTH];
+  int32_t *top = stack - 1;
+  const uint8_t *pc = rule->code;
+
+  if (!rule->length)
+    return true;
+
+  for (;;) {
+    switch (*pc++) {
+      case RULE_OP_END:
+        return *top != 0;
+      case RULE_OP_CONST:
+        *++top = rule->consts[*pc++];
+        break;
+      case RULE_OP_VAR:
+        *++top = vars[*pc++];
+        break;
+      case RULE_OP_EQ:
+        top--;
+        *top = top[0] == top[1];
+        break;
+      case RULE_OP_NE:
+        top--;
+        *top = top[0] != top[1];
+        break;
+      case RULE_OP_LT:
+        top--;
+        *top = top[0] < top[1];
+        break;
+      case RULE_OP_LE:
+        top--;
+        *top = top[0] <= top[1];
+        break;
+      case RULE_OP_GT:
+        top--;
+        *top = top[0] > top[1];
+        break;
+      case RULE_OP_GE:
+        top--;
+        *top = top[0] >= top[1];
+        break;
+      case RULE_OP_NOT:
+        *top = !*top;
+        break;
+      case RULE_OP_JZ:
+        if (!*top)
+          pc += *pc;
+        else {
+          pc++;
+          top--;
+        }
+        break;
+      case RULE_OP_JNZ:
+        if (*top)
+          pc += *pc;
+        else {
+          pc++;
+          top--;
+        }
+        break;
+      default:
+        return false;
+    }
+  }
+}
+
+/*
+   return the name of a value
+*/
+const char *RuleVarName(int var);
+
+#endif
+
+/**/
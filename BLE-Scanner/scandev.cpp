@@ -30,11 +30,52 @@
 #include "ble-manufacturer.h"
 #include "util.h"
 #include "scandev.h"
+#include "fingerprint.h"
+#include "battery.h"
+#include "gattcache.h"
+#include "resolver.h"
+#include "presence.h"
+#include "group.h"
+#include "occupancy.h"
+#include "events.h"
+#include "payload.h"
+#include "filter.h"
+#include "dedup.h"
 
 static int _scandev_count = 0;
 static SCANDEV_T *_scandev_first = NULL;
 static SCANDEV_T *_scandev_last = NULL;
 
+/*
+   counters of the device churn
+*/
+static int _scandev_present = 0;
+static int _scandev_arrivals = 0;
+static int _scandev_departures = 0;
+static int _scandev_new = 0;
+
+/*
+   advertisements handled by the fast path and by ScanDevAdd()
+*/
+static volatile unsigned long _scandev_fast = 0;
+static volatile unsigned long _scandev_slow = 0;
+
+/*
+   group members whose device slot was reused -- the slot is reused by the
+   NimBLE task, but the groups are only counted by the cyclic update
+*/
+static portMUX_TYPE _scandev_group_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t _scandev_group_left[CONFIG_GROUPS];
+static uint8_t _scandev_group_generation = 0;
+
+/*
+   copies of present devices whose slot was reused -- their open sessions
+   are closed by the NimBLE task, but only published by the cyclic update
+*/
+static portMUX_TYPE _scandev_session_mux = portMUX_INITIALIZER_UNLOCKED;
+static SCANDEV_T _scandev_sessions[SCANDEV_SESSIONS_PENDING];
+static int _scandev_sessions_pending = 0;
+
 #if DBG_SCANDEV
 /*
    dump the bluetoot device list
@@ -65,29 +106,229 @@ static void dumpScanDevList(const char *title)
 #define DBG_SCANDEVLIST(title)  {}
 #endif
 
+/*
+   find a device in the list
+*/
+static SCANDEV_T *ScanDevFind(const BLEAddress &addr)
+{
+  DBG_SCANDEVLIST("searching");
+  for (SCANDEV_T *device = _scandev_first; device; device = device->next)
+    if (device->addr == addr)
+      return device;
+  return NULL;
+}
+
+/*
+   de-list a device
+*/
+static void ScanDevUnlink(SCANDEV_T *device)
+{
+  DBG_SCANDEVLIST("before de-listing");
+  if (device->prev)
+    device->prev->next = device->next;
+  if (device->next)
+    device->next->prev = device->prev;
+  if (_scandev_first == device)
+    _scandev_first = device->next;
+  if (_scandev_last == device)
+    _scandev_last = device->prev;
+  device->prev = NULL;
+  device->next = NULL;
+  _scandev_count--;
+  DBG_SCANDEVLIST("after de-listing");
+}
+
+/*
+   put a device at the beginning of the list -- the list is sorted by the last update
+*/
+static void ScanDevLinkFirst(SCANDEV_T *device)
+{
+  if (_scandev_first)
+    _scandev_first->prev = device;
+  device->next = _scandev_first;
+  _scandev_first = device;
+  if (!_scandev_last)
+    _scandev_last = device;
+  _scandev_count++;
+}
+
+/*
+   compute the fingerprint of an advertisement payload (FNV-1a)
+*/
+uint32_t ScanDevFingerprint(const uint8_t *payload, size_t length)
+{
+  return FingerprintPayload(payload, length);
+}
+
+/*
+   update the estimation of the advertising interval
+
+   only gaps within a scan are taken -- the interval is kept as an
+   exponential moving average with a weight of 1/8
+*/
+static void ScanDevInterval(SCANDEV_T *device)
+{
+  uint32_t now_ms = millis();
+  uint32_t gap = now_ms - device->last_received;
+
+  if (device->last_received && gap < SCANDEV_INTERVAL_MAX) {
+    if (device->interval)
+      device->interval += ((int32_t) gap - (int32_t) device->interval) / 8;
+    else
+      device->interval = gap;
+  }
+  device->last_received = now_ms;
+}
+
+/*
+   the names of the zones
+*/
+static const char *_zone_names[] = { "none", "immediate", "near", "far", "remote" };
+
+/*
+   return the name of a zone
+*/
+const char *ScanDevZoneName(int zone)
+{
+  return (zone >= SCANDEV_ZONE_NONE && zone <= SCANDEV_ZONE_REMOTE) ? _zone_names[zone] : "";
+}
+
+/*
+   set a new zone of a device
+*/
+static void ScanDevZoneChange(SCANDEV_T *device, uint8_t zone)
+{
+  if (device->zone != zone) {
+    if (device->present)
+      OccupancyZone(device->zone, zone);
+    device->zone_previous = device->zone;
+    device->zone = zone;
+    device->publish_zone = true;
+    device->publish = true;
+  }
+}
+
+/*
+   update the zone of a device out of its smoothed RSSI
+
+   to move into another zone, the RSSI has to pass the threshold by its hysteresis
+*/
+static void ScanDevZone(SCANDEV_T *device)
+{
+  int smoothed = device->rssi_smoothed >> 4;
+  int zone = device->zone;
+
+  if (zone == SCANDEV_ZONE_NONE) {
+    /*
+       take the zone without hysteresis
+    */
+    for (zone = SCANDEV_ZONE_IMMEDIATE; zone < SCANDEV_ZONE_REMOTE && smoothed < _config.zone.threshold[zone - 1]; zone++);
+  }
+  else {
+    while (zone > SCANDEV_ZONE_IMMEDIATE && smoothed >= _config.zone.threshold[zone - 2] + _config.zone.hysteresis[zone - 2])
+      zone--;
+    while (zone < SCANDEV_ZONE_REMOTE && smoothed < _config.zone.threshold[zone - 1] - _config.zone.hysteresis[zone - 1])
+      zone++;
+  }
+  ScanDevZoneChange(device, zone);
+}
+
+/*
+   a device was sighted -- check if it is present now
+*/
+static void ScanDevSighting(SCANDEV_T *device, const int rssi)
+{
+  /*
+     the RSSI is smoothed by a moving average with a weight of 1/4, starting over with each session
+  */
+  if (!device->present)
+    device->rssi_smoothed = rssi * 16;
+  else
+    device->rssi_smoothed += (rssi * 16 - device->rssi_smoothed) / 4;
+
+  if (_config.bluetooth.presence_score) {
+    device->score = PresenceSighting(device->score, rssi);
+    if (!PresenceState(device->present, device->score, _config.bluetooth.presence_enter, _config.bluetooth.presence_leave))
+      return;
+  }
+  if (!device->present) {
+    /*
+       the prensence changed from absent to present
+    */
+    device->present = true;
+    device->publish_presence = true;
+    _scandev_present++;
+    _scandev_arrivals++;
+    OccupancyCount(&device->occupancy, device->manufacturer_id, device->zone, 1);
+
+    /*
+       a new session starts
+    */
+    device->first_seen = now();
+    device->session_rssi_max = rssi;
+    device->session_sightings = 0;
+  }
+  if (device->session_sightings < UINT16_MAX)
+    device->session_sightings++;
+  if (rssi > device->session_rssi_max)
+    device->session_rssi_max = rssi;
+  if (_config.zone.enabled)
+    ScanDevZone(device);
+}
+
+/*
+   fast path for a known device sending the same payload as before
+
+   only the RSSI and the last seen time are updated
+
+   return false if the advertisement has to be processed by ScanDevAdd()
+*/
+bool ScanDevSeen(const BLEAddress &addr, uint32_t fingerprint, const int rssi)
+{
+  SCANDEV_T *device;
+
+  if (_scandev_first && _scandev_first->addr == addr)
+    device = _scandev_first;
+  else if (!(device = ScanDevFind(addr)))
+    return false;
+  if (!device->fingerprint || device->fingerprint != fingerprint || !device->present)
+    return false;
+
+  if (device != _scandev_first) {
+    ScanDevUnlink(device);
+    ScanDevLinkFirst(device);
+  }
+  if (device->battadv)
+    device->last_battadv = now();
+  if (device->rssi != rssi) {
+    device->rssi = rssi;
+    device->publish_rssi = true;
+  }
+  ScanDevInterval(device);
+  ScanDevSighting(device, rssi);
+  device->last_seen = now();
+  device->publish = true;
+  _scandev_fast++;
+
+  return true;
+}
+
 /*
    add a device to the device list
 */
-bool ScanDevAdd(BLEAddress addr, const char *name, const uint16_t manufacturer_id, const int rssi, const bool has_battery)
+bool ScanDevAdd(BLEAddress addr, const char *name, const uint16_t manufacturer_id, const int rssi, bool has_battery, const int adv_battery_level, const bool connectable, const bool scannable, const ADVDECODE_T *frame, uint32_t fingerprint)
 {
   SCANDEV_T *device;
   int battery_level = 0;
 
   /*
      scan our list to check if this device is already known
-  */
-  DBG_SCANDEVLIST("searching");
-  for (device = _scandev_first; device; device = device->next) {
-    if (device->addr == addr) {
-      /*
-         ok, this device was already seen
 
-         keep the battery level in mind
-      */
-      battery_level = device->battery_level;
-      break;
-    }
-  }
+     if so, keep the battery level in mind
+  */
+  _scandev_slow++;
+  if ((device = ScanDevFind(addr)))
+    battery_level = device->battery_level;
 
   if (!device && _scandev_count >= SCANDEV_LIST_MAX_LENGTH) {
     /*
@@ -103,25 +344,41 @@ bool ScanDevAdd(BLEAddress addr, const char *name, const uint16_t manufacturer_i
     /*
        de-list this device
     */
-    DBG_SCANDEVLIST("before de-listing");
-    if (device->prev)
-      device->prev->next = device->next;
-    if (device->next)
-      device->next->prev = device->prev;
-    if (_scandev_first == device)
-      _scandev_first = device->next;
-    if (_scandev_last == device)
-      _scandev_last = device->prev;
-    device->prev = NULL;
-    device->next = NULL;
-    _scandev_count--;
-    DBG_SCANDEVLIST("after de-listing");
+    ScanDevUnlink(device);
 
     /*
        if this device slot was used from another device, we have to clean the record
     */
     if (device->addr != addr) {
+      if (device->present) {
+        _scandev_present--;
+        OccupancyCount(&device->occupancy, device->manufacturer_id, device->zone, -1);
+      }
+      if (device->group_counted) {
+        portENTER_CRITICAL(&_scandev_group_mux);
+        if (_scandev_group_generation != device->group_generation) {
+          memset(_scandev_group_left, 0, sizeof(_scandev_group_left));
+          _scandev_group_generation = device->group_generation;
+        }
+        if (device->group >= 0 && device->group < CONFIG_GROUPS && _scandev_group_left[device->group] < UINT8_MAX)
+          _scandev_group_left[device->group]++;
+        portEXIT_CRITICAL(&_scandev_group_mux);
+      }
+      if (device->event_present)
+        EventsPresence(device->addr, false);
+      if (device->present && device->claimed) {
+        /*
+           the owner has to publish the open session of the device -- if too
+           many are waiting, the session is lost
+        */
+        portENTER_CRITICAL(&_scandev_session_mux);
+        if (_scandev_sessions_pending < SCANDEV_SESSIONS_PENDING)
+          memcpy((void *) &_scandev_sessions[_scandev_sessions_pending++], (void *) device, sizeof(SCANDEV_T));
+        portEXIT_CRITICAL(&_scandev_session_mux);
+      }
       memset((void *) device, 0, sizeof(SCANDEV_T));
+      device->publish_info = true;
+      _scandev_new++;
     }
   }
   else {
@@ -130,6 +387,8 @@ bool ScanDevAdd(BLEAddress addr, const char *name, const uint16_t manufacturer_i
     */
     if ((device = (SCANDEV_T *) malloc(sizeof(SCANDEV_T)))) {
       memset((void *) device, 0, sizeof(SCANDEV_T));
+      device->publish_info = true;
+      _scandev_new++;
     }
     LogMsg("DEV: number of scanned devices in list: %d", _scandev_count);
   }
@@ -140,13 +399,7 @@ bool ScanDevAdd(BLEAddress addr, const char *name, const uint16_t manufacturer_i
     */
     DBG_SCANDEVLIST("before insert");
 
-    if (_scandev_first)
-      _scandev_first->prev = device;
-    device->next = _scandev_first;
-    _scandev_first = device;
-    if (!_scandev_last)
-      _scandev_last = device;
-    _scandev_count++;
+    ScanDevLinkFirst(device);
 
     /*
        copy the data into the device -- whenever the data changed
@@ -159,14 +412,46 @@ bool ScanDevAdd(BLEAddress addr, const char *name, const uint16_t manufacturer_i
       strncpy(device->name, name, SCANDEV_NAME_LENGTH);
       device->publish_name = true;
     }
+    if (!*device->name) {
+      /*
+         use the name read via GATT
+      */
+      if (GattCacheName(addr, device->name, SCANDEV_NAME_LENGTH))
+        device->publish_name = true;
+    }
+    if (*device->name)
+      ResolverResolved(addr);
+    else if (scannable) {
+      /*
+         the name might be in the scan response
+      */
+      ResolverRequest(addr);
+    }
+    device->connectable = connectable;
     if (device->manufacturer_id != manufacturer_id) {
       /*
          manufacturer changed
       */
+      if (device->present)
+        OccupancyManufacturer(&device->occupancy, manufacturer_id);
       device->manufacturer_id = manufacturer_id;
       device->manufacturer = BLEManufacturerLookup(manufacturer_id, "");
       device->publish_manufacturer = true;
     }
+    device->battadv = adv_battery_level >= 0;
+    if (device->battadv) {
+      /*
+         the device advertised its battery level
+      */
+      battery_level = adv_battery_level;
+      device->last_battadv = now();
+    }
+    if (device->last_battadv && now() - device->last_battadv <= _config.bluetooth.battcheck_timeout) {
+      /*
+         not every advertisement carries the battery level
+      */
+      has_battery = true;
+    }
     if (device->has_battery != has_battery || device->battery_level != battery_level) {
       /*
          battery state or level changed
@@ -175,6 +460,13 @@ bool ScanDevAdd(BLEAddress addr, const char *name, const uint16_t manufacturer_i
       device->battery_level = battery_level;
       device->publish_battery = true;
     }
+    if (frame->type != ADVDECODE_NONE && frame->type != ADVDECODE_SENSOR && memcmp(&device->frame, frame, sizeof(ADVDECODE_T))) {
+      /*
+         decoded frame changed
+      */
+      device->frame = *frame;
+      device->publish_frame = true;
+    }
     if (device->rssi != rssi) {
       /*
          rssi changed
@@ -182,17 +474,17 @@ bool ScanDevAdd(BLEAddress addr, const char *name, const uint16_t manufacturer_i
       device->rssi = rssi;
       device->publish_rssi = true;
     }
-    if (!device->present) {
-      /*
-         the prensence changed from absent to present
-      */
-      device->present = true;
-      device->publish_presence = true;
-    }
+    ScanDevSighting(device, rssi);
+
+    /*
+       sensor values are taken from every advertisement, so these don't take the fast path
+    */
+    device->fingerprint = (frame->type == ADVDECODE_SENSOR) ? 0 : fingerprint;
 
     /*
        last seen is always updated
     */
+    ScanDevInterval(device);
     device->last_seen = now();
 
     /*
@@ -206,6 +498,128 @@ bool ScanDevAdd(BLEAddress addr, const char *name, const uint16_t manufacturer_i
   return (device) ? true : false;
 }
 
+/*
+   return the number of advertisements handled by the fast path and by ScanDevAdd()
+*/
+void ScanDevFastPathStats(unsigned long *fast, unsigned long *slow)
+{
+  *fast = _scandev_fast;
+  *slow = _scandev_slow;
+}
+
+/*
+   a scan cycle ended -- update the detection rate of the present devices
+
+   the detection rate is an exponential moving average with a weight of 1/8,
+   the absence timeout is the number of cycles a device is missed in a row
+   with a probability below the configured target
+*/
+void ScanDevCycle(time_t scan_start)
+{
+  uint32_t target = ((uint32_t) _config.bluetooth.absence_target << 16) / 1000;
+
+  for (SCANDEV_T *device = _scandev_first; device; device = device->next) {
+    if (!device->present)
+      continue;
+
+    int detected = (device->last_seen >= scan_start) ? 255 : 0;
+
+    if (device->cycles)
+      device->detection += (detected - device->detection) / 8;
+    else
+      device->detection = detected;
+    if (device->cycles < 255)
+      device->cycles++;
+
+    /*
+       probability to miss the device in k cycles in a row in 1/65536
+    */
+    uint32_t missed = 1 << 16;
+    int k = 0;
+
+    while (missed > target && k < SCANDEV_ABSENCE_CYCLES_MAX) {
+      missed = (missed * (256 - MAX(device->detection, 1))) >> 8;
+      k++;
+    }
+    device->absence_cycles = MAX(k, BLUETOOTH_ABSENCE_CYCLES_MIN);
+  }
+}
+
+/*
+   return the absence timeout of a device in seconds
+
+   the last seen time might be at the beginning of a scan, so one cycle is added to the learned timeout
+*/
+static time_t ScanDevAbsenceTimeout(SCANDEV_T *device)
+{
+  if (_config.bluetooth.learn_absence && device->cycles >= SCANDEV_LEARN_CYCLES)
+    return (device->absence_cycles + 1) * BluetoothCycleTime();
+  return _config.bluetooth.absence_cycles * BluetoothCycleTime();
+}
+
+/*
+   return the number of present devices using a learned absence timeout
+*/
+int ScanDevCountLearned(void)
+{
+  int count = 0;
+
+  if (_config.bluetooth.learn_absence)
+    for (SCANDEV_T *device = _scandev_first; device; device = device->next)
+      if (device->present && device->cycles >= SCANDEV_LEARN_CYCLES)
+        count++;
+  return count;
+}
+
+/*
+   return the number of devices seen since the given time
+*/
+int ScanDevCountSeen(time_t since)
+{
+  int count = 0;
+
+  /*
+     the list is sorted by the last update, so we can stop at the first older device
+  */
+  for (SCANDEV_T *device = _scandev_first; device && device->last_seen >= since; device = device->next)
+    count++;
+
+  return count;
+}
+
+/*
+   return the number of present devices
+*/
+int ScanDevCountPresent(void)
+{
+  return _scandev_present;
+}
+
+/*
+   fill in the addresses of the devices counted in the event stream -- return their number
+*/
+int ScanDevEventAddresses(uint64_t *addrs, int max)
+{
+  int count = 0;
+
+  for (SCANDEV_T *device = _scandev_first; device && count < max; device = device->next)
+    if (device->event_present)
+      addrs[count++] = (uint64_t) device->addr;
+
+  return count;
+}
+
+/*
+   return the number of arrivals, departures and new devices since the last call
+*/
+void ScanDevChurn(int *arrivals, int *departures, int *new_devices)
+{
+  *arrivals = _scandev_arrivals;
+  *departures = _scandev_departures;
+  *new_devices = _scandev_new;
+  _scandev_arrivals = _scandev_departures = _scandev_new = 0;
+}
+
 #if DBG
 /*
    add a device to the device list
@@ -224,6 +638,8 @@ bool ScanDevToggle(BLEAddress addr)
          toggle the device state
       */
       device->present = !device->present;
+      _scandev_present += (device->present) ? 1 : -1;
+      OccupancyCount(&device->occupancy, device->manufacturer_id, device->zone, (device->present) ? 1 : -1);
       device->publish_presence = true;
       device->publish = true;
       return true;
@@ -234,16 +650,22 @@ bool ScanDevToggle(BLEAddress addr)
 #endif
 
 /*
-   check the battery level
+   take over the result of a battery check
 */
-void ScanDevCheckBattery(SCANDEV_T *device)
+void ScanDevBatteryResult(SCANDEV_T *device, const BLEAddress &addr, bool success, uint8_t battery_level)
 {
-  uint8_t battery_level = device->battery_level;
+  if (device->addr != addr) {
+    /*
+       the record was taken over by another device in the meantime
+    */
+    return;
+  }
 
-  if (BluetoothBatteryCheck(device->addr, &battery_level)) {
+  if (success) {
     /*
        we obviuosly had success reading the battery level ...
     */
+    device->battcheck_failures = 0;
     if (device->battery_level != battery_level) {
       /*
          ... and it has changed
@@ -252,78 +674,166 @@ void ScanDevCheckBattery(SCANDEV_T *device)
       device->publish_battery = true;
     }
   }
+  else if (device->battcheck_failures < BATTERY_BACKOFF_MAX)
+    device->battcheck_failures++;
 
   /*
      even if the check failed, we will have to wait for the next cycle
   */
+  device->connect_queued = false;
   device->last_battcheck = now();
 }
 
+/*
+   the device information of a device was read into the GATT cache
+*/
+void ScanDevInfoResult(SCANDEV_T *device, const BLEAddress &addr)
+{
+  const GATTCACHE_ENTRY_T *entry = GattCacheLookup(addr);
+
+  if (device->addr != addr || !entry) {
+    /*
+       the record was taken over by another device in the meantime
+    */
+    return;
+  }
+
+  if (entry->valid) {
+    if (!*device->name && *entry->name) {
+      strncpy(device->name, entry->name, SCANDEV_NAME_LENGTH);
+      device->publish_name = true;
+    }
+    device->publish_info = true;
+    device->publish = true;
+  }
+  device->connect_queued = false;
+}
+
+/*
+   publish the closed session of a device as one record
+*/
+static void ScanDevPublishSession(const SCANDEV_T *device)
+{
+  String Addr = String(device->addr.toString().c_str());
+  Addr.toUpperCase();
+  Addr.replace(":", "-");
+
+  String json = "\"start\":" + String(device->first_seen) + ","
+                "\"end\":" + String(device->last_seen) + ","
+                "\"dwell\":" + String(device->last_seen - device->first_seen) + ","
+                "\"RSSImax\":" + String(device->session_rssi_max) + ","
+                "\"sightings\":" + String(device->session_sightings) + ","
+                "\"Name\":\"" + String(device->name) + "\","
+                "\"ManufacturerId\":\"" + String(BLEManufacturerIdHex(device->manufacturer_id)) + "\","
+                "\"Scanner\":\"" + String(_config.device.name) + "\"";
+
+  MqttPublish(Addr + "/session", "{" + json + "}");
+}
+
 /*
    publish all devices which are not yet published
 */
 static void ScanDevPublishMQTT(SCANDEV_T *device, bool all)
 {
+  if (device->publish_session) {
+    /*
+       the session is closed -- the owner checked the rule when it closed
+    */
+    ScanDevPublishSession(device);
+    device->publish_session = false;
+  }
+  if (_config.mqtt.occupancy || _config.mqtt.sessions) {
+    /*
+       only the counts or the sessions are published
+    */
+    device->publish = false;
+    return;
+  }
+  if (!device->claimed) {
+    /*
+       another scanner owns the device
+    */
+    device->publish = false;
+    return;
+  }
+  if (device->claim_takeover) {
+    all = true;
+    device->claim_takeover = false;
+  }
   if (all || device->publish) {
     /*
-       publish the device state
+       a device not matching the rule isn't published, unless it just stopped
+       matching -- once it starts matching, all of it is published
     */
-    String json = "";
+    bool matched = FilterMatch(device);
+
+    if (!matched && !device->filter_matched) {
+      device->publish = false;
+      return;
+    }
+    if (matched && !device->filter_matched)
+      all = true;
+    device->filter_matched = matched;
+  }
+  if (all || device->publish) {
+    /*
+       publish the device state -- the emit plan of the device decides on the fields
+    */
+    uint8_t dirty = 0;
     String Addr = String(device->addr.toString().c_str());
     Addr.toUpperCase();
     Addr.replace(":", "-");
 
-    if (all || device->publish_rssi) {
-      if (json.length() > 0)
-        json += ",";
-      json += "\"RSSI\":" + String(device->rssi);
-      device->publish_rssi = false;
+    if (all)
+      dirty = PAYLOAD_DIRTY_ALL;
+    else {
+      if (device->publish_rssi && !_config.zone.enabled)
+        dirty |= PAYLOAD_DIRTY_RSSI;
+      if (device->publish_name)
+        dirty |= PAYLOAD_DIRTY_NAME;
+      if (device->publish_manufacturer)
+        dirty |= PAYLOAD_DIRTY_MANUFACTURER;
+      if (device->publish_battery)
+        dirty |= PAYLOAD_DIRTY_BATTERY;
+      if (device->publish_info)
+        dirty |= PAYLOAD_DIRTY_INFO;
+      if (device->publish_frame)
+        dirty |= PAYLOAD_DIRTY_FRAME;
+      if (device->publish_presence)
+        dirty |= PAYLOAD_DIRTY_PRESENCE;
     }
-    if (all || device->publish_name) {
-      if (json.length() > 0)
-        json += ",";
-      json += "\"Name\":\"" + String(device->name) + "\"";
-      device->publish_name = false;
-    }
-    if (all || device->publish_manufacturer) {
-      if (json.length() > 0)
-        json += ",";
-      json += "\"ManufacturerId\":\"" + String(BLEManufacturerIdHex(device->manufacturer_id)) + "\"";
-      json += ",";
-      json += "\"Manufacturer\":\"" + String(device->manufacturer) + "\"";
-      device->publish_manufacturer = false;
-    }
-    if (all || device->publish_battery) {
-      if (json.length() > 0)
-        json += ",";
-      json += "\"Battery\":" + String(device->has_battery ? 1 : 0);
-      json += ",";
-      json += "\"BatteryLevel\":" + String(device->battery_level);
-      device->publish_battery = false;
-    }
-    if (all || json.length() > 0) {
-      /*
-         whenever we publish something, we will also publish the last_seen and the scanning device
-      */
-      json = "\"ScannerCID\":\"" + String(_config.mqtt.clientID) + "\"," + json;
-      json = "\"Scanner\":\"" + String(_config.device.name) + "\"," + json;
-      json = "\"last_seen\":" + String(device->last_seen) + "," + json;
-    }
-    if ((all || device->publish_presence || json.length() > 0) && (device->present || _config.mqtt.publish_absence)) {
-      /*
-         whenever we publish something, we will also publish the presence state
-      */
-      String presence = "\"presence\":\"" + String((device->present) ? "present" : "absent") + "\"";
-
-      if (json.length() > 0)
-        json = presence + "," + json;
-      else
-        json = presence;
+    if (all || !_config.zone.enabled)
+      device->publish_rssi = false;
+    device->publish_name = false;
+    device->publish_manufacturer = false;
+    device->publish_battery = false;
+    device->publish_info = false;
+    device->publish_frame = false;
+    if (device->present || _config.mqtt.publish_absence)
       device->publish_presence = false;
+
+    if (device->payload_generation != PayloadGeneration()) {
+      device->payload = PayloadLookup(device->addr);
+      device->payload_generation = PayloadGeneration();
     }
+
+    String json = PayloadSerialize(device, device->payload, dirty);
+
     if (json.length() > 0)
       MqttPublish(Addr, "{" + json + "}");
 
+    if (device->publish_zone) {
+      /*
+         publish the zone transition as an event of its own
+      */
+      device->publish_zone = false;
+      if (_config.zone.enabled)
+        MqttPublish(Addr + "/zone", "{\"zone\":\"" + String(ScanDevZoneName(device->zone)) + "\","
+                    "\"previous\":\"" + ScanDevZoneName(device->zone_previous) + "\","
+                    "\"RSSI\":" + String(device->rssi_smoothed >> 4) + ","
+                    "\"Scanner\":\"" + String(_config.device.name) + "\"}");
+    }
+
     device->publish = false;
     device->last_published = now();
   }
@@ -398,6 +908,25 @@ void ScanDevListHTML(void (*callback)(const String& content))
 */
 void ScanDevSetup(void)
 {
+  /*
+     check and correct the config -- the thresholds have to descend
+
+     a config stored before the thresholds were flagged as configured
+     holds its thresholds, if the first one isn't 0
+  */
+  _config.zone.enabled = _config.zone.enabled ? true : false;
+  if (!_config.zone.configured && !_config.zone.threshold[0]) {
+    _config.zone.threshold[0] = SCANDEV_ZONE_IMMEDIATE_DEFAULT;
+    _config.zone.threshold[1] = SCANDEV_ZONE_NEAR_DEFAULT;
+    _config.zone.threshold[2] = SCANDEV_ZONE_FAR_DEFAULT;
+    for (int n = 0; n < CONFIG_ZONES; n++)
+      _config.zone.hysteresis[n] = SCANDEV_ZONE_HYSTERESIS_DEFAULT;
+  }
+  _config.zone.configured = true;
+  for (int n = 0; n < CONFIG_ZONES; n++) {
+    FIX_RANGE(_config.zone.threshold[n], SCANDEV_ZONE_RSSI_MIN, (n) ? _config.zone.threshold[n - 1] - 1 : SCANDEV_ZONE_RSSI_MAX);
+    FIX_RANGE(_config.zone.hysteresis[n], 0, SCANDEV_ZONE_HYSTERESIS_MAX);
+  }
 }
 
 /*
@@ -408,24 +937,97 @@ void ScanDevSetup(void)
 void ScanDevUpdate(void)
 {
   SCANDEV_T *device;
-  int absence_timeout = _config.bluetooth.absence_cycles * (_config.bluetooth.scan_time + _config.bluetooth.pause_time);
   static time_t _last = 0;
   bool all = MqttPublishAll();
 
   if (now() > _last) {
+    /*
+       the members whose device slot was reused left their group -- unless
+       the groups were set up again in the meantime
+    */
+    uint8_t left[CONFIG_GROUPS];
+    uint8_t generation;
+
+    portENTER_CRITICAL(&_scandev_group_mux);
+    memcpy(left, _scandev_group_left, sizeof(left));
+    memset(_scandev_group_left, 0, sizeof(_scandev_group_left));
+    generation = _scandev_group_generation;
+    portEXIT_CRITICAL(&_scandev_group_mux);
+    if (generation == GroupGeneration())
+      for (int n = 0; n < CONFIG_GROUPS; n++)
+        while (left[n]--)
+          GroupMember(n, false);
+
+    /*
+       publish the sessions of the devices whose slot was reused, as long
+       as they matched the rule
+    */
+    for (;;) {
+      SCANDEV_T session;
+      bool pending;
+
+      portENTER_CRITICAL(&_scandev_session_mux);
+      if ((pending = _scandev_sessions_pending > 0))
+        memcpy((void *) &session, (void *) &_scandev_sessions[--_scandev_sessions_pending], sizeof(SCANDEV_T));
+      portEXIT_CRITICAL(&_scandev_session_mux);
+      if (!pending)
+        break;
+      if (FilterMatch(&session))
+        ScanDevPublishSession(&session);
+    }
+
     /*
        scan our list to check if this device is already known
     */
     for (device = _scandev_first; device; device = device->next) {
       /*
-         set the device absent, if it was too long unseen
+         set the device absent, if it was too long unseen or its score decayed
       */
-      if (device->present && now() - device->last_seen > absence_timeout) {
+      bool absent;
+
+      if (_config.bluetooth.presence_score) {
+        time_t from = MAX(_last - device->last_seen, (time_t) 0);
+        time_t to = MAX(now() - device->last_seen, (time_t) 0);
+
+        device->score = PresenceDecay(device->score, from, to, BluetoothCycleTime(), _config.bluetooth.presence_leave, ScanDevAbsenceTimeout(device));
+        absent = !PresenceState(true, device->score, _config.bluetooth.presence_enter, _config.bluetooth.presence_leave);
+      }
+      else
+        absent = now() - device->last_seen > ScanDevAbsenceTimeout(device);
+      if (device->present && absent) {
         /*
-           the device is absent
+           the device is absent -- its session is published by its owner,
+           if the device matched the rule while it was present
         */
+        device->publish_session = device->claimed && FilterMatch(device);
         device->present = false;
         device->publish = true;
+        _scandev_present--;
+        _scandev_departures++;
+        OccupancyCount(&device->occupancy, device->manufacturer_id, device->zone, -1);
+        ScanDevZoneChange(device, SCANDEV_ZONE_NONE);
+      }
+
+      /*
+         resolve the group once and count the presence of its members
+      */
+      if (device->group_generation != GroupGeneration()) {
+        device->group = GroupLookup(device->addr);
+        device->group_generation = GroupGeneration();
+        device->group_counted = false;
+      }
+      if (device->group != GROUP_NONE && device->present != device->group_counted) {
+        GroupMember(device->group, device->present);
+        device->group_counted = device->present;
+      }
+
+      /*
+         report the presence changes to the event stream -- its digest
+         follows the present devices even while the stream is off
+      */
+      if (device->present != device->event_present) {
+        EventsPresence(device->addr, device->present);
+        device->event_present = device->present;
       }
       if (device->present && now() - device->last_published > _config.mqtt.publish_timeout) {
         /*
@@ -434,13 +1036,33 @@ void ScanDevUpdate(void)
         device->publish = true;
       }
 
-      if (device->has_battery && device->present && now() - device->last_battcheck > _config.bluetooth.battcheck_timeout) {
+      if (device->present && !device->connect_queued) {
         /*
-           time to check the battery
+           time to check the battery -- unless the device advertised its battery level
+           recently, failed checks are retried with a growing interval
         */
-        ScanDevCheckBattery(device);
+        bool read_battery = device->has_battery
+                            && now() - device->last_battadv > _config.bluetooth.battcheck_timeout
+                            && now() - device->last_battcheck > (time_t) (_config.bluetooth.battcheck_timeout << device->battcheck_failures);
+
+        /*
+           time to read the device information -- only if the cache entry expired
+        */
+        bool read_info = _config.bluetooth.enrich && device->connectable && GattCacheExpired(device->addr);
+
+        if (read_battery || read_info)
+          device->connect_queued = BatteryRequest(device, read_battery, read_info);
       }
 
+      /*
+         check the claim of the device, once we take it over, all of it is published
+      */
+      bool claimed = DedupDevice(device);
+
+      if (claimed && !device->claimed && _config.dedup.enabled)
+        device->claim_takeover = true;
+      device->claimed = claimed;
+
       /*
          publish the device
       */
@@ -29,6 +29,7 @@
 #include "config.h"
 #include "bluetooth.h"
 #include "ble-manufacturer.h"
+#include "advdecode.h"
 
 /*
    how mandy device should be keep in our list
@@ -41,6 +42,48 @@
 */
 #define SCANDEV_NAME_LENGTH        20
 
+/*
+   number of cycles before the learned absence timeout of a device is used
+*/
+#define SCANDEV_LEARN_CYCLES       8
+
+/*
+   upper limit of the learned absence timeout in cycles
+*/
+#define SCANDEV_ABSENCE_CYCLES_MAX (4 * BLUETOOTH_ABSENCE_CYCLES_MAX)
+
+/*
+   gaps between two advertisements longer than this are not taken as advertising interval in ms
+*/
+#define SCANDEV_INTERVAL_MAX       10000
+
+/*
+   number of open sessions of reused device slots waiting to be published
+*/
+#define SCANDEV_SESSIONS_PENDING   4
+
+
+/*
+   the proximity zones
+*/
+enum SCANDEV_ZONE {
+  SCANDEV_ZONE_NONE = 0,          // device is absent
+  SCANDEV_ZONE_IMMEDIATE,
+  SCANDEV_ZONE_NEAR,
+  SCANDEV_ZONE_FAR,
+  SCANDEV_ZONE_REMOTE,            // below the threshold of the far zone
+};
+
+/*
+   defaults & ranges of the zone thresholds
+*/
+#define SCANDEV_ZONE_RSSI_MIN           -120
+#define SCANDEV_ZONE_RSSI_MAX           0
+#define SCANDEV_ZONE_HYSTERESIS_MAX     20
+#define SCANDEV_ZONE_IMMEDIATE_DEFAULT  -55
+#define SCANDEV_ZONE_NEAR_DEFAULT       -70
+#define SCANDEV_ZONE_FAR_DEFAULT        -85
+#define SCANDEV_ZONE_HYSTERESIS_DEFAULT 4
 
 /*
    struct to hold a found BLE device
@@ -57,6 +100,7 @@ typedef struct _scandev_device {
   */
   uint16_t manufacturer_id;
   const char *manufacturer;
+  int8_t occupancy;                 // bucket of the manufacturer counted in while present, see occupancy.h
 
   /*
      battery
@@ -64,14 +108,78 @@ typedef struct _scandev_device {
   bool has_battery;
   uint8_t battery_level;
   time_t last_battcheck;
+  time_t last_battadv;
+  bool battadv;                     // the last payload carried the battery level
+  uint8_t battcheck_failures;
+
+  /*
+     GATT connection
+  */
+  bool connectable;
+  bool connect_queued;
+
+  /*
+     the last decoded frame and the fingerprint of the payload
+  */
+  ADVDECODE_T frame;
+  uint32_t fingerprint;
 
   /*
      state
   */
+  time_t first_seen;                // start of the current session
   time_t last_seen;
   bool present;
   int rssi;
 
+  /*
+     estimation of the advertising interval and the detection rate per cycle
+  */
+  uint32_t last_received;           // millis() of the last advertisement
+  uint16_t interval;                // advertising interval in ms
+  uint8_t detection;                // probability to detect the device in a cycle, 1/256
+  uint8_t cycles;                   // number of cycles observed, saturated
+  uint8_t absence_cycles;           // learned number of missed cycles to set the device absent
+  uint16_t score;                   // presence score, see presence.h
+
+  /*
+     proximity zone
+  */
+  int16_t rssi_smoothed;            // RSSI with 4 fractional bits
+  uint8_t zone;
+  uint8_t zone_previous;
+
+  /*
+     group membership -- resolved in the cyclic update, see group.h
+  */
+  int8_t group;
+  uint8_t group_generation;
+  bool group_counted;               // the presence is counted in the group
+
+  /*
+     the presence as reported to the event stream, see events.h
+  */
+  bool event_present;
+
+  /*
+     the emit plan of the published fields, see payload.h
+  */
+  int8_t payload;
+  uint8_t payload_generation;
+  bool filter_matched;              // the device matched the rule when it was published last
+
+  /*
+     ownership among several scanners, see dedup.h
+  */
+  bool claimed;                     // this scanner owns the device
+  bool claim_takeover;              // publish all of the device, as we just took it over
+
+  /*
+     aggregation of the current session
+  */
+  int8_t session_rssi_max;
+  uint16_t session_sightings;
+
   /*
      MQTT publishing
   */
@@ -79,8 +187,12 @@ typedef struct _scandev_device {
   bool publish_name;
   bool publish_manufacturer;
   bool publish_battery;
+  bool publish_info;
+  bool publish_frame;
   bool publish_rssi;
   bool publish_presence;
+  bool publish_zone;
+  bool publish_session;
   bool publish;
   time_t last_published;
 
@@ -91,10 +203,74 @@ typedef struct _scandev_device {
   struct _scandev_device *next;
 } SCANDEV_T;
 
+/*
+   return the name of a zone
+*/
+const char *ScanDevZoneName(int zone);
+
+/*
+   compute the fingerprint of an advertisement payload
+*/
+uint32_t ScanDevFingerprint(const uint8_t *payload, size_t length);
+
+/*
+   fast path for a known device sending the same payload as before
+
+   return false if the advertisement has to be processed by ScanDevAdd()
+*/
+bool ScanDevSeen(const BLEAddress &addr, uint32_t fingerprint, const int rssi);
+
 /*
    add a scanned device to the list
+
+   the battery level is -1 if it wasn't advertised
+*/
+bool ScanDevAdd(const BLEAddress addr, const char *name, const uint16_t manufacturer_id, const int rssi, bool has_battery, const int adv_battery_level, const bool connectable, const bool scannable, const ADVDECODE_T *frame, uint32_t fingerprint);
+
+/*
+   return the number of advertisements handled by the fast path and by ScanDevAdd()
+*/
+void ScanDevFastPathStats(unsigned long *fast, unsigned long *slow);
+
+/*
+   a scan cycle ended -- update the detection rate of the present devices
+*/
+void ScanDevCycle(time_t scan_start);
+
+/*
+   return the number of present devices using a learned absence timeout
+*/
+int ScanDevCountLearned(void);
+
+/*
+   return the number of devices seen since the given time
+*/
+int ScanDevCountSeen(time_t since);
+
+/*
+   return the number of present devices
+*/
+int ScanDevCountPresent(void);
+
+/*
+   fill in the addresses of the devices counted in the event stream -- return their number
+*/
+int ScanDevEventAddresses(uint64_t *addrs, int max);
+
+/*
+   return the number of arrivals, departures and new devices since the last call
+*/
+void ScanDevChurn(int *arrivals, int *departures, int *new_devices);
+
+/*
+   take over the result of a battery check
+*/
+void ScanDevBatteryResult(SCANDEV_T *device, const BLEAddress &addr, bool success, uint8_t battery_level);
+
+/*
+   the device information of a device was read into the GATT cache
 */
-bool ScanDevAdd(const BLEAddress addr, const char *name, const uint16_t manufacturer_id, const int rssi, const bool has_battery);
+void ScanDevInfoResult(SCANDEV_T *device, const BLEAddress &addr);
 
 #if DBG
 /*
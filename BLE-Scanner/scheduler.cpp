@@ -0,0 +1,193 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to schedule the scan and pause times
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "state.h"
+#include "bluetooth.h"
+#include "scandev.h"
+#include "scheduler.h"
+#include "util.h"
+
+/*
+   the current scan and pause time in seconds
+*/
+static unsigned long _scan_time = 0;
+static unsigned long _pause_time = 0;
+
+/*
+   number of cycles without any churn
+*/
+static int _quiet_cycles = 0;
+
+/*
+   the reason of the last change and when it was done
+*/
+static const char *_reason = "configured";
+static time_t _last_change = 0;
+
+/*
+   set the timeout values in the status table
+*/
+static void SchedulerApply(void)
+{
+  StateModifyTimeout(STATE_SCANNING, (_scan_time + 5) * 1000);
+  StateModifyTimeout(STATE_PAUSING, _pause_time * 1000);
+}
+
+/*
+   setup the scheduler
+*/
+void SchedulerSetup(void)
+{
+  /*
+     check and correct the config
+  */
+  _config.bluetooth.adaptive = _config.bluetooth.adaptive ? true : false;
+  if (!_config.bluetooth.scan_time_max)
+    _config.bluetooth.scan_time_max = BLUETOOTH_SCAN_TIME_MAX;
+  if (!_config.bluetooth.pause_time_max)
+    _config.bluetooth.pause_time_max = SCHEDULER_PAUSE_TIME_MAX_DEFAULT;
+  FIX_RANGE(_config.bluetooth.scan_time_min, BLUETOOTH_SCAN_TIME_MIN, BLUETOOTH_SCAN_TIME_MAX);
+  FIX_RANGE(_config.bluetooth.scan_time_max, _config.bluetooth.scan_time_min, BLUETOOTH_SCAN_TIME_MAX);
+  FIX_RANGE(_config.bluetooth.pause_time_min, BLUETOOTH_PAUSE_TIME_MIN, BLUETOOTH_PAUSE_TIME_MAX);
+  FIX_RANGE(_config.bluetooth.pause_time_max, _config.bluetooth.pause_time_min, BLUETOOTH_PAUSE_TIME_MAX);
+
+  /*
+     start with the configured times
+  */
+  _scan_time = _config.bluetooth.scan_time;
+  _pause_time = _config.bluetooth.pause_time;
+  if (_config.bluetooth.adaptive) {
+    FIX_RANGE(_scan_time, _config.bluetooth.scan_time_min, _config.bluetooth.scan_time_max);
+    FIX_RANGE(_pause_time, _config.bluetooth.pause_time_min, _config.bluetooth.pause_time_max);
+  }
+  _quiet_cycles = 0;
+  _reason = "configured";
+  _last_change = now();
+
+  SchedulerApply();
+}
+
+/*
+   adapt the scan and pause time at the end of a scan
+*/
+void SchedulerUpdate(void)
+{
+  int arrivals, departures, new_devices;
+
+  ScanDevChurn(&arrivals, &departures, &new_devices);
+  if (!_config.bluetooth.adaptive || _config.bluetooth.continuous)
+    return;
+
+  int churn = arrivals + departures + new_devices;
+  int busy = MAX(SCHEDULER_CHURN_MIN, ScanDevCountPresent() * SCHEDULER_CHURN_PERCENT / 100);
+  unsigned long scan_time = _scan_time;
+  unsigned long pause_time = _pause_time;
+
+#if DBG_SCHEDULER
+  DbgMsg("SCHED: arrivals=%d  departures=%d  new=%d  busy=%d", arrivals, departures, new_devices, busy);
+#endif
+
+  if (churn >= busy) {
+    /*
+       a lot is going on -- scan longer and pause shorter
+    */
+    _quiet_cycles = 0;
+    scan_time = MIN(_scan_time + MAX(_scan_time / 2, 1), _config.bluetooth.scan_time_max);
+    pause_time = MAX(_pause_time / 2, _config.bluetooth.pause_time_min);
+    if (scan_time != _scan_time || pause_time != _pause_time)
+      _reason = (new_devices >= arrivals + departures) ? "new devices" : (arrivals >= departures) ? "arrivals" : "departures";
+  }
+  else if (churn == 0) {
+    /*
+       nothing changed for a while -- scan shorter and pause longer
+    */
+    if (++_quiet_cycles >= SCHEDULER_QUIET_CYCLES) {
+      _quiet_cycles = 0;
+      scan_time = MAX(_scan_time * 2 / 3, _config.bluetooth.scan_time_min);
+      pause_time = MIN(_pause_time * 2, _config.bluetooth.pause_time_max);
+      if (scan_time != _scan_time || pause_time != _pause_time)
+        _reason = "quiet";
+    }
+  }
+  else
+    _quiet_cycles = 0;
+
+  if (scan_time != _scan_time || pause_time != _pause_time) {
+    LogMsg("SCHED: %s -- changing scan time from %lu s to %lu s and pause time from %lu s to %lu s",
+           _reason, _scan_time, scan_time, _pause_time, pause_time);
+    _scan_time = scan_time;
+    _pause_time = pause_time;
+    _last_change = now();
+    SchedulerApply();
+  }
+}
+
+/*
+   return the current scan time in seconds
+*/
+unsigned long SchedulerScanTime(void)
+{
+  return _scan_time;
+}
+
+/*
+   return the current pause time in seconds
+*/
+unsigned long SchedulerPauseTime(void)
+{
+  return _pause_time;
+}
+
+/*
+   return the current duty cycle in percent
+*/
+int SchedulerDutyCycle(void)
+{
+  if (_config.bluetooth.continuous)
+    return 100;
+  return (_scan_time + _pause_time) ? (_scan_time * 100) / (_scan_time + _pause_time) : 0;
+}
+
+/*
+   return the reason of the last change
+*/
+const char *SchedulerReason(void)
+{
+  return _reason;
+}
+
+/*
+   return the scheduler status as JSON members
+*/
+String SchedulerStatus(void)
+{
+  return "\"Adaptive\":" + String(_config.bluetooth.adaptive ? 1 : 0) + ","
+         "\"ScanTime\":" + String(_scan_time) + ","
+         "\"PauseTime\":" + String(_pause_time) + ","
+         "\"DutyCycle\":" + String(SchedulerDutyCycle()) + ","
+         "\"Reason\":\"" + String(_reason) + "\","
+         "\"LastChange\":" + String(_last_change);
+}/**/
@@ -0,0 +1,86 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to schedule the scan and pause times
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__ 1
+
+#include "config.h"
+#include "util.h"
+
+/*
+   a cycle with at least this number of arrivals, departures and new devices
+   is considered busy -- or with this share of the present devices
+*/
+#define SCHEDULER_CHURN_MIN       2
+#define SCHEDULER_CHURN_PERCENT   10
+
+/*
+   number of cycles without any churn before the scans get shorter
+*/
+#define SCHEDULER_QUIET_CYCLES    3
+
+/*
+   default upper bound of the adaptive pause time
+*/
+#define SCHEDULER_PAUSE_TIME_MAX_DEFAULT  (10 * 60)
+
+/*
+   setup the scheduler
+*/
+void SchedulerSetup(void);
+
+/*
+   adapt the scan and pause time at the end of a scan
+*/
+void SchedulerUpdate(void);
+
+/*
+   return the current scan time in seconds
+*/
+unsigned long SchedulerScanTime(void);
+
+/*
+   return the current pause time in seconds
+*/
+unsigned long SchedulerPauseTime(void);
+
+/*
+   return the current duty cycle in percent
+*/
+int SchedulerDutyCycle(void);
+
+/*
+   return the reason of the last change
+*/
+const char *SchedulerReason(void);
+
+/*
+   return the scheduler status as JSON members
+*/
+String SchedulerStatus(void);
+
+#endif
+
+/**/
@@ -0,0 +1,290 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to publish the values of sensor tags
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "mqtt.h"
+#include "sensor.h"
+#include "util.h"
+
+/*
+   sensor tags advertise their values several times per second -- each
+   metric is only published, if it changed by more than its deadband and
+   the minimum interval passed, or if the heartbeat interval passed
+*/
+
+/*
+   the properties of the metrics
+*/
+static const struct {
+  const char *name;       // name of the subtopic
+  const char *unit;       // unit of the fixed point value
+  int scale;              // divisor to get the published value
+  int decimals;           // decimals of the published value
+  int deadband_abs;       // default deadbands
+  int deadband_rel;
+} _metrics[ADVDECODE_METRICS] = {
+  { "temperature",  "0.01 &deg;C",  100,  2,  20,   0 },
+  { "humidity",     "0.01 %",       100,  2,  100,  0 },
+  { "pressure",     "Pa",           100,  2,  20,   0 },
+  { "battery",      "%",            1,    0,  1,    0 },
+  { "voltage",      "mV",           1000, 3,  50,   0 },
+  { "illuminance",  "0.01 lx",      100,  2,  0,    100 },
+  { "co2",          "ppm",          1,    0,  20,   20 },
+};
+
+static_assert(ADVDECODE_METRICS <= CONFIG_SENSOR_METRICS, "too many metrics for the configuration");
+
+/*
+   the state of a sensor tag
+*/
+typedef struct _sensor {
+  uint64_t addr;
+  unsigned long last_sample;        // time of the last sample in seconds
+  uint8_t fresh;                    // metrics with a new sample
+  uint8_t published;                // metrics published at least once
+  struct {
+    int32_t sample;                 // last sample
+    int32_t value;                  // last published value
+    unsigned long published;        // time of the last publishing in seconds
+  } metric[ADVDECODE_METRICS];
+} SENSOR_T;
+
+/*
+   the table is changed by the NimBLE task and published by the loop,
+   so it is only accessed while holding the lock
+*/
+static SENSOR_T _sensors[SENSOR_LENGTH];
+static volatile int _sensor_count = 0;
+static portMUX_TYPE _sensor_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/*
+   some stats
+*/
+static volatile unsigned long _samples = 0;
+static unsigned long _published = 0;
+
+/*
+   setup the sensor module
+*/
+void SensorSetup(void)
+{
+  /*
+     check and correct the config
+  */
+  _config.sensor.enabled = _config.sensor.enabled ? true : false;
+  if (!_config.sensor.heartbeat) {
+    /*
+       the settings were never stored -- take over the defaults
+    */
+    _config.sensor.min_interval = SENSOR_MIN_INTERVAL_DEFAULT;
+    _config.sensor.heartbeat = SENSOR_HEARTBEAT_DEFAULT;
+    for (int n = 0; n < ADVDECODE_METRICS; n++) {
+      _config.sensor.deadband_abs[n] = _metrics[n].deadband_abs;
+      _config.sensor.deadband_rel[n] = _metrics[n].deadband_rel;
+    }
+  }
+  FIX_RANGE(_config.sensor.min_interval, SENSOR_MIN_INTERVAL_MIN, SENSOR_MIN_INTERVAL_MAX);
+  FIX_RANGE(_config.sensor.heartbeat, SENSOR_HEARTBEAT_MIN, SENSOR_HEARTBEAT_MAX);
+  for (int n = 0; n < ADVDECODE_METRICS; n++) {
+    FIX_RANGE(_config.sensor.deadband_abs[n], 0, SENSOR_DEADBAND_ABS_MAX);
+    FIX_RANGE(_config.sensor.deadband_rel[n], 0, SENSOR_DEADBAND_REL_MAX);
+  }
+}
+
+/*
+   take over the values of a sensor frame
+
+   NOTE: this is called in the context of the NimBLE task
+*/
+void SensorSample(const BLEAddress &addr, const ADVDECODE_T *frame)
+{
+  uint64_t key = (uint64_t) addr;
+  SENSOR_T *sensor = NULL;
+  int n;
+
+  if (!_config.sensor.enabled || frame->type != ADVDECODE_SENSOR)
+    return;
+
+  portENTER_CRITICAL(&_sensor_mux);
+  for (n = 0; n < _sensor_count && _sensors[n].addr != key; n++);
+  if (n < _sensor_count)
+    sensor = &_sensors[n];
+  else {
+    /*
+       a new sensor -- replace the one which wasn't seen for the longest time
+    */
+    if (_sensor_count < SENSOR_LENGTH)
+      sensor = &_sensors[_sensor_count++];
+    else {
+      sensor = &_sensors[0];
+      for (n = 1; n < SENSOR_LENGTH; n++)
+        if (_sensors[n].last_sample < sensor->last_sample)
+          sensor = &_sensors[n];
+    }
+    memset(sensor, 0, sizeof(SENSOR_T));
+    sensor->addr = key;
+  }
+
+  for (n = 0; n < ADVDECODE_METRICS; n++) {
+    if (frame->sensor.present & (1 << n)) {
+      sensor->metric[n].sample = frame->sensor.value[n];
+      sensor->fresh |= 1 << n;
+      _samples++;
+    }
+  }
+  sensor->last_sample = millis() / 1000;
+  portEXIT_CRITICAL(&_sensor_mux);
+}
+
+/*
+   format a fixed point value
+*/
+static String SensorFormat(int metric, int32_t value)
+{
+  char buffer[16];
+  int scale = _metrics[metric].scale;
+
+  if (scale == 1)
+    sprintf(buffer, "%ld", (long) value);
+  else
+    sprintf(buffer, "%s%ld.%0*ld", (value < 0) ? "-" : "", (long) abs(value / scale),
+            _metrics[metric].decimals, (long) abs(value % scale));
+  return String(buffer);
+}
+
+/*
+   check if the sample of a metric differs significantly from its published value
+*/
+static bool SensorSignificant(const SENSOR_T *sensor, int metric)
+{
+  int32_t sample = sensor->metric[metric].sample;
+  int32_t value = sensor->metric[metric].value;
+  int32_t deadband = MAX((int32_t) _config.sensor.deadband_abs[metric],
+                         (int32_t) ((int64_t) abs(value) * _config.sensor.deadband_rel[metric] / 1000));
+
+  return abs(sample - value) > deadband;
+}
+
+/*
+   do the cyclic update -- publish the metrics which changed enough
+*/
+void SensorUpdate(void)
+{
+  unsigned long now_s = millis() / 1000;
+
+  for (int n = 0; n < _sensor_count; n++) {
+    SENSOR_T sensor;
+    uint8_t done = 0, sent = 0;
+
+    /*
+       work on a copy, so the NimBLE task isn't blocked while publishing
+    */
+    portENTER_CRITICAL(&_sensor_mux);
+    sensor = _sensors[n];
+    portEXIT_CRITICAL(&_sensor_mux);
+
+    if (!sensor.fresh)
+      continue;
+
+    String Addr = String(BLEAddress(sensor.addr, BLE_ADDR_PUBLIC).toString().c_str());
+    Addr.toUpperCase();
+    Addr.replace(":", "-");
+
+    for (int metric = 0; metric < ADVDECODE_METRICS; metric++) {
+      if (!(sensor.fresh & (1 << metric)))
+        continue;
+
+      bool published = sensor.published & (1 << metric);
+      bool significant = !published || SensorSignificant(&sensor, metric);
+      unsigned long age = now_s - sensor.metric[metric].published;
+
+      if (!significant && age < _config.sensor.heartbeat) {
+        /*
+           the change is too small -- wait for the next sample
+        */
+        done |= 1 << metric;
+        continue;
+      }
+      if (published && age < _config.sensor.min_interval && age < _config.sensor.heartbeat) {
+        /*
+           too early -- keep the sample until the minimum interval passed
+        */
+        continue;
+      }
+
+      done |= 1 << metric;
+      sent |= 1 << metric;
+      _published++;
+#if DBG_SENSOR
+      DbgMsg("SENSOR: %s %s=%ld", Addr.c_str(), _metrics[metric].name, (long) sensor.metric[metric].sample);
+#endif
+      MqttPublish(Addr + "/" + _metrics[metric].name, SensorFormat(metric, sensor.metric[metric].sample));
+    }
+
+    /*
+       write back -- unless the slot was taken over by another sensor, and
+       keep the samples which arrived in the meantime fresh
+    */
+    portENTER_CRITICAL(&_sensor_mux);
+    if (_sensors[n].addr == sensor.addr) {
+      for (int metric = 0; metric < ADVDECODE_METRICS; metric++) {
+        if (sent & (1 << metric)) {
+          _sensors[n].metric[metric].value = sensor.metric[metric].sample;
+          _sensors[n].metric[metric].published = now_s;
+          _sensors[n].published |= 1 << metric;
+        }
+        if ((done & (1 << metric)) && _sensors[n].metric[metric].sample == sensor.metric[metric].sample)
+          _sensors[n].fresh &= ~(1 << metric);
+      }
+    }
+    portEXIT_CRITICAL(&_sensor_mux);
+  }
+}
+
+/*
+   return the name of a metric
+*/
+const char *SensorMetricName(int metric)
+{
+  return _metrics[metric].name;
+}
+
+/*
+   return the unit of a metric as used in the settings
+*/
+const char *SensorMetricUnit(int metric)
+{
+  return _metrics[metric].unit;
+}
+
+/*
+   get some stats
+*/
+void SensorStats(int *sensors, unsigned long *samples, unsigned long *published)
+{
+  *sensors = _sensor_count;
+  *samples = _samples;
+  *published = _published;
+}/**/
@@ -0,0 +1,84 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to publish the values of sensor tags
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SENSOR_H__
+#define __SENSOR_H__ 1
+
+#include <NimBLEDevice.h>
+#include "config.h"
+#include "advdecode.h"
+
+/*
+   number of sensor tags we keep track of
+*/
+#define SENSOR_LENGTH                 32
+
+/*
+   ranges of the settings
+*/
+#define SENSOR_MIN_INTERVAL_MIN       0             // seconds
+#define SENSOR_MIN_INTERVAL_MAX       (60 * 60)
+#define SENSOR_MIN_INTERVAL_DEFAULT   30
+#define SENSOR_HEARTBEAT_MIN          10            // seconds
+#define SENSOR_HEARTBEAT_MAX          (24 * 60 * 60)
+#define SENSOR_HEARTBEAT_DEFAULT      (15 * 60)
+#define SENSOR_DEADBAND_ABS_MAX       100000
+#define SENSOR_DEADBAND_REL_MAX       1000          // 0.1 %
+
+/*
+   setup the sensor module
+*/
+void SensorSetup(void);
+
+/*
+   take over the values of a sensor frame
+
+   NOTE: this is called in the context of the NimBLE task
+*/
+void SensorSample(const BLEAddress &addr, const ADVDECODE_T *frame);
+
+/*
+   do the cyclic update -- publish the metrics which changed enough
+*/
+void SensorUpdate(void);
+
+/*
+   return the name of a metric
+*/
+const char *SensorMetricName(int metric);
+
+/*
+   return the unit of a metric as used in the settings
+*/
+const char *SensorMetricUnit(int metric);
+
+/*
+   get some stats
+*/
+void SensorStats(int *sensors, unsigned long *samples, unsigned long *published);
+
+#endif
+
+/**/
@@ -33,6 +33,7 @@
 */
 static int _state = STATE_NONE;
 static int _state_new = STATE_NONE;
+static volatile int _state_done = STATE_NONE;
 static unsigned long _state_timer = 0;
 
 /*
@@ -51,8 +52,8 @@ static STATES _states[] = {
   { STATE_PAUSING, STATE_SCANNING, BLUETOOTH_SCAN_TIME_MAX * 1000 },
 
   /*
-     normally the state will change from scanning to pausing upon finished scan,
-     this entry is just to be sure
+     normally the state will change from scanning to pausing upon finished scan
+     signaled by the BLE stack, this timeout is just to be sure
   */
   { STATE_SCANNING, STATE_PAUSING, BLUETOOTH_SCAN_TIME_MAX * 1000 },
 
@@ -69,6 +70,22 @@ static STATES _states[] = {
 };
 
 
+/*
+   the table entry of the current state
+*/
+static STATES *_state_entry = NULL;
+
+/*
+   lookup the table entry of a state
+*/
+static STATES *StateLookup(int state)
+{
+  for (int n = 0; n < sizeof(_states) / sizeof(_states[0]); n++)
+    if (_states[n].state == state)
+      return &_states[n];
+  return NULL;
+}
+
 /*
    setup the state maschine
 */
@@ -101,32 +118,33 @@ int StateUpdate(void)
     new_state = _state_new;
     _state_new = STATE_NONE;
   }
-  else {
+  else if (_state_entry) {
     /*
        normal state maschine
     */
-    for (int n = 0; n < sizeof(_states) / sizeof(_states[0]); n++) {
-      if (_states[n].state == _state) {
-        /*
-           we found the state in our table
-        */
-        if ((_state_timer && now > _state_timer) || _states[n].timeout <= 0) {
-          /*
-            timer expired or, there was no timeout, change the state
-          */
-          new_state = _states[n].next;
-        }
-        else if (!_state_timer) {
-          /*
-             start the timer for this state change
-          */
+    if (_state_done == _state) {
+      /*
+         the state signaled that it is finished
+      */
+#if DBG_STATE
+      DbgMsg("STATE: state %d signaled to be finished", _state);
+#endif
+      new_state = _state_entry->next;
+    }
+    else if ((_state_timer && now > _state_timer) || _state_entry->timeout <= 0) {
+      /*
+        timer expired or, there was no timeout, change the state
+      */
+      new_state = _state_entry->next;
+    }
+    else if (!_state_timer) {
+      /*
+         start the timer for this state change
+      */
 #if DBG_STATE
-          DbgMsg("STATE: starting timer to change from %d to %d in %lums", _state, _states[n].next, _states[n].timeout);
+      DbgMsg("STATE: starting timer to change from %d to %d in %lums", _state, _state_entry->next, _state_entry->timeout);
 #endif
-          _state_timer = now + _states[n].timeout;
-        }
-        break;
-      }
+      _state_timer = now + _state_entry->timeout;
     }
   }
 
@@ -141,6 +159,8 @@ int StateUpdate(void)
     DbgMsg("STATE: changing from %d to %d", _state, new_state);
 #endif
     _state_timer = 0;
+    _state_done = STATE_NONE;
+    _state_entry = StateLookup(new_state);
     return _state = new_state;
   }
   return STATE_NONE;
@@ -177,6 +197,17 @@ void StateModifyTimeout(int state, unsigned int timeout)
   }
 }
 
+/*
+   signal that the given state is finished -- the state maschine will
+   move on to the next state without waiting for the timeout
+
+   may be called from other tasks, like the callbacks of the BLE stack
+*/
+void StateSignal(int state)
+{
+  _state_done = state;
+}
+
 /*
    check if we are in a certain state
 
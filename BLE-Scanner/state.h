@@ -67,6 +67,14 @@ void StateChange(int state);
 */
 void StateModifyTimeout(int state, unsigned int timeout);
 
+/*
+   signal that the given state is finished -- the state maschine will
+   move on to the next state without waiting for the timeout
+
+   may be called from other tasks, like the callbacks of the BLE stack
+*/
+void StateSignal(int state);
+
 /*
    check if we are in a certain state
 */
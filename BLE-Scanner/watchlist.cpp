@@ -0,0 +1,234 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to handle the watchlist of devices
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "config.h"
+#include "watchlist.h"
+#include "util.h"
+
+/*
+   the watched addresses as sorted numbers for a binary search
+*/
+static uint64_t _watchlist[CONFIG_WATCHLIST_LENGTH];
+static int _watchlist_count = 0;
+
+/*
+   the watchlist has to be loaded into the controller
+*/
+static bool _watchlist_changed = true;
+
+/*
+   the controller filters the scan results
+*/
+static bool _watchlist_controller = false;
+
+/*
+   convert a configured address into a BLE address
+*/
+static BLEAddress WatchlistAddress(int n)
+{
+  return BLEAddress(std::string(AddressToString(_config.watchlist.addr[n], MAC_ADDR_LEN, false, ':')), BLE_ADDR_PUBLIC);
+}
+
+/*
+   compare two watchlist entries for qsort
+*/
+static int WatchlistCompare(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *) a;
+  uint64_t y = *(const uint64_t *) b;
+
+  return (x > y) - (x < y);
+}
+
+/*
+   setup the watchlist out of the configuration
+*/
+void WatchlistSetup(void)
+{
+  /*
+     check and correct the config
+  */
+  _config.watchlist.enabled = _config.watchlist.enabled ? true : false;
+  FIX_RANGE(_config.watchlist.count, 0, CONFIG_WATCHLIST_LENGTH);
+
+  /*
+     build the sorted lookup table
+  */
+  for (_watchlist_count = 0; _watchlist_count < _config.watchlist.count; _watchlist_count++)
+    _watchlist[_watchlist_count] = (uint64_t) WatchlistAddress(_watchlist_count);
+  qsort(_watchlist, _watchlist_count, sizeof(_watchlist[0]), WatchlistCompare);
+
+  _watchlist_changed = true;
+
+  LogMsg("WATCHLIST: %s with %d addresses", (_config.watchlist.enabled) ? "enabled" : "disabled", _watchlist_count);
+}
+
+/*
+   return true if the watchlist mode is enabled
+*/
+bool WatchlistEnabled(void)
+{
+  return _config.watchlist.enabled;
+}
+
+/*
+   return the number of addresses on the watchlist
+*/
+int WatchlistCount(void)
+{
+  return _watchlist_count;
+}
+
+/*
+   return true if the given address is on the watchlist
+*/
+bool WatchlistContains(const BLEAddress &addr)
+{
+  return WatchlistSearch(_watchlist, _watchlist_count, (uint64_t) addr);
+}
+
+/*
+   load the watchlist into the controllers filter accept list
+
+   must be called while the scan is stopped
+
+   return true if the controller does the filtering
+*/
+bool WatchlistApply(NimBLEScan *scan)
+{
+  if (!_watchlist_changed)
+    return _watchlist_controller;
+
+  /*
+     clear the current list in the controller
+  */
+  while (NimBLEDevice::getWhiteListCount() > 0)
+    if (!NimBLEDevice::whiteListRemove(NimBLEDevice::getWhiteListAddress(0)))
+      break;
+
+  _watchlist_controller = false;
+  if (WatchlistEnabled() && _watchlist_count > 0 && _watchlist_count <= WATCHLIST_CONTROLLER_MAX) {
+    /*
+       try to load the list -- if the controller refuses,
+       we will fall back to the filtering on the host
+    */
+    _watchlist_controller = true;
+    for (int n = 0; n < _config.watchlist.count && _watchlist_controller; n++) {
+      if (!NimBLEDevice::whiteListAdd(WatchlistAddress(n))) {
+        LogMsg("WATCHLIST: controller refused address %s -- falling back to host filtering", WatchlistAddress(n).toString().c_str());
+        _watchlist_controller = false;
+      }
+    }
+    if (!_watchlist_controller) {
+      while (NimBLEDevice::getWhiteListCount() > 0)
+        if (!NimBLEDevice::whiteListRemove(NimBLEDevice::getWhiteListAddress(0)))
+          break;
+    }
+  }
+  scan->setFilterPolicy((_watchlist_controller) ? BLE_HCI_SCAN_FILT_USE_WL : BLE_HCI_SCAN_FILT_NO_WL);
+
+  LogMsg("WATCHLIST: filtering %d addresses on the %s", _watchlist_count, (_watchlist_controller) ? "controller" : "host");
+  _watchlist_changed = false;
+
+  return _watchlist_controller;
+}
+
+/*
+   return true if the controller does the filtering
+*/
+bool WatchlistControllerFiltering(void)
+{
+  return _watchlist_controller;
+}
+
+/*
+   the controller lost its filter accept list -- it has to be loaded again
+*/
+void WatchlistReset(void)
+{
+  _watchlist_controller = false;
+  _watchlist_changed = true;
+}
+
+/*
+   return true if the watchlist has to be loaded into the controller
+*/
+bool WatchlistChanged(void)
+{
+  return _watchlist_changed;
+}
+
+/*
+   parse a list of addresses into the configuration
+
+   addresses are separated by white spaces, commas or semicolons
+
+   return the number of addresses taken over
+*/
+int WatchlistParse(const char *list)
+{
+  int count = 0;
+
+  while (*list && count < CONFIG_WATCHLIST_LENGTH) {
+    /*
+       skip the separators
+    */
+    while (*list && strchr(" \t\r\n,;", *list))
+      list++;
+
+    /*
+       take over the address
+    */
+    int len = strcspn(list, " \t\r\n,;");
+
+    if (len == 17) {
+      memcpy(_config.watchlist.addr[count++], StringToAddress(list, MAC_ADDR_LEN, false), MAC_ADDR_LEN);
+    }
+    else if (len > 0) {
+      LogMsg("WATCHLIST: ignoring invalid address %.*s", len, list);
+    }
+    list += len;
+  }
+  _config.watchlist.count = count;
+
+#if DBG_WATCHLIST
+  DbgMsg("WATCHLIST: parsed %d addresses", count);
+#endif
+  return count;
+}
+
+/*
+   return the watchlist as a string -- one address per line
+*/
+String WatchlistToString(void)
+{
+  String list = "";
+
+  for (int n = 0; n < _config.watchlist.count && n < CONFIG_WATCHLIST_LENGTH; n++) {
+    list += AddressToString(_config.watchlist.addr[n], MAC_ADDR_LEN, false, ':');
+    list += "\n";
+  }
+  return list;
+}/**/
@@ -0,0 +1,92 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  module to handle the watchlist of devices
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __WATCHLIST_H__
+#define __WATCHLIST_H__ 1
+
+#include <NimBLEDevice.h>
+#include "config.h"
+#include "util.h"
+#include "watchsearch.h"
+
+/*
+   setup the watchlist out of the configuration
+*/
+void WatchlistSetup(void);
+
+/*
+   return true if the watchlist mode is enabled
+*/
+bool WatchlistEnabled(void);
+
+/*
+   return the number of addresses on the watchlist
+*/
+int WatchlistCount(void);
+
+/*
+   return true if the given address is on the watchlist
+*/
+bool WatchlistContains(const BLEAddress &addr);
+
+/*
+   load the watchlist into the controllers filter accept list
+
+   must be called while the scan is stopped
+
+   return true if the controller does the filtering
+*/
+bool WatchlistApply(NimBLEScan *scan);
+
+/*
+   return true if the controller does the filtering
+*/
+bool WatchlistControllerFiltering(void);
+
+/*
+   the controller lost its filter accept list -- it has to be loaded again
+*/
+void WatchlistReset(void);
+
+/*
+   return true if the watchlist has to be loaded into the controller
+*/
+bool WatchlistChanged(void);
+
+/*
+   parse a list of addresses into the configuration
+
+   return the number of addresses taken over
+*/
+int WatchlistParse(const char *list);
+
+/*
+   return the watchlist as a string -- one address per line
+*/
+String WatchlistToString(void);
+
+#endif
+
+/**/
@@ -0,0 +1,68 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  lookup of the watchlist
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __WATCHSEARCH_H__
+#define __WATCHSEARCH_H__ 1
+
+/*
+   the watchlist is kept as sorted numbers of the addresses, so a scan
+   result is checked with a binary search
+
+   this file has no dependencies, so it is shared with the watchlist bench
+*/
+#include <stdint.h>
+
+/*
+   maximum number of addresses the controller can hold in its
+   filter accept list (aka whitelist)
+
+   if the watchlist is longer, we will filter on the host side
+*/
+#define WATCHLIST_CONTROLLER_MAX    12
+
+/*
+   return true if the address is in the sorted list
+*/
+static inline bool WatchlistSearch(const uint64_t *list, int count, uint64_t key)
+{
+  int low = 0;
+  int high = count - 1;
+  int mid;
+
+  while (low <= high) {
+    mid = low + (high - low) / 2;
+    if (list[mid] < key)
+      low = mid + 1;
+    else if (list[mid] > key)
+      high = mid - 1;
+    else
+      return true;
+  }
+  return false;
+}
+
+#endif
+
+/**/
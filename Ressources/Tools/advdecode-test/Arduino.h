@@ -0,0 +1,65 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  minimal Arduino declarations to build the advertisement decoders on the host
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __ARDUINO_H__
+#define __ARDUINO_H__ 1
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+/*
+   the parts of the String class used by the decoders
+*/
+class String {
+  public:
+    String(const char *s = "") : _s(s) {}
+    String(const std::string &s) : _s(s) {}
+    String(int value) : _s(std::to_string(value)) {}
+    String(unsigned int value) : _s(std::to_string(value)) {}
+    String(long value) : _s(std::to_string(value)) {}
+    String(unsigned long value) : _s(std::to_string(value)) {}
+    String(double value, unsigned int digits = 2) {
+      char s[32];
+
+      snprintf(s, sizeof(s), "%.*f", (int) digits, value);
+      _s = s;
+    }
+    const char *c_str(void) const { return _s.c_str(); }
+    unsigned int length(void) const { return _s.length(); }
+    friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+    friend String operator+(const char *a, const String &b) { return String(a + b._s); }
+    friend String operator+(const String &a, const char *b) { return String(a._s + b); }
+    bool operator==(const char *s) const { return _s == s; }
+
+  private:
+    std::string _s;
+};
+
+#endif
+
+/**/
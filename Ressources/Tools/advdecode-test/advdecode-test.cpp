@@ -0,0 +1,168 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  tests of the advertisement decoders with recorded frames
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+/*
+   usage: advdecode-test
+
+   decodes real frames of iBeacons, Eddystone, BTHome and RuuviTags, and
+   malformed ones, and checks the decoded values and the JSON -- the
+   failed checks are reported, the exit code is the number of failures
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../../BLE-Scanner/advdecode.h"
+
+static int _checks = 0;
+static int _failures = 0;
+
+#define CHECK(name,cond) { \
+    _checks++; \
+    if (!(cond)) { \
+      _failures++; \
+      printf("FAILED: %s: %s\n", name, #cond); \
+    } \
+  }
+
+/*
+   decode a frame given in hex
+*/
+static bool Decode(int source, uint16_t id, const char *hex, ADVDECODE_T *frame)
+{
+  uint8_t data[64];
+  size_t length = 0;
+
+  for (; hex[0] && hex[1] && length < sizeof(data); hex += 2)
+    sscanf(hex, "%2hhx", &data[length++]);
+  memset(frame, 0, sizeof(*frame));
+  return AdvDecode(source, id, data, length, frame);
+}
+
+static bool Metric(const ADVDECODE_T *frame, int metric, int32_t value)
+{
+  return (frame->sensor.present & (1 << metric)) && frame->sensor.value[metric] == value;
+}
+
+int main(int argc, char *argv[])
+{
+  ADVDECODE_T frame;
+
+  /*
+     iBeacon of the AirLocate sample -- E2C56DB5-DFFB-48D2-B060-D0F5A71096E0, major 1, minor 2, -59 dBm
+  */
+  CHECK("iBeacon", Decode(ADVDECODE_MANUFACTURER, ADVDECODE_COMPANY_APPLE,
+    "4C000215E2C56DB5DFFB48D2B060D0F5A71096E000010002C5", &frame));
+  CHECK("iBeacon", frame.type == ADVDECODE_IBEACON);
+  CHECK("iBeacon", frame.ibeacon.uuid[0] == 0xE2 && frame.ibeacon.uuid[15] == 0xE0);
+  CHECK("iBeacon", frame.ibeacon.major == 1 && frame.ibeacon.minor == 2 && frame.ibeacon.txpower == -59);
+  CHECK("iBeacon", AdvDecodeToJSON(&frame) ==
+    "\"iBeacon\":{\"UUID\":\"E2C56DB5DFFB48D2B060D0F5A71096E0\",\"Major\":1,\"Minor\":2,\"TxPower\":-59}");
+  CHECK("iBeacon truncated", !Decode(ADVDECODE_MANUFACTURER, ADVDECODE_COMPANY_APPLE,
+    "4C000215E2C56DB5DFFB48D2B060D0F5A71096E00001", &frame) || frame.type != ADVDECODE_IBEACON);
+
+  /*
+     Apple continuity message other than an iBeacon -- Nearby Info
+  */
+  CHECK("Apple", Decode(ADVDECODE_MANUFACTURER, ADVDECODE_COMPANY_APPLE, "4C0010051B1C0A3F29", &frame));
+  CHECK("Apple", frame.type == ADVDECODE_APPLE && frame.apple.type == 0x10 && frame.apple.length == 5);
+
+  /*
+     Eddystone UID -- namespace EDD1EBEAC04E5DEFA017, instance 0BDB87539B67, -18 dBm at 0 m
+  */
+  CHECK("Eddystone UID", Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_EDDYSTONE,
+    "00EEEDD1EBEAC04E5DEFA0170BDB87539B670000", &frame));
+  CHECK("Eddystone UID", frame.type == ADVDECODE_EDDYSTONE_UID && frame.eddystone_uid.txpower == -18);
+  CHECK("Eddystone UID", AdvDecodeToJSON(&frame) ==
+    "\"Eddystone\":{\"Namespace\":\"EDD1EBEAC04E5DEFA017\",\"Instance\":\"0BDB87539B67\",\"TxPower\":-18}");
+  CHECK("Eddystone UID truncated", !Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_EDDYSTONE, "00EEEDD1EBEAC04E5DEF", &frame));
+
+  /*
+     Eddystone URL -- https://goo.gl/S6zT6P and https://www.google.com/
+  */
+  CHECK("Eddystone URL", Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_EDDYSTONE, "10EB03676F6F2E676C2F53367A543650", &frame));
+  CHECK("Eddystone URL", frame.type == ADVDECODE_EDDYSTONE_URL && !strcmp(frame.eddystone_url.url, "https://goo.gl/S6zT6P"));
+  CHECK("Eddystone URL", frame.eddystone_url.txpower == -21);
+  CHECK("Eddystone URL", AdvDecodeToJSON(&frame) == "\"Eddystone\":{\"URL\":\"https://goo.gl/S6zT6P\",\"TxPower\":-21}");
+  CHECK("Eddystone URL expansion", Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_EDDYSTONE, "10EB01676F6F676C6500", &frame));
+  CHECK("Eddystone URL expansion", !strcmp(frame.eddystone_url.url, "https://www.google.com/"));
+  CHECK("Eddystone URL too long", Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_EDDYSTONE,
+    "10EB0261616161616161616161616161616161616161616161616161616161616100", &frame));
+  CHECK("Eddystone URL too long", strlen(frame.eddystone_url.url) == ADVDECODE_URL_LENGTH);
+  CHECK("Eddystone URL with a quote", !Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_EDDYSTONE, "10EB0261222C2262223A", &frame));
+  CHECK("Eddystone URL with a quote", frame.type == ADVDECODE_NONE);
+  CHECK("Eddystone URL with a backslash", !Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_EDDYSTONE, "10EB02615C", &frame));
+  CHECK("Eddystone URL with a control character", !Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_EDDYSTONE, "10EB02611F62", &frame));
+  CHECK("Eddystone URL with an unknown scheme", !Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_EDDYSTONE, "10EB0461", &frame));
+
+  /*
+     Eddystone TLM -- 3000 mV, 23.5 degree, 300 advertisements, 360 s up
+  */
+  CHECK("Eddystone TLM", Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_EDDYSTONE, "20000BB817800000012C00000E10", &frame));
+  CHECK("Eddystone TLM", frame.type == ADVDECODE_EDDYSTONE_TLM && frame.eddystone_tlm.battery == 3000);
+  CHECK("Eddystone TLM", frame.eddystone_tlm.temperature == 0x1780 && frame.eddystone_tlm.adv_count == 300);
+  CHECK("Eddystone TLM", frame.eddystone_tlm.uptime == 3600);
+  CHECK("Eddystone TLM", AdvDecodeToJSON(&frame) ==
+    "\"Eddystone\":{\"Battery\":3000,\"Temperature\":23.5,\"AdvCount\":300,\"Uptime\":360}");
+  CHECK("Eddystone TLM encrypted", !Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_EDDYSTONE, "20010BB817800000012C00000E10", &frame));
+
+  /*
+     BTHome v2 of the specification -- battery 100 %, 25.06 degree, 50.55 %
+  */
+  CHECK("BTHome", Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_BTHOME, "4000CA016402CA0903BF13", &frame));
+  CHECK("BTHome", frame.type == ADVDECODE_SENSOR && frame.sensor.format == ADVDECODE_SENSOR_BTHOME);
+  CHECK("BTHome", Metric(&frame, ADVDECODE_METRIC_BATTERY, 100));
+  CHECK("BTHome", Metric(&frame, ADVDECODE_METRIC_TEMPERATURE, 2506));
+  CHECK("BTHome", Metric(&frame, ADVDECODE_METRIC_HUMIDITY, 5055));
+  CHECK("BTHome", AdvDecodeToJSON(&frame) == "");
+  CHECK("BTHome pressure & voltage", Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_BTHOME, "4004138A010C020C", &frame));
+  CHECK("BTHome pressure & voltage", Metric(&frame, ADVDECODE_METRIC_PRESSURE, 100883) && Metric(&frame, ADVDECODE_METRIC_VOLTAGE, 3074));
+  CHECK("BTHome truncated", Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_BTHOME, "40016402CA", &frame));
+  CHECK("BTHome truncated", Metric(&frame, ADVDECODE_METRIC_BATTERY, 100) && !(frame.sensor.present & (1 << ADVDECODE_METRIC_TEMPERATURE)));
+  CHECK("BTHome encrypted", !Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_BTHOME, "41016402CA09", &frame));
+  CHECK("BTHome encrypted", frame.type == ADVDECODE_NONE);
+  CHECK("BTHome v1", !Decode(ADVDECODE_SERVICE, ADVDECODE_UUID_BTHOME, "20016402CA09", &frame));
+
+  /*
+     RuuviTag RAWv2 of the specification -- 24.3 degree, 53.49 %, 100044 Pa, 2977 mV
+  */
+  CHECK("Ruuvi", Decode(ADVDECODE_MANUFACTURER, ADVDECODE_COMPANY_RUUVI, "99040512FC5394C37C0004FFFC040CAC364200CDCBB8334C884F", &frame));
+  CHECK("Ruuvi", frame.type == ADVDECODE_SENSOR && frame.sensor.format == ADVDECODE_SENSOR_RUUVI);
+  CHECK("Ruuvi", Metric(&frame, ADVDECODE_METRIC_TEMPERATURE, 2430));
+  CHECK("Ruuvi", Metric(&frame, ADVDECODE_METRIC_HUMIDITY, 5349));
+  CHECK("Ruuvi", Metric(&frame, ADVDECODE_METRIC_PRESSURE, 100044));
+  CHECK("Ruuvi", Metric(&frame, ADVDECODE_METRIC_VOLTAGE, 2977));
+  CHECK("Ruuvi invalid values", !Decode(ADVDECODE_MANUFACTURER, ADVDECODE_COMPANY_RUUVI,
+    "9904058000FFFFFFFF800080008000FFFFFFFFFFFFFFFFFFFFFF", &frame));
+  CHECK("Ruuvi format 3", !Decode(ADVDECODE_MANUFACTURER, ADVDECODE_COMPANY_RUUVI, "990403291A1ECE1EFC18F94202CA0B53", &frame));
+
+  /*
+     unknown sources
+  */
+  CHECK("unknown company", !Decode(ADVDECODE_MANUFACTURER, 0x0059, "590001020304", &frame));
+  CHECK("unknown UUID", !Decode(ADVDECODE_SERVICE, 0x180F, "64", &frame));
+
+  printf("%d checks, %d failures\n", _checks, _failures);
+  return _failures;
+}/**/
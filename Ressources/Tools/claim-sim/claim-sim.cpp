@@ -0,0 +1,227 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  simulate several scanners electing the owners of the devices by their claims
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+/*
+   usage: claim-sim [-s scanners] [-d devices] [-t seconds] [-y hysteresis] [-w dwell] [-o timeout] [-l loss] [-v speed]
+
+   the scanners are placed along a corridor 15 m apart, the devices walk
+   randomly along it with the speed in cm/s -- each second, each scanner smoothes the RSSI of
+   the devices it sees like the BLE-Scanner does, checks its claims and
+   publishes its queued claims to a broker in memory, which delivers them
+   to all scanners, dropping a share of the loss in percent
+
+   the publishers per device, the seconds a seen device wasn't published
+   at all, the owner changes and the traffic of the claims are reported --
+   the changes of the nearest scanner are the owner changes a device
+   walking along the corridor needs at least
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <vector>
+#include "../../../BLE-Scanner/claim.h"
+
+#define SPACING         15.0      // m between the scanners
+#define RSSI_AT_1M      -59.0
+#define PATH_LOSS       2.5       // exponent of the path loss
+#define NOISE           4.0       // dB of the noise of the RSSI
+#define RSSI_MIN        -95       // weakest RSSI received
+
+/*
+   the broker in memory
+*/
+static std::vector<std::vector<uint8_t> > _messages;
+static unsigned long _bytes = 0;
+
+static void Send(const uint8_t *message, size_t length)
+{
+  _messages.push_back(std::vector<uint8_t>(message, message + length));
+  _bytes += length;
+}
+
+/*
+   gaussian noise
+*/
+static double Noise(void)
+{
+  double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+  double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+int main(int argc, char *argv[])
+{
+  int scanners = 6;
+  int devices = 50;
+  long seconds = 3600;
+  int hysteresis = 6;
+  int dwell = 3;
+  int timeout = 60;
+  int loss = 0;
+  double walk = 0.8;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:d:t:y:w:o:l:v:")) != -1) {
+    switch (opt) {
+      case 's': scanners = atoi(optarg); break;
+      case 'd': devices = atoi(optarg); break;
+      case 't': seconds = atol(optarg); break;
+      case 'y': hysteresis = atoi(optarg); break;
+      case 'w': dwell = atoi(optarg); break;
+      case 'o': timeout = atoi(optarg); break;
+      case 'l': loss = atoi(optarg); break;
+      case 'v': walk = atoi(optarg) / 100.0; break;
+      default:
+        fprintf(stderr, "usage: %s [-s scanners] [-d devices] [-t seconds] [-y hysteresis] [-w dwell] [-o timeout] [-l loss] [-v speed]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  std::vector<CLAIM_MAP_T> maps(scanners);
+  std::vector<double> pos(devices), speed(devices);
+  std::vector<std::vector<double> > smoothed(scanners, std::vector<double>(devices, 0));
+  std::vector<std::vector<bool> > present(scanners, std::vector<bool>(devices, false));
+  std::vector<int> owner(devices, -1), nearest(devices, -1);
+  double length = (scanners - 1) * SPACING + 10;
+  unsigned long seen = 0, seen_devices = 0, publishers = 0, unpublished = 0, duplicated = 0, changes = 0, moves = 0;
+
+  srand(1);
+  for (int s = 0; s < scanners; s++) {
+    char name[32];
+
+    snprintf(name, sizeof(name), "scanner-%d", s);
+    ClaimInit(&maps[s], ClaimId(name), hysteresis, dwell, timeout, Send);
+  }
+  for (int d = 0; d < devices; d++) {
+    pos[d] = rand() % (int) length;
+    speed[d] = (rand() % 3 - 1) * walk;
+  }
+
+  for (long t = 1; t <= seconds; t++) {
+    std::vector<int> published(devices, 0);
+    int current_owner;
+
+    for (int d = 0; d < devices; d++) {
+      /*
+         walk, stand still or turn from time to time
+      */
+      if (rand() % 60 == 0)
+        speed[d] = (rand() % 3 - 1) * walk;
+      pos[d] += speed[d];
+      if (pos[d] < -5 || pos[d] > length - 5)
+        speed[d] = -speed[d];
+
+      int s = (int) floor(pos[d] / SPACING + 0.5);
+
+      s = (s < 0) ? 0 : (s >= scanners) ? scanners - 1 : s;
+      if (nearest[d] >= 0 && s != nearest[d])
+        moves++;
+      nearest[d] = s;
+    }
+
+    for (int s = 0; s < scanners; s++) {
+      for (int d = 0; d < devices; d++) {
+        double distance = fabs(pos[d] - s * SPACING) + 1;
+        double rssi = RSSI_AT_1M - 10 * PATH_LOSS * log10(distance) + NOISE * Noise();
+
+        if (rssi >= RSSI_MIN) {
+          smoothed[s][d] = (present[s][d]) ? smoothed[s][d] + (rssi - smoothed[s][d]) / 4 : rssi;
+          present[s][d] = true;
+        }
+        else if (present[s][d] && rand() % 10 == 0)
+          present[s][d] = false;
+
+        uint64_t addr = 0xa4c138000000ULL + d;
+
+        if (ClaimDevice(&maps[s], addr, present[s][d], (int) smoothed[s][d], t) && present[s][d])
+          published[d]++;
+      }
+      ClaimFlush(&maps[s]);
+      ClaimExpire(&maps[s], t);
+    }
+
+    /*
+       deliver the claims
+    */
+    for (size_t m = 0; m < _messages.size(); m++)
+      for (int s = 0; s < scanners; s++)
+        if (rand() % 100 >= loss)
+          ClaimReceive(&maps[s], _messages[m].data(), _messages[m].size(), t);
+    _messages.clear();
+
+    for (int d = 0; d < devices; d++) {
+      bool any = false;
+
+      current_owner = -1;
+      for (int s = 0; s < scanners; s++)
+        if (present[s][d]) {
+          any = true;
+          seen++;
+        }
+      if (!any)
+        continue;
+      seen_devices++;
+      publishers += published[d];
+      if (!published[d])
+        unpublished++;
+      if (published[d] > 1)
+        duplicated++;
+      for (int s = 0; s < scanners; s++) {
+        uint64_t addr = 0xa4c138000000ULL + d;
+
+        for (int slot = 0; slot < CLAIM_LENGTH; slot++)
+          if (maps[s].claims[slot].addr == addr && maps[s].claims[slot].owner == maps[s].self && present[s][d])
+            current_owner = s;
+      }
+      if (current_owner >= 0 && owner[d] >= 0 && current_owner != owner[d])
+        changes++;
+      if (current_owner >= 0)
+        owner[d] = current_owner;
+    }
+  }
+
+  double hours = seconds / 3600.0;
+  unsigned long claims = 0, takeovers = 0, losses = 0;
+
+  for (int s = 0; s < scanners; s++) {
+    claims += maps[s].claims_sent;
+    takeovers += maps[s].takeovers;
+    losses += maps[s].losses;
+  }
+
+  printf("%d scanners, %d devices, %ld s, hysteresis %d dB, dwell %d s, timeout %d s, loss %d%%, speed %.1f m/s\n", scanners, devices, seconds, hysteresis, dwell, timeout, loss, walk);
+  printf("scanners seeing a device:     %.2f\n", (double) seen / seen_devices);
+  printf("publishers per device:        %.2f\n", (double) publishers / seen_devices);
+  printf("seconds without a publisher:  %.2f%%\n", 100.0 * unpublished / seen_devices);
+  printf("seconds with duplicates:      %.2f%%\n", 100.0 * duplicated / seen_devices);
+  printf("owner changes per device & h: %.2f\n", changes / hours / devices);
+  printf("nearest scanner changes:      %.2f\n", moves / hours / devices);
+  printf("takeovers/losses per h:       %.0f/%.0f\n", takeovers / hours, losses / hours);
+  printf("claims per h:                 %.0f in %.0f bytes\n", claims / hours, _bytes / hours);
+  return 0;
+}/**/
@@ -0,0 +1,430 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  benchmark of the fast path for unchanged advertisements
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+/*
+   usage: fastpath-bench [-a absence] [-r repeat] [-d devices] [-t seconds] [-s seed] [capture]
+
+   the capture is a text file with one advertisement per line:
+
+     <time in seconds> <address> <rssi> <payload in hex>
+
+   without a capture, a mix of iBeacons, phones, Eddystone TLM beacons,
+   BTHome sensors and Windows PCs is generated, each advertising once per
+   second
+
+   each advertisement is replayed through the full path -- parsing the
+   payload, decoding the frames with the decoders of the BLE-Scanner,
+   comparing the name and updating the device list -- and through the
+   fast path, which only takes the fingerprint and updates the device
+   list, if a present device sends the same payload as before
+
+   the share of fast path hits and the time per advertisement with and
+   without the fast path are reported, together with the time of the
+   device lookup alone, which both paths share
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "../../../BLE-Scanner/advdecode.h"
+#include "../../../BLE-Scanner/fingerprint.h"
+
+#define NAME_LENGTH     20
+#define LIST_LENGTH     1000
+
+/*
+   an advertisement of the capture
+*/
+typedef struct _advert {
+  double time;
+  uint64_t addr;
+  int rssi;
+  std::vector<uint8_t> payload;
+} ADVERT_T;
+
+/*
+   a device of the list -- sorted by the last update, like the BLE-Scanner does
+*/
+typedef struct _device {
+  struct _device *prev, *next;
+  uint64_t addr;
+  double last_seen;
+  int rssi;
+  bool present;
+  uint32_t fingerprint;
+  uint16_t manufacturer_id;
+  char name[NAME_LENGTH + 1];
+  ADVDECODE_T frame;
+} DEVICE_T;
+
+static DEVICE_T *_first = NULL;
+static std::vector<DEVICE_T> _devices;
+static size_t _count = 0;
+static double _absence = 120;
+
+static unsigned long _hits = 0;
+static unsigned long _misses = 0;
+
+static double Random(void)
+{
+  return rand() / (RAND_MAX + 1.0);
+}
+
+/*
+   the device list
+*/
+static DEVICE_T *Find(uint64_t addr)
+{
+  for (DEVICE_T *device = _first; device; device = device->next)
+    if (device->addr == addr)
+      return device;
+  return NULL;
+}
+
+static void Unlink(DEVICE_T *device)
+{
+  if (device->prev)
+    device->prev->next = device->next;
+  if (device->next)
+    device->next->prev = device->prev;
+  if (_first == device)
+    _first = device->next;
+  device->prev = device->next = NULL;
+}
+
+static void LinkFirst(DEVICE_T *device)
+{
+  if (_first)
+    _first->prev = device;
+  device->next = _first;
+  _first = device;
+}
+
+/*
+   the fast path -- return false if the advertisement has to take the full path
+*/
+static bool Seen(const ADVERT_T *advert, uint32_t fingerprint)
+{
+  DEVICE_T *device;
+
+  if (_first && _first->addr == advert->addr)
+    device = _first;
+  else if (!(device = Find(advert->addr)))
+    return false;
+  if (!device->fingerprint || device->fingerprint != fingerprint || !device->present
+      || advert->time - device->last_seen > _absence)
+    return false;
+
+  if (device != _first) {
+    Unlink(device);
+    LinkFirst(device);
+  }
+  device->rssi = advert->rssi;
+  device->last_seen = advert->time;
+  return true;
+}
+
+/*
+   the full path
+*/
+static void Add(const ADVERT_T *advert, uint32_t fingerprint)
+{
+  const uint8_t *p = advert->payload.data();
+  size_t length = advert->payload.size();
+  char name[NAME_LENGTH + 1] = "";
+  uint16_t manufacturer_id = 0xffff;
+  ADVDECODE_T frame;
+
+  /*
+     parse the payload and decode the frames
+  */
+  memset(&frame, 0, sizeof(frame));
+  for (size_t n = 0; n + 1 < length && p[n] && n + 1 + p[n] <= length; n += 1 + p[n]) {
+    const uint8_t *data = &p[n + 2];
+    size_t size = p[n] - 1;
+
+    switch (p[n + 1]) {
+      case 0x08:
+      case 0x09:
+        memcpy(name, data, (size < NAME_LENGTH) ? size : NAME_LENGTH);
+        name[(size < NAME_LENGTH) ? size : NAME_LENGTH] = '\0';
+        break;
+      case 0x16:
+        if (size >= 2 && frame.type == ADVDECODE_NONE)
+          AdvDecode(ADVDECODE_SERVICE, data[0] | (data[1] << 8), data + 2, size - 2, &frame);
+        break;
+      case 0xff:
+        if (size >= 2) {
+          manufacturer_id = data[0] | (data[1] << 8);
+          if (frame.type == ADVDECODE_NONE)
+            AdvDecode(ADVDECODE_MANUFACTURER, manufacturer_id, data, size, &frame);
+        }
+        break;
+    }
+  }
+
+  /*
+     update the device list
+  */
+  DEVICE_T *device = Find(advert->addr);
+
+  if (device)
+    Unlink(device);
+  else if (_count < _devices.size())
+    device = &_devices[_count++];
+  else {
+    /*
+       reuse the device seen least recently
+    */
+    for (device = _first; device->next; device = device->next);
+    Unlink(device);
+    memset(device, 0, sizeof(*device));
+  }
+  LinkFirst(device);
+  device->addr = advert->addr;
+  if (*name && strncmp(device->name, name, NAME_LENGTH))
+    snprintf(device->name, sizeof(device->name), "%s", name);
+  device->manufacturer_id = manufacturer_id;
+  device->frame = frame;
+  device->rssi = advert->rssi;
+  device->last_seen = advert->time;
+  device->present = true;
+  device->fingerprint = (frame.type == ADVDECODE_SENSOR) ? 0 : fingerprint;
+}
+
+/*
+   replay the capture -- return the seconds it took
+*/
+enum { REPLAY_LOOKUP, REPLAY_FULL, REPLAY_FAST };
+
+static double Replay(const std::vector<ADVERT_T> &adverts, int mode)
+{
+  _devices.assign(LIST_LENGTH, DEVICE_T());
+  _first = NULL;
+  _count = 0;
+  _hits = _misses = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (auto &advert : adverts) {
+    if (mode == REPLAY_LOOKUP) {
+      DEVICE_T *device = Find(advert.addr);
+
+      if (device)
+        Unlink(device);
+      else if (_count < _devices.size())
+        device = &_devices[_count++];
+      else
+        continue;
+      LinkFirst(device);
+      device->addr = advert.addr;
+    }
+    else if (mode == REPLAY_FAST) {
+      uint32_t fingerprint = FingerprintPayload(advert.payload.data(), advert.payload.size());
+
+      if (Seen(&advert, fingerprint)) {
+        _hits++;
+        continue;
+      }
+      _misses++;
+      Add(&advert, fingerprint);
+    }
+    else
+      Add(&advert, 0);
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+   read a capture
+*/
+static bool Read(std::vector<ADVERT_T> &adverts, const char *file)
+{
+  FILE *f;
+  char line[1024], address[32], hex[768];
+
+  if (!(f = fopen(file, "r"))) {
+    perror(file);
+    return false;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    ADVERT_T advert;
+    unsigned int a[6];
+
+    if (sscanf(line, "%lf %31s %d %767s", &advert.time, address, &advert.rssi, hex) != 4
+        || sscanf(address, "%x:%x:%x:%x:%x:%x", &a[0], &a[1], &a[2], &a[3], &a[4], &a[5]) != 6)
+      continue;
+    advert.addr = 0;
+    for (int n = 0; n < 6; n++)
+      advert.addr = (advert.addr << 8) | a[n];
+    for (const char *s = hex; s[0] && s[1]; s += 2) {
+      unsigned int byte;
+
+      if (sscanf(s, "%2x", &byte) != 1)
+        break;
+      advert.payload.push_back(byte);
+    }
+    adverts.push_back(advert);
+  }
+  fclose(f);
+  return true;
+}
+
+/*
+   append an AD structure given in hex
+*/
+static void Append(std::vector<uint8_t> &payload, const char *hex)
+{
+  for (; hex[0] && hex[1]; hex += 2) {
+    unsigned int byte;
+
+    sscanf(hex, "%2x", &byte);
+    payload.push_back(byte);
+  }
+}
+
+/*
+   generate a capture
+*/
+static void Generate(std::vector<ADVERT_T> &adverts, int devices, int seconds)
+{
+  std::vector<int> type(devices), state(devices);
+  std::vector<double> offset(devices);
+
+  for (int d = 0; d < devices; d++) {
+    double r = Random();
+
+    type[d] = (r < 0.3) ? 0 : (r < 0.6) ? 1 : (r < 0.7) ? 2 : (r < 0.85) ? 3 : 4;
+    offset[d] = Random();
+  }
+  for (int t = 0; t < seconds; t++) {
+    for (int d = 0; d < devices; d++) {
+      ADVERT_T advert;
+      char hex[64];
+
+      advert.time = t + offset[d];
+      advert.addr = 0x240ac4000000ULL + d;
+      advert.rssi = -60 - rand() % 30;
+      Append(advert.payload, "020106");
+      switch (type[d]) {
+        case 0:
+          /*
+             iBeacon -- never changes
+          */
+          Append(advert.payload, "1AFF4C000215E2C56DB5DFFB48D2B060D0F5A71096E000010002C5");
+          break;
+        case 1:
+          /*
+             phone -- the Nearby Info changes every few minutes
+          */
+          if (Random() < 1.0 / 300)
+            state[d] = rand();
+          snprintf(hex, sizeof(hex), "0AFF4C0010051B1C%02X%02X%02X", state[d] & 0xff, (state[d] >> 8) & 0xff, (state[d] >> 16) & 0xff);
+          Append(advert.payload, hex);
+          break;
+        case 2:
+          /*
+             Eddystone TLM -- the advertisement counter changes with each advertisement
+          */
+          snprintf(hex, sizeof(hex), "1116AAFE20000BB81780%08X00000E10", (unsigned) ++state[d]);
+          Append(advert.payload, hex);
+          break;
+        case 3:
+          /*
+             BTHome sensor -- the temperature changes every few seconds
+          */
+          if (Random() < 1.0 / 10)
+            state[d] = 2400 + rand() % 200;
+          snprintf(hex, sizeof(hex), "0A16D2FC40016402%02X%02X", state[d] & 0xff, (state[d] >> 8) & 0xff);
+          Append(advert.payload, hex);
+          break;
+        case 4:
+          /*
+             Windows PC -- the salt changes every 15 minutes
+          */
+          if (Random() < 1.0 / 900)
+            state[d] = rand();
+          snprintf(hex, sizeof(hex), "1EFF0600010920%08X%08X%08X%08X%08X%04X", state[d], state[d], state[d], state[d], state[d], 0);
+          Append(advert.payload, hex);
+          Append(advert.payload, "0B094445534B544F502D3132");
+          break;
+      }
+      adverts.push_back(advert);
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int devices = 200, seconds = 600, repeat = 10, opt;
+  std::vector<ADVERT_T> adverts;
+
+  while ((opt = getopt(argc, argv, "a:r:d:t:s:")) != -1) {
+    switch (opt) {
+      case 'a': _absence = atof(optarg); break;
+      case 'r': repeat = atoi(optarg); break;
+      case 'd': devices = atoi(optarg); break;
+      case 't': seconds = atoi(optarg); break;
+      case 's': srand(atoi(optarg)); break;
+      default:
+        fprintf(stderr, "usage: %s [-a absence] [-r repeat] [-d devices] [-t seconds] [-s seed] [capture]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (optind < argc) {
+    if (!Read(adverts, argv[optind]))
+      return 1;
+  }
+  else
+    Generate(adverts, devices, seconds);
+  if (adverts.empty()) {
+    fprintf(stderr, "%s: no advertisements\n", argv[0]);
+    return 1;
+  }
+
+  /*
+     take the fastest of the repetitions
+  */
+  double lookup = 1e9, full = 1e9, fast = 1e9;
+
+  for (int n = 0; n < (repeat > 0 ? repeat : 1); n++) {
+    double t = Replay(adverts, REPLAY_LOOKUP);
+
+    lookup = (t < lookup) ? t : lookup;
+    t = Replay(adverts, REPLAY_FULL);
+    full = (t < full) ? t : full;
+    t = Replay(adverts, REPLAY_FAST);
+    fast = (t < fast) ? t : fast;
+  }
+
+  printf("advertisements:  %zu of %zu devices\n", adverts.size(), _count);
+  printf("fast path hits:  %lu (%.1f %%)\n", _hits, 100.0 * _hits / adverts.size());
+  printf("device lookup:   %.0f ns per advertisement\n", 1e9 * lookup / adverts.size());
+  printf("full path:       %.0f ns per advertisement\n", 1e9 * full / adverts.size());
+  printf("with fast path:  %.0f ns per advertisement (%.2fx)\n", 1e9 * fast / adverts.size(), full / fast);
+  return 0;
+}/**/
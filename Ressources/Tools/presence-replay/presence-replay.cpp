@@ -0,0 +1,222 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  replay recorded sightings to compare the flips of the presence detection
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+/*
+   the trace is a text file with one sighting per line:
+
+     <time in seconds> <address> <rssi>
+
+   fields might be separated by white spaces, commas or semicolons,
+   lines starting with # are ignored, the lines have to be sorted by time
+
+   usage: presence-replay [-p enter,leave,timeout[,cycle]]... <trace>
+
+   each parameter set is replayed with the timeout based presence and
+   with the presence score, the flips per hour are reported for both,
+   and the time until the score let a device enter for the first time
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <map>
+#include <vector>
+#include "../../../BLE-Scanner/presence.h"
+
+/*
+   a parameter set
+*/
+typedef struct _params {
+  int enter;
+  int leave;
+  long timeout;
+  long cycle;
+} PARAMS_T;
+
+/*
+   a sighting
+*/
+typedef struct _sighting {
+  long time;
+  int device;
+  int rssi;
+} SIGHTING_T;
+
+/*
+   the state of a device during the replay
+*/
+typedef struct _device {
+  long first_seen;
+  long last_seen;
+  bool present;
+  uint16_t score;
+  bool present_score;
+  long flips;
+  long flips_score;
+  long entered;
+} DEVICE_T;
+
+/*
+   read the trace
+*/
+static bool ReadTrace(const char *filename, std::vector<SIGHTING_T> &sightings, std::vector<std::string> &names)
+{
+  std::map<std::string, int> index;
+  char line[256];
+  FILE *fp;
+
+  if (!(fp = fopen(filename, "r"))) {
+    perror(filename);
+    return false;
+  }
+  while (fgets(line, sizeof(line), fp)) {
+    const char *sep = " \t\r\n,;";
+    char *time_s, *addr, *rssi_s;
+
+    if (*line == '#' || !(time_s = strtok(line, sep)) || !(addr = strtok(NULL, sep)) || !(rssi_s = strtok(NULL, sep)))
+      continue;
+
+    SIGHTING_T sighting = { atol(time_s), 0, atoi(rssi_s) };
+    auto it = index.find(addr);
+
+    if (it == index.end()) {
+      sighting.device = names.size();
+      index[addr] = sighting.device;
+      names.push_back(addr);
+    }
+    else
+      sighting.device = it->second;
+    if (!sightings.empty() && sighting.time < sightings.back().time) {
+      fprintf(stderr, "%s: trace is not sorted by time\n", filename);
+      fclose(fp);
+      return false;
+    }
+    sightings.push_back(sighting);
+  }
+  fclose(fp);
+  return true;
+}
+
+/*
+   bring a device up to the given time
+*/
+static void Advance(DEVICE_T *device, long time, const PARAMS_T *params)
+{
+  if (device->present && time - device->last_seen > params->timeout) {
+    device->present = false;
+    device->flips++;
+  }
+  device->score = PresenceDecay(device->score, 0, time - device->last_seen, params->cycle, params->leave, params->timeout);
+  if (device->present_score != PresenceState(device->present_score, device->score, params->enter, params->leave)) {
+    device->present_score = !device->present_score;
+    device->flips_score++;
+  }
+}
+
+/*
+   replay the trace with one parameter set
+*/
+static void Replay(const std::vector<SIGHTING_T> &sightings, const std::vector<std::string> &names, const PARAMS_T *params)
+{
+  std::vector<DEVICE_T> devices(names.size());
+  long start = sightings.front().time;
+  long end = sightings.back().time;
+  double hours = (end > start) ? (end - start) / 3600.0 : 1.0;
+  long flips = 0, flips_score = 0;
+
+  for (const SIGHTING_T &sighting : sightings) {
+    DEVICE_T *device = &devices[sighting.device];
+
+    if (device->flips)
+      Advance(device, sighting.time, params);
+    else
+      device->first_seen = sighting.time;
+
+    if (!device->present) {
+      device->present = true;
+      device->flips++;
+    }
+    device->score = PresenceSighting(device->score, sighting.rssi);
+    if (!device->present_score && PresenceState(false, device->score, params->enter, params->leave)) {
+      device->present_score = true;
+      device->flips_score++;
+      if (!device->entered)
+        device->entered = sighting.time - device->first_seen + 1;
+    }
+    device->last_seen = sighting.time;
+  }
+
+  printf("enter=%d leave=%d timeout=%ld s cycle=%ld s\n", params->enter, params->leave, params->timeout, params->cycle);
+  printf("  %-20s %12s %12s %12s\n", "device", "timeout", "score", "entered");
+  for (size_t n = 0; n < devices.size(); n++) {
+    Advance(&devices[n], end, params);
+    flips += devices[n].flips;
+    flips_score += devices[n].flips_score;
+    if (devices[n].flips / hours >= 1.0 || devices[n].flips_score / hours >= 1.0 || !devices[n].entered) {
+      char entered[32] = "never";
+
+      if (devices[n].entered)
+        snprintf(entered, sizeof(entered), "%ld s", devices[n].entered - 1);
+      printf("  %-20s %10.1f/h %10.1f/h %12s\n", names[n].c_str(), devices[n].flips / hours, devices[n].flips_score / hours, entered);
+    }
+  }
+  printf("  %-20s %10.1f/h %10.1f/h\n", "total", flips / hours, flips_score / hours);
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<PARAMS_T> params;
+  std::vector<SIGHTING_T> sightings;
+  std::vector<std::string> names;
+  int n;
+
+  for (n = 1; n < argc - 1 && !strcmp(argv[n], "-p"); n += 2) {
+    PARAMS_T p = { PRESENCE_ENTER_DEFAULT, PRESENCE_LEAVE_DEFAULT, 300, 10 };
+
+    if (sscanf(argv[n + 1], "%d,%d,%ld,%ld", &p.enter, &p.leave, &p.timeout, &p.cycle) < 1 || p.leave >= p.enter || p.enter > 255 || p.leave < 0 || p.cycle < 1) {
+      fprintf(stderr, "invalid parameter set %s\n", argv[n + 1]);
+      return 1;
+    }
+    params.push_back(p);
+  }
+  if (n != argc - 1) {
+    fprintf(stderr, "usage: %s [-p enter,leave,timeout[,cycle]]... <trace>\n", argv[0]);
+    return 1;
+  }
+  if (params.empty())
+    params.push_back({ PRESENCE_ENTER_DEFAULT, PRESENCE_LEAVE_DEFAULT, 300, 10 });
+
+  if (!ReadTrace(argv[n], sightings, names))
+    return 1;
+  if (sightings.empty()) {
+    fprintf(stderr, "%s: no sightings\n", argv[n]);
+    return 1;
+  }
+  printf("%zu sightings of %zu devices\n", sightings.size(), names.size());
+
+  for (const PARAMS_T &p : params)
+    Replay(sightings, names, &p);
+  return 0;
+}/**/
@@ -0,0 +1,569 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  fusion of the RSSI reported by several scanners into the room of each device
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "fusion.h"
+
+/*
+   read the configuration file
+
+     model fingerprint|centroid
+     window <seconds>
+     confirm <count>
+     prefix <topic prefix>
+     scanner <name> <x> <y>
+     room <name> <x0> <y0> <x1> <y1>
+     fingerprint <room> <scanner>=<rssi> ...
+
+   rooms without a measured fingerprint get one derived out of the path loss
+   from their center to the scanners
+*/
+bool FusionConfigRead(FUSION_CONFIG_T *config, const char *file, std::string *error)
+{
+  FILE *f;
+  char line[1024];
+  int lineno = 0;
+  std::vector<std::string> fingerprints;
+
+  config->scanners.clear();
+  config->rooms.clear();
+  config->fingerprints.clear();
+  config->model = FUSION_MODEL_FINGERPRINT;
+  config->window = 10;
+  config->confirm = 3;
+  config->prefix = "BLE-Scanner/room";
+
+  if (!(f = fopen(file, "r"))) {
+    *error = std::string(file) + ": " + strerror(errno);
+    return false;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    char keyword[32], name[64], value[128];
+    double x0, y0, x1, y1;
+    int n;
+
+    lineno++;
+    if (strchr(line, '#'))
+      *strchr(line, '#') = '\0';
+    if (sscanf(line, "%31s", keyword) != 1)
+      continue;
+    if (!strcmp(keyword, "model") && sscanf(line, "%*s %127s", value) == 1
+        && (!strcmp(value, "fingerprint") || !strcmp(value, "centroid")))
+      config->model = strcmp(value, "fingerprint") ? FUSION_MODEL_CENTROID : FUSION_MODEL_FINGERPRINT;
+    else if (!strcmp(keyword, "window") && sscanf(line, "%*s %lf", &x0) == 1 && x0 > 0)
+      config->window = x0;
+    else if (!strcmp(keyword, "confirm") && sscanf(line, "%*s %d", &n) == 1 && n > 0)
+      config->confirm = n;
+    else if (!strcmp(keyword, "prefix") && sscanf(line, "%*s %127s", value) == 1)
+      config->prefix = value;
+    else if (!strcmp(keyword, "scanner") && sscanf(line, "%*s %63s %lf %lf", name, &x0, &y0) == 3
+        && config->scanners.size() < FUSION_SCANNERS)
+      config->scanners.push_back({ name, x0, y0 });
+    else if (!strcmp(keyword, "room") && sscanf(line, "%*s %63s %lf %lf %lf %lf", name, &x0, &y0, &x1, &y1) == 5)
+      config->rooms.push_back({ name, fmin(x0, x1), fmin(y0, y1), fmax(x0, x1), fmax(y0, y1) });
+    else if (!strcmp(keyword, "fingerprint"))
+      fingerprints.push_back(line);
+    else {
+      fclose(f);
+      *error = std::string(file) + ":" + std::to_string(lineno) + ": invalid line";
+      return false;
+    }
+  }
+  fclose(f);
+
+  if (config->scanners.empty() || config->rooms.empty()) {
+    *error = std::string(file) + ": at least one scanner and one room are needed";
+    return false;
+  }
+
+  /*
+     the fingerprints are parsed after all scanners and rooms are known
+  */
+  for (auto &line : fingerprints) {
+    FUSION_FINGERPRINT_T fingerprint;
+    char room[64], pair[128];
+    const char *s = line.c_str();
+    int n;
+
+    sscanf(s, "%*s %63s%n", room, &n);
+    s += n;
+    fingerprint.room = -1;
+    for (size_t r = 0; r < config->rooms.size(); r++)
+      if (config->rooms[r].name == room)
+        fingerprint.room = r;
+    if (fingerprint.room < 0) {
+      *error = std::string(file) + ": fingerprint of the unknown room " + room;
+      return false;
+    }
+    for (int i = 0; i < FUSION_SCANNERS; i++)
+      fingerprint.rssi[i] = FUSION_RSSI_MISSING;
+    while (sscanf(s, "%127s%n", pair, &n) == 1) {
+      char *equal = strchr(pair, '=');
+      size_t i;
+
+      s += n;
+      if (equal)
+        *equal++ = '\0';
+      for (i = 0; i < config->scanners.size() && config->scanners[i].name != pair; i++);
+      if (!equal || i >= config->scanners.size()) {
+        *error = std::string(file) + ": invalid fingerprint of the room " + room + ": " + pair;
+        return false;
+      }
+      fingerprint.rssi[i] = fmax(atof(equal), FUSION_RSSI_MISSING);
+    }
+    config->fingerprints.push_back(fingerprint);
+  }
+
+  for (size_t r = 0; r < config->rooms.size(); r++) {
+    FUSION_FINGERPRINT_T fingerprint;
+    bool measured = false;
+
+    for (auto &f : config->fingerprints)
+      measured |= f.room == (int) r;
+    if (measured)
+      continue;
+    fingerprint.room = r;
+    for (int i = 0; i < FUSION_SCANNERS; i++)
+      fingerprint.rssi[i] = FUSION_RSSI_MISSING;
+    for (size_t i = 0; i < config->scanners.size(); i++) {
+      double dx = (config->rooms[r].x0 + config->rooms[r].x1) / 2 - config->scanners[i].x;
+      double dy = (config->rooms[r].y0 + config->rooms[r].y1) / 2 - config->scanners[i].y;
+      double distance = fmax(sqrt(dx * dx + dy * dy), 1.0);
+
+      fingerprint.rssi[i] = fmax(FUSION_RSSI_AT_1M - 10 * FUSION_PATH_LOSS * log10(distance), FUSION_RSSI_MISSING);
+    }
+    config->fingerprints.push_back(fingerprint);
+  }
+  return true;
+}
+
+/*
+   parse an address out of a topic like PREFIX/device/AA-BB-CC-DD-EE-FF
+*/
+uint64_t FusionAddress(const char *topic, size_t *prefix_length)
+{
+  const char *s;
+  uint64_t addr = 0;
+
+  if (!(s = strstr(topic, "/device/")))
+    return 0;
+  if (prefix_length)
+    *prefix_length = s - topic;
+  s += 8;
+  for (int n = 0; n < 6; n++, s += 3) {
+    for (int i = 0; i < 2; i++) {
+      char c = s[i];
+
+      if (c >= '0' && c <= '9')
+        addr = (addr << 4) | (c - '0');
+      else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        addr = (addr << 4) | ((c | 0x20) - 'a' + 10);
+      else
+        return 0;
+    }
+    if (s[2] != (n < 5 ? '-' : '\0') && !(n < 5 && s[2] == ':'))
+      return 0;
+  }
+
+  /*
+     no device has the address 0, so it marks the ticks in the queues
+  */
+  return addr;
+}
+
+/*
+   distribute the addresses over the workers
+*/
+static inline size_t FusionShard(uint64_t addr, size_t workers)
+{
+  addr ^= addr >> 33;
+  addr *= 0xff51afd7ed558ccdULL;
+  addr ^= addr >> 33;
+  return addr % workers;
+}
+
+/*
+   find the scanner of a message -- by the scanner name in the payload,
+   or by the prefix of the topic
+*/
+static int FusionScanner(const FUSION_CONFIG_T *config, const FUSION_MESSAGE_T *message)
+{
+  const char *name = message->topic;
+  const char *s;
+  size_t length;
+
+  if ((s = strstr(message->payload, "\"Scanner\":\""))) {
+    name = s + 11;
+    if (!(s = strchr(name, '"')))
+      return -1;
+    length = s - name;
+  }
+  else
+    FusionAddress(message->topic, &length);
+
+  for (size_t i = 0; i < config->scanners.size(); i++)
+    if (config->scanners[i].name.size() == length && !memcmp(config->scanners[i].name.data(), name, length))
+      return i;
+  return -1;
+}
+
+/*
+   find the room of a device
+*/
+static int FusionLocate(const FUSION_CONFIG_T *config, const FUSION_DEVICE_T *device, double now)
+{
+  size_t scanners = config->scanners.size();
+  float rssi[FUSION_SCANNERS];
+  int present = 0;
+
+  for (size_t i = 0; i < scanners; i++) {
+    rssi[i] = (now - device->last[i] <= config->window) ? device->rssi[i] : FUSION_RSSI_MISSING;
+    present += rssi[i] > FUSION_RSSI_MISSING;
+  }
+  if (!present)
+    return -1;
+
+  if (config->model == FUSION_MODEL_FINGERPRINT) {
+    /*
+       the nearest fingerprint in the signal space
+    */
+    float best = INFINITY;
+    int room = -1;
+
+    for (auto &f : config->fingerprints) {
+      float distance = 0;
+
+      for (size_t i = 0; i < scanners; i++)
+        distance += (rssi[i] - f.rssi[i]) * (rssi[i] - f.rssi[i]);
+      if (distance < best) {
+        best = distance;
+        room = f.room;
+      }
+    }
+    return room;
+  }
+
+  /*
+     the centroid of the scanners weighted with the received amplitude
+  */
+  double x = 0, y = 0, sum = 0;
+  for (size_t i = 0; i < scanners; i++) {
+    if (rssi[i] <= FUSION_RSSI_MISSING)
+      continue;
+    double weight = pow(10, (rssi[i] - FUSION_RSSI_MISSING) / 20);
+
+    x += weight * config->scanners[i].x;
+    y += weight * config->scanners[i].y;
+    sum += weight;
+  }
+  x /= sum;
+  y /= sum;
+
+  int room = -1;
+  double best = INFINITY;
+
+  for (size_t r = 0; r < config->rooms.size(); r++) {
+    const FUSION_ROOM_T &area = config->rooms[r];
+
+    if (x >= area.x0 && x <= area.x1 && y >= area.y0 && y <= area.y1)
+      return r;
+
+    /*
+       outside of all rooms, the room nearest to the centroid is taken
+    */
+    double dx = fmax(fmax(area.x0 - x, x - area.x1), 0);
+    double dy = fmax(fmax(area.y0 - y, y - area.y1), 0);
+
+    if (dx * dx + dy * dy < best) {
+      best = dx * dx + dy * dy;
+      room = r;
+    }
+  }
+  return room;
+}
+
+/*
+   publish the transition of a device
+*/
+static void FusionTransition(FUSION_T *fusion, FUSION_WORKER_T *worker, uint64_t addr, FUSION_DEVICE_T *device, int room, double now)
+{
+  const FUSION_CONFIG_T *config = fusion->config;
+  char topic[FUSION_TOPIC_LENGTH];
+  char payload[FUSION_PAYLOAD_LENGTH];
+
+  snprintf(topic, sizeof(topic), "%s/%02X-%02X-%02X-%02X-%02X-%02X", config->prefix.c_str(),
+    (unsigned) (addr >> 40) & 0xff, (unsigned) (addr >> 32) & 0xff, (unsigned) (addr >> 24) & 0xff,
+    (unsigned) (addr >> 16) & 0xff, (unsigned) (addr >> 8) & 0xff, (unsigned) addr & 0xff);
+  snprintf(payload, sizeof(payload), "{\"room\":\"%s\",\"previous\":\"%s\",\"time\":%.0f}",
+    room < 0 ? "none" : config->rooms[room].name.c_str(),
+    device->room < 0 ? "none" : config->rooms[device->room].name.c_str(), now);
+  device->room = room;
+  device->count = 0;
+  worker->transitions.store(worker->transitions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (fusion->publish)
+    fusion->publish(topic, payload, fusion->context);
+}
+
+/*
+   process a device update
+*/
+static void FusionProcess(FUSION_T *fusion, FUSION_WORKER_T *worker, const FUSION_MESSAGE_T *message)
+{
+  const FUSION_CONFIG_T *config = fusion->config;
+  const char *s;
+  int scanner, room;
+  float rssi;
+
+  /*
+     updates without an RSSI, like the ones of the name, are skipped
+  */
+  if (!(s = strstr(message->payload, "\"RSSI\":"))
+      || (scanner = FusionScanner(config, message)) < 0) {
+    worker->ignored.store(worker->ignored.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return;
+  }
+  rssi = fmax(strtol(s + 7, NULL, 10), FUSION_RSSI_MISSING);
+
+  auto it = worker->devices.find(message->addr);
+
+  if (it == worker->devices.end()) {
+    FUSION_DEVICE_T device;
+
+    memset(&device, 0, sizeof(device));
+    for (int i = 0; i < FUSION_SCANNERS; i++)
+      device.last[i] = -INFINITY;
+    device.room = device.candidate = -1;
+    it = worker->devices.emplace(message->addr, device).first;
+  }
+
+  FUSION_DEVICE_T *device = &it->second;
+
+  /*
+     the RSSI is averaged with a weight decaying over the window
+  */
+  float weight = device->weight[scanner] * expf(-(message->time - device->last[scanner]) / config->window);
+
+  if (!(weight > 0))
+    weight = 0;
+  device->rssi[scanner] = (device->rssi[scanner] * weight + rssi) / (weight + 1);
+  device->weight[scanner] = weight + 1;
+  device->last[scanner] = message->time;
+  device->seen = message->time;
+
+  if ((room = FusionLocate(config, device, message->time)) == device->room) {
+    device->count = 0;
+    return;
+  }
+  if (room != device->candidate) {
+    device->candidate = room;
+    device->count = 0;
+  }
+  if (++device->count >= config->confirm || device->room < 0)
+    FusionTransition(fusion, worker, message->addr, device, room, message->time);
+}
+
+/*
+   process a tick -- devices not received within the window leave their room
+*/
+static void FusionSweep(FUSION_T *fusion, FUSION_WORKER_T *worker, double now)
+{
+  const FUSION_CONFIG_T *config = fusion->config;
+
+  for (auto it = worker->devices.begin(); it != worker->devices.end(); ) {
+    FUSION_DEVICE_T *device = &it->second;
+
+    if (now - device->seen > config->window) {
+      if (device->room >= 0)
+        FusionTransition(fusion, worker, it->first, device, -1, now);
+      it = worker->devices.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+/*
+   the worker
+*/
+static void FusionWorker(FUSION_T *fusion, FUSION_WORKER_T *worker)
+{
+  uint32_t tail = worker->tail.load(std::memory_order_relaxed);
+  unsigned long processed = 0;
+  int idle = 0;
+
+  while (fusion->running.load(std::memory_order_relaxed)) {
+    uint32_t head = worker->head.load(std::memory_order_acquire);
+
+    if (head == tail) {
+      if (++idle < 64)
+        std::this_thread::yield();
+      else
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      continue;
+    }
+    idle = 0;
+    while (tail != head) {
+      const FUSION_MESSAGE_T *message = &worker->queue[tail & (FUSION_QUEUE_LENGTH - 1)];
+
+      if (message->addr) {
+        FusionProcess(fusion, worker, message);
+        processed++;
+      }
+      else
+        FusionSweep(fusion, worker, message->time);
+      tail++;
+
+      /*
+         hand back the slots in batches
+      */
+      if (!(tail & 63))
+        worker->tail.store(tail, std::memory_order_release);
+    }
+    worker->tail.store(tail, std::memory_order_release);
+    worker->processed.store(processed, std::memory_order_relaxed);
+  }
+}
+
+/*
+   start the workers
+*/
+void FusionStart(FUSION_T *fusion, const FUSION_CONFIG_T *config, int workers, FUSION_PUBLISH_T publish, void *context)
+{
+  fusion->config = config;
+  fusion->publish = publish;
+  fusion->context = context;
+  fusion->ingested = fusion->dropped = fusion->stalls = 0;
+  fusion->running = true;
+  for (int n = 0; n < (workers > 0 ? workers : 1); n++) {
+    FUSION_WORKER_T *worker = new FUSION_WORKER_T();
+
+    worker->head = worker->tail = 0;
+    worker->processed = worker->ignored = worker->transitions = 0;
+    worker->queue = new FUSION_MESSAGE_T[FUSION_QUEUE_LENGTH];
+    fusion->workers.push_back(worker);
+  }
+  for (auto worker : fusion->workers)
+    worker->thread = std::thread(FusionWorker, fusion, worker);
+}
+
+/*
+   stop the workers
+*/
+void FusionStop(FUSION_T *fusion)
+{
+  fusion->running = false;
+  for (auto worker : fusion->workers) {
+    worker->thread.join();
+    delete[] worker->queue;
+    delete worker;
+  }
+  fusion->workers.clear();
+}
+
+/*
+   get a free slot in the queue of a worker -- a full queue stalls the producer
+*/
+static FUSION_MESSAGE_T *FusionSlot(FUSION_T *fusion, FUSION_WORKER_T *worker)
+{
+  uint32_t head = worker->head.load(std::memory_order_relaxed);
+
+  if (head - worker->tail.load(std::memory_order_acquire) >= FUSION_QUEUE_LENGTH) {
+    fusion->stalls++;
+    while (head - worker->tail.load(std::memory_order_acquire) >= FUSION_QUEUE_LENGTH)
+      std::this_thread::yield();
+  }
+  return &worker->queue[head & (FUSION_QUEUE_LENGTH - 1)];
+}
+
+/*
+   take a message of a scanner
+*/
+bool FusionIngest(FUSION_T *fusion, const char *topic, const char *payload, size_t length, double time)
+{
+  size_t topic_length = strlen(topic);
+  uint64_t addr;
+
+  if (!(addr = FusionAddress(topic, NULL)))
+    return false;
+  if (topic_length >= FUSION_TOPIC_LENGTH || length >= FUSION_PAYLOAD_LENGTH) {
+    fusion->dropped++;
+    return false;
+  }
+
+  FUSION_WORKER_T *worker = fusion->workers[FusionShard(addr, fusion->workers.size())];
+  FUSION_MESSAGE_T *message = FusionSlot(fusion, worker);
+
+  message->addr = addr;
+  message->time = time;
+  message->topic_length = topic_length;
+  message->payload_length = length;
+  memcpy(message->topic, topic, topic_length + 1);
+  memcpy(message->payload, payload, length);
+  message->payload[length] = '\0';
+  worker->head.store(worker->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  fusion->ingested++;
+  return true;
+}
+
+/*
+   advance the clock of the workers
+*/
+void FusionTick(FUSION_T *fusion, double time)
+{
+  for (auto worker : fusion->workers) {
+    FUSION_MESSAGE_T *message = FusionSlot(fusion, worker);
+
+    message->addr = 0;
+    message->time = time;
+    worker->head.store(worker->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+}
+
+/*
+   wait until the workers processed all messages
+*/
+void FusionDrain(FUSION_T *fusion)
+{
+  for (auto worker : fusion->workers)
+    while (worker->tail.load(std::memory_order_acquire) != worker->head.load(std::memory_order_relaxed))
+      std::this_thread::yield();
+}
+
+/*
+   return the room of a device
+*/
+const char *FusionRoom(FUSION_T *fusion, uint64_t addr)
+{
+  FUSION_WORKER_T *worker = fusion->workers[FusionShard(addr, fusion->workers.size())];
+  auto it = worker->devices.find(addr);
+
+  if (it == worker->devices.end() || it->second.room < 0)
+    return "none";
+  return fusion->config->rooms[it->second.room].name.c_str();
+}/**/
@@ -0,0 +1,203 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  fusion of the RSSI reported by several scanners into the room of each device
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __FUSION_H__
+#define __FUSION_H__ 1
+
+/*
+   the messages of the scanners are taken by one thread, and handed to a
+   pool of workers through one lock-free queue per worker -- the devices
+   are distributed over the workers by their address, so each worker owns
+   the state of its devices and needs no locks
+
+   each device keeps a time-windowed RSSI per scanner, and is assigned to
+   the room with the nearest fingerprint, or the room holding the weighted
+   centroid of the scanners -- a new room has to win several times in a
+   row, before the transition is published
+*/
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <thread>
+#include <unordered_map>
+
+#define FUSION_SCANNERS             32
+#define FUSION_TOPIC_LENGTH         128
+#define FUSION_PAYLOAD_LENGTH       384
+#define FUSION_QUEUE_LENGTH         4096          // has to be a power of two
+
+/*
+   RSSI taken for a scanner not receiving the device
+*/
+#define FUSION_RSSI_MISSING         -100.0f
+
+/*
+   model of the path loss, to derive fingerprints out of the positions
+*/
+#define FUSION_RSSI_AT_1M           -59.0
+#define FUSION_PATH_LOSS            2.5
+
+enum FUSION_MODEL {
+  FUSION_MODEL_FINGERPRINT = 0,
+  FUSION_MODEL_CENTROID,
+};
+
+/*
+   the configuration
+*/
+typedef struct _fusion_scanner {
+  std::string name;
+  double x, y;
+} FUSION_SCANNER_T;
+
+typedef struct _fusion_room {
+  std::string name;
+  double x0, y0, x1, y1;
+} FUSION_ROOM_T;
+
+typedef struct _fusion_fingerprint {
+  int room;
+  float rssi[FUSION_SCANNERS];
+} FUSION_FINGERPRINT_T;
+
+typedef struct _fusion_config {
+  std::vector<FUSION_SCANNER_T> scanners;
+  std::vector<FUSION_ROOM_T> rooms;
+  std::vector<FUSION_FINGERPRINT_T> fingerprints;
+  int model;
+  double window;                    // seconds an RSSI is taken into account
+  int confirm;                      // times a new room has to win in a row
+  std::string prefix;               // prefix of the published topics
+} FUSION_CONFIG_T;
+
+/*
+   a message in the queue of a worker
+*/
+typedef struct _fusion_message {
+  uint64_t addr;                    // 0 for a tick of the clock
+  double time;
+  uint16_t topic_length;
+  uint16_t payload_length;
+  char topic[FUSION_TOPIC_LENGTH];
+  char payload[FUSION_PAYLOAD_LENGTH];
+} FUSION_MESSAGE_T;
+
+/*
+   the state of a device
+*/
+typedef struct _fusion_device {
+  float rssi[FUSION_SCANNERS];      // RSSI averaged over the window
+  float weight[FUSION_SCANNERS];    // weight of the average
+  double last[FUSION_SCANNERS];     // time of the last RSSI
+  double seen;
+  int room;                         // -1 for none
+  int candidate;
+  int count;
+} FUSION_DEVICE_T;
+
+/*
+   a worker with its queue -- the producer only writes the head, the worker only the tail
+*/
+typedef struct _fusion_worker {
+  alignas(64) std::atomic<uint32_t> head;
+  alignas(64) std::atomic<uint32_t> tail;
+  FUSION_MESSAGE_T *queue;
+  std::unordered_map<uint64_t, FUSION_DEVICE_T> devices;
+  std::thread thread;
+
+  /*
+     stats, written by the worker only
+  */
+  std::atomic<unsigned long> processed;
+  std::atomic<unsigned long> ignored;
+  std::atomic<unsigned long> transitions;
+} FUSION_WORKER_T;
+
+typedef void (*FUSION_PUBLISH_T)(const char *topic, const char *payload, void *context);
+
+typedef struct _fusion {
+  const FUSION_CONFIG_T *config;
+  std::vector<FUSION_WORKER_T *> workers;
+  std::atomic<bool> running;
+  FUSION_PUBLISH_T publish;
+  void *context;
+
+  /*
+     stats, written by the producer only
+  */
+  unsigned long ingested;
+  unsigned long dropped;
+  unsigned long stalls;
+} FUSION_T;
+
+/*
+   read the configuration file -- return false and set the error if it is invalid
+*/
+bool FusionConfigRead(FUSION_CONFIG_T *config, const char *file, std::string *error);
+
+/*
+   start the workers
+*/
+void FusionStart(FUSION_T *fusion, const FUSION_CONFIG_T *config, int workers, FUSION_PUBLISH_T publish, void *context);
+
+/*
+   stop the workers
+*/
+void FusionStop(FUSION_T *fusion);
+
+/*
+   take a message of a scanner -- has to be called by one thread only
+
+   return false if the message isn't a device update
+*/
+bool FusionIngest(FUSION_T *fusion, const char *topic, const char *payload, size_t length, double time);
+
+/*
+   advance the clock of the workers, so devices not received anymore leave -- called by the same thread
+*/
+void FusionTick(FUSION_T *fusion, double time);
+
+/*
+   wait until the workers processed all messages -- the tail is only advanced after a message was processed
+*/
+void FusionDrain(FUSION_T *fusion);
+
+/*
+   return the room of a device -- only valid while the workers are drained
+*/
+const char *FusionRoom(FUSION_T *fusion, uint64_t addr);
+
+/*
+   parse an address out of a topic like PREFIX/device/AA-BB-CC-DD-EE-FF
+
+   return 0 if the topic isn't a device topic
+*/
+uint64_t FusionAddress(const char *topic, size_t *prefix_length);
+
+#endif
+
+/**/
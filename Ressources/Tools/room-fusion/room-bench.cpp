@@ -0,0 +1,319 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  replay benchmark of the room fusion
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+/*
+   usage: room-bench -c config [-w workers] [-d devices] [-t seconds] [-m move] [-s seed] [trace]
+
+   replays a trace (<time> <scanner> <address> <rssi> [<room>] per line) through the
+   room fusion as fast as possible -- without a trace, the devices are
+   placed randomly into the rooms of the configuration, and move into another
+   room every move seconds on average, while each scanner reports each device
+   it receives once per second
+
+   the messages are formatted like the device updates of the BLE-Scanner while
+   they are replayed, the rate of the replay and of the formatting alone are
+   reported -- if the true rooms are known, the share of the time each device
+   was published in its true room is reported too
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <map>
+#include "fusion.h"
+
+#define NOISE           4.0       // dB of the noise of the RSSI
+#define RSSI_MIN        -95       // weakest RSSI received
+
+typedef struct _sample {
+  double time;
+  uint64_t addr;
+  int8_t scanner;
+  int8_t rssi;
+  int16_t room;                   // true room, -1 if unknown
+} SAMPLE_T;
+
+static const FUSION_CONFIG_T *_config;
+
+/*
+   the published rooms per device, written by the workers
+*/
+static std::mutex _mutex;
+static std::map<uint64_t, std::vector<std::pair<double, int> > > _published;
+
+static void Publish(const char *topic, const char *payload, void *)
+{
+  const char *room = strstr(payload, "\"room\":\"") + 8;
+  const char *time = strstr(payload, "\"time\":") + 7;
+  size_t length = strchr(room, '"') - room;
+  char device[32];
+  int r = -1;
+
+  for (size_t i = 0; i < _config->rooms.size(); i++)
+    if (_config->rooms[i].name.size() == length && !memcmp(_config->rooms[i].name.data(), room, length))
+      r = i;
+
+  snprintf(device, sizeof(device), "/device/%s", strrchr(topic, '/') + 1);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  _published[FusionAddress(device, NULL)].push_back(std::make_pair(atof(time), r));
+}
+
+static double Random(void)
+{
+  return rand() / (RAND_MAX + 1.0);
+}
+
+static double Gauss(void)
+{
+  return sqrt(-2 * log(1 - Random())) * cos(2 * M_PI * Random());
+}
+
+/*
+   generate the samples of walking devices
+*/
+static void Generate(std::vector<SAMPLE_T> &samples, int devices, int seconds, double move)
+{
+  size_t rooms = _config->rooms.size();
+  std::vector<int> room(devices);
+  std::vector<double> x(devices), y(devices);
+
+  for (int t = 0; t < seconds; t++) {
+    for (int d = 0; d < devices; d++) {
+      if (t == 0 || Random() < 1 / move) {
+        const FUSION_ROOM_T &area = _config->rooms[room[d] = t ? (room[d] + 1 + rand() % (rooms > 1 ? rooms - 1 : 1)) % rooms : rand() % rooms];
+
+        x[d] = area.x0 + Random() * (area.x1 - area.x0);
+        y[d] = area.y0 + Random() * (area.y1 - area.y0);
+      }
+      for (size_t s = 0; s < _config->scanners.size(); s++) {
+        double dx = x[d] - _config->scanners[s].x, dy = y[d] - _config->scanners[s].y;
+        double rssi = FUSION_RSSI_AT_1M - 10 * FUSION_PATH_LOSS * log10(fmax(sqrt(dx * dx + dy * dy), 0.5)) + NOISE * Gauss();
+
+        if (rssi >= RSSI_MIN)
+          samples.push_back({ t + Random(), 0x0c0000000000ULL + d + 1, (int8_t) s, (int8_t) fmin(rssi, 0), (int16_t) room[d] });
+      }
+    }
+  }
+}
+
+/*
+   read a trace
+*/
+static bool Read(std::vector<SAMPLE_T> &samples, const char *file)
+{
+  FILE *f;
+  char line[256], scanner[64], address[32], room[64];
+  unsigned long unknown = 0;
+
+  if (!(f = fopen(file, "r"))) {
+    perror(file);
+    return false;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    char topic[64];
+    SAMPLE_T sample;
+    int rssi, n;
+    size_t s, r;
+
+    if ((n = sscanf(line, "%lf %63s %31s %d %63s", &sample.time, scanner, address, &rssi, room)) < 4)
+      continue;
+    snprintf(topic, sizeof(topic), "x/device/%s", address);
+    for (s = 0; s < _config->scanners.size() && _config->scanners[s].name != scanner; s++);
+    for (r = 0; n == 5 && r < _config->rooms.size() && _config->rooms[r].name != room; r++);
+    if (s >= _config->scanners.size() || !(sample.addr = FusionAddress(topic, NULL))) {
+      unknown++;
+      continue;
+    }
+    sample.scanner = s;
+    sample.rssi = rssi;
+    sample.room = (n == 5 && r < _config->rooms.size()) ? r : -1;
+    samples.push_back(sample);
+  }
+  fclose(f);
+  if (unknown)
+    fprintf(stderr, "%s: %lu lines with an unknown scanner or address skipped\n", file, unknown);
+  return true;
+}
+
+/*
+   format a sample like the BLE-Scanner publishes it
+*/
+static size_t Format(const SAMPLE_T *sample, char *topic, char *payload)
+{
+  snprintf(topic, FUSION_TOPIC_LENGTH, "BLE-Scanner/device/%02X-%02X-%02X-%02X-%02X-%02X",
+    (unsigned) (sample->addr >> 40) & 0xff, (unsigned) (sample->addr >> 32) & 0xff, (unsigned) (sample->addr >> 24) & 0xff,
+    (unsigned) (sample->addr >> 16) & 0xff, (unsigned) (sample->addr >> 8) & 0xff, (unsigned) sample->addr & 0xff);
+  return snprintf(payload, FUSION_PAYLOAD_LENGTH,
+    "{\"presence\":\"present\",\"last_seen\":%.0f,\"Scanner\":\"%s\",\"RSSI\":%d,\"Name\":\"\",\"ManufacturerId\":\"004c\"}",
+    sample->time, _config->scanners[sample->scanner].name.c_str(), sample->rssi);
+}
+
+static double Elapsed(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+  const char *file = NULL;
+  int workers = 2, devices = 500, seconds = 300, seed = 1, opt;
+  double move = 120;
+  FUSION_CONFIG_T config;
+  FUSION_T fusion;
+  std::string error;
+  std::vector<SAMPLE_T> samples;
+  char topic[FUSION_TOPIC_LENGTH], payload[FUSION_PAYLOAD_LENGTH];
+  size_t length, sum = 0;
+
+  while ((opt = getopt(argc, argv, "c:w:d:t:m:s:")) != -1) {
+    switch (opt) {
+      case 'c': file = optarg; break;
+      case 'w': workers = atoi(optarg); break;
+      case 'd': devices = atoi(optarg); break;
+      case 't': seconds = atoi(optarg); break;
+      case 'm': move = atof(optarg); break;
+      case 's': seed = atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s -c config [-w workers] [-d devices] [-t seconds] [-m move] [-s seed] [trace]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (!file) {
+    fprintf(stderr, "%s: no configuration given\n", argv[0]);
+    return 1;
+  }
+  if (!FusionConfigRead(&config, file, &error)) {
+    fprintf(stderr, "%s: %s\n", argv[0], error.c_str());
+    return 1;
+  }
+  _config = &config;
+  srand(seed);
+
+  if (optind < argc) {
+    if (!Read(samples, argv[optind]))
+      return 1;
+  }
+  else
+    Generate(samples, devices, seconds, move);
+  std::stable_sort(samples.begin(), samples.end(), [](const SAMPLE_T &a, const SAMPLE_T &b) { return a.time < b.time; });
+  if (samples.empty()) {
+    fprintf(stderr, "%s: no samples\n", argv[0]);
+    return 1;
+  }
+
+  /*
+     the formatting alone
+  */
+  auto start = std::chrono::steady_clock::now();
+
+  for (auto &sample : samples)
+    sum += Format(&sample, topic, payload);
+
+  double format = Elapsed(start);
+
+  /*
+     the replay
+  */
+  FusionStart(&fusion, &config, workers, Publish, NULL);
+  start = std::chrono::steady_clock::now();
+
+  double tick = samples[0].time;
+
+  for (auto &sample : samples) {
+    if (sample.time - tick >= 1)
+      FusionTick(&fusion, tick = sample.time);
+    length = Format(&sample, topic, payload);
+    FusionIngest(&fusion, topic, payload, length, sample.time);
+  }
+  FusionDrain(&fusion);
+
+  double replay = Elapsed(start);
+  unsigned long processed = 0, ignored = 0, transitions = 0;
+
+  for (auto worker : fusion.workers) {
+    processed += worker->processed;
+    ignored += worker->ignored;
+    transitions += worker->transitions;
+  }
+
+  printf("model:       %s\n", config.model == FUSION_MODEL_FINGERPRINT ? "fingerprint" : "centroid");
+  printf("messages:    %zu (%zu bytes)\n", samples.size(), sum);
+  printf("workers:     %d\n", workers);
+  printf("replay:      %.3f s, %.0f messages/s\n", replay, samples.size() / replay);
+  printf("formatting:  %.3f s, %.0f messages/s\n", format, samples.size() / format);
+  printf("processed:   %lu, ignored %lu, dropped %lu, stalls %lu\n", processed, ignored, fusion.dropped, fusion.stalls);
+  printf("transitions: %lu\n", transitions);
+
+  /*
+     the share of the time the devices were published in their true room
+  */
+  std::map<uint64_t, std::vector<std::pair<double, int> > > truth;
+
+  for (auto &sample : samples)
+    if (sample.room >= 0) {
+      auto &rooms = truth[sample.addr];
+
+      if (rooms.empty() || rooms.back().second != sample.room)
+        rooms.push_back(std::make_pair(sample.time, sample.room));
+    }
+  if (!truth.empty()) {
+    double correct = 0, total = 0, end = samples.back().time;
+
+    for (auto &device : truth) {
+      auto &published = _published[device.first];
+      auto &rooms = device.second;
+      size_t p = 0;
+
+      for (size_t r = 0; r < rooms.size(); r++) {
+        double from = rooms[r].first, to = r + 1 < rooms.size() ? rooms[r + 1].first : end;
+
+        /*
+           walk through the published rooms within this interval
+        */
+        while (from < to) {
+          while (p < published.size() && published[p].first <= from)
+            p++;
+
+          double until = p < published.size() ? fmin(published[p].first, to) : to;
+
+          if (p > 0 && published[p - 1].second == rooms[r].second)
+            correct += until - from;
+          total += until - from;
+          from = until;
+        }
+      }
+    }
+    printf("accuracy:    %.1f%% of the time in the true room\n", total > 0 ? 100 * correct / total : 0);
+  }
+
+  FusionStop(&fusion);
+  return 0;
+}/**/
@@ -0,0 +1,179 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  service publishing the room of each device out of the RSSI reported by several scanners
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+/*
+   usage: room-fusion -c config [-h host] [-p port] [-u user] [-P password] [-w workers] [-t topic] ...
+
+   subscribes to the device topics of the scanners (default +/device/+), and
+   publishes each transition of a device into another room retained below
+   the prefix of the configuration, like BLE-Scanner/room/AA-BB-CC-DD-EE-FF
+
+   the scanners have to publish the RSSI of each device -- so the emit plan
+   has to keep the RSSI and the Scanner, and the scanner cooperation has to
+   be off, as each scanner has to publish the devices it receives
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <mosquitto.h>
+#include "fusion.h"
+
+#define KEEPALIVE       60
+#define STATS_CYCLE     60          // seconds between the stats
+
+static volatile sig_atomic_t _running = 1;
+static std::vector<const char *> _topics;
+static FUSION_T _fusion;
+
+static double Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void Stop(int)
+{
+  _running = 0;
+}
+
+/*
+   the callbacks of the broker client -- they run in the main thread, which is the only producer
+*/
+static void OnConnect(struct mosquitto *mosq, void *, int rc)
+{
+  if (rc) {
+    fprintf(stderr, "room-fusion: connect failed: %s\n", mosquitto_connack_string(rc));
+    return;
+  }
+  for (auto topic : _topics)
+    mosquitto_subscribe(mosq, NULL, topic, 0);
+  fprintf(stderr, "room-fusion: connected\n");
+}
+
+static void OnMessage(struct mosquitto *, void *, const struct mosquitto_message *message)
+{
+  if (message->payloadlen > 0)
+    FusionIngest(&_fusion, message->topic, (const char *) message->payload, message->payloadlen, Now());
+}
+
+/*
+   publish a transition -- called by the workers while the main thread
+   runs the loop of the client, so the client is set up as threaded
+*/
+static void Publish(const char *topic, const char *payload, void *context)
+{
+  mosquitto_publish((struct mosquitto *) context, NULL, topic, strlen(payload), payload, 0, true);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *file = NULL, *host = "localhost", *user = NULL, *password = NULL;
+  int port = 1883, workers = 2, opt, rc;
+  FUSION_CONFIG_T config;
+  std::string error;
+  struct mosquitto *mosq;
+
+  while ((opt = getopt(argc, argv, "c:h:p:u:P:w:t:")) != -1) {
+    switch (opt) {
+      case 'c': file = optarg; break;
+      case 'h': host = optarg; break;
+      case 'p': port = atoi(optarg); break;
+      case 'u': user = optarg; break;
+      case 'P': password = optarg; break;
+      case 'w': workers = atoi(optarg); break;
+      case 't': _topics.push_back(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s -c config [-h host] [-p port] [-u user] [-P password] [-w workers] [-t topic] ...\n", argv[0]);
+        return 1;
+    }
+  }
+  if (!file) {
+    fprintf(stderr, "%s: no configuration given\n", argv[0]);
+    return 1;
+  }
+  if (!FusionConfigRead(&config, file, &error)) {
+    fprintf(stderr, "%s: %s\n", argv[0], error.c_str());
+    return 1;
+  }
+  if (_topics.empty())
+    _topics.push_back("+/device/+");
+
+  signal(SIGINT, Stop);
+  signal(SIGTERM, Stop);
+
+  mosquitto_lib_init();
+  if (!(mosq = mosquitto_new(NULL, true, NULL))) {
+    fprintf(stderr, "%s: can't create the client\n", argv[0]);
+    return 1;
+  }
+  mosquitto_threaded_set(mosq, true);
+  mosquitto_connect_callback_set(mosq, OnConnect);
+  mosquitto_message_callback_set(mosq, OnMessage);
+  if (user)
+    mosquitto_username_pw_set(mosq, user, password);
+  if ((rc = mosquitto_connect(mosq, host, port, KEEPALIVE)) != MOSQ_ERR_SUCCESS)
+    fprintf(stderr, "%s: can't connect to %s:%d: %s\n", argv[0], host, port, mosquitto_strerror(rc));
+
+  FusionStart(&_fusion, &config, workers, Publish, mosq);
+
+  double tick = Now(), stats = tick;
+
+  while (_running) {
+    if ((rc = mosquitto_loop(mosq, 100, 1)) != MOSQ_ERR_SUCCESS) {
+      sleep(1);
+      mosquitto_reconnect(mosq);
+    }
+
+    double now = Now();
+
+    if (now - tick >= 1) {
+      FusionTick(&_fusion, now);
+      tick = now;
+    }
+    if (now - stats >= STATS_CYCLE) {
+      unsigned long processed = 0, ignored = 0, transitions = 0;
+
+      for (auto worker : _fusion.workers) {
+        processed += worker->processed;
+        ignored += worker->ignored;
+        transitions += worker->transitions;
+      }
+      fprintf(stderr, "room-fusion: ingested %lu, processed %lu, ignored %lu, dropped %lu, stalls %lu, transitions %lu\n",
+        _fusion.ingested, processed, ignored, _fusion.dropped, _fusion.stalls, transitions);
+      stats = now;
+    }
+  }
+
+  FusionStop(&_fusion);
+  mosquitto_disconnect(mosq);
+  mosquitto_destroy(mosq);
+  mosquitto_lib_cleanup();
+  return 0;
+}/**/
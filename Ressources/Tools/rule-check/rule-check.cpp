@@ -0,0 +1,158 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  check & benchmark the rules selecting the devices to publish
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+/*
+   usage: rule-check [-b count] <rule> [name=value]...
+
+   the rule is compiled with the same compiler as on the BLE-Scanner,
+   and the code is listed -- with values given, the rule is evaluated
+   for them, values not given are 0
+
+   with -b, the rule is evaluated count times for random values and
+   the evaluations per second are reported
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../../../BLE-Scanner/rule.h"
+
+static const char *_op_names[] = {
+  "END", "CONST", "VAR", "EQ", "NE", "LT", "LE", "GT", "GE", "NOT", "JZ", "JNZ",
+};
+
+/*
+   list the code of a rule
+*/
+static void RuleList(const RULE_T *rule)
+{
+  for (int pc = 0; pc < rule->length; pc++) {
+    int op = rule->code[pc];
+
+    printf("%3d  %-6s", pc, _op_names[op]);
+    switch (op) {
+      case RULE_OP_CONST:
+        pc++;
+        printf("%d", rule->consts[rule->code[pc]]);
+        break;
+      case RULE_OP_VAR:
+        pc++;
+        printf("%s", RuleVarName(rule->code[pc]));
+        break;
+      case RULE_OP_JZ:
+      case RULE_OP_JNZ:
+        pc++;
+        printf("%d", pc + rule->code[pc]);
+        break;
+    }
+    printf("\n");
+  }
+  printf("%d bytes of code, %d constants\n", rule->length, rule->count);
+}
+
+/*
+   take over a value given as name=value
+*/
+static bool RuleValue(int32_t *vars, const char *arg)
+{
+  const char *equal = strchr(arg, '=');
+
+  if (equal)
+    for (int n = 0; n < RULE_VARS; n++)
+      if (strlen(RuleVarName(n)) == (size_t) (equal - arg) && !strncasecmp(RuleVarName(n), arg, equal - arg)) {
+        vars[n] = strtol(equal + 1, NULL, 0);
+        return true;
+      }
+  fprintf(stderr, "invalid value %s\n", arg);
+  return false;
+}
+
+/*
+   evaluate the rule for random values
+*/
+static void RuleBenchmark(const RULE_T *rule, long count)
+{
+  static int32_t vars[256][RULE_VARS];
+  struct timespec start, end;
+  long matches = 0;
+
+  srand(1);
+  for (int n = 0; n < 256; n++) {
+    vars[n][RULE_VAR_RSSI] = -100 + rand() % 70;
+    vars[n][RULE_VAR_MANUFACTURER] = (rand() % 4) ? 0x004c : rand() % 0x1000;
+    vars[n][RULE_VAR_PRESENT] = rand() % 2;
+    vars[n][RULE_VAR_BATTERY] = rand() % 101;
+    vars[n][RULE_VAR_INTERVAL] = 20 + rand() % 2000;
+    vars[n][RULE_VAR_ZONE] = rand() % 5;
+    vars[n][RULE_VAR_CONNECTABLE] = rand() % 2;
+    vars[n][RULE_VAR_AGE] = rand() % 600;
+    vars[n][RULE_VAR_SIGHTINGS] = rand() % 1000;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (long n = 0; n < count; n++)
+    matches += RuleEval(rule, vars[n & 255]);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  printf("%ld evaluations in %.3f s: %.0f evaluations/s, %.1f ns each, %ld matches\n",
+         count, seconds, count / seconds, seconds * 1e9 / count, matches);
+}
+
+int main(int argc, char *argv[])
+{
+  RULE_T rule;
+  char error[RULE_ERROR_LENGTH];
+  int32_t vars[RULE_VARS] = { 0 };
+  long count = 0;
+  int arg = 1;
+
+  if (arg + 1 < argc && !strcmp(argv[arg], "-b")) {
+    count = atol(argv[arg + 1]);
+    arg += 2;
+  }
+  if (arg >= argc) {
+    fprintf(stderr, "usage: %s [-b count] <rule> [name=value]...\n", argv[0]);
+    return 1;
+  }
+
+  if (!RuleCompile(&rule, argv[arg], error, sizeof(error))) {
+    printf("%s\n", error);
+    return 1;
+  }
+  RuleList(&rule);
+
+  if (arg + 1 < argc) {
+    for (int n = arg + 1; n < argc; n++)
+      if (!RuleValue(vars, argv[n]))
+        return 1;
+    printf("%s\n", RuleEval(&rule, vars) ? "match" : "no match");
+  }
+
+  if (count > 0)
+    RuleBenchmark(&rule, count);
+  return 0;
+}/**/
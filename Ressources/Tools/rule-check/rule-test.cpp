@@ -0,0 +1,184 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  tests of the compiler of the rules selecting the devices to publish
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+/*
+   usage: rule-test
+
+   compiles valid and invalid rules, and checks the code of the valid
+   ones, their results for given values and the errors with their
+   position -- the failed checks are reported, the exit code is the
+   number of failures
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "../../../BLE-Scanner/rule.h"
+
+static int _checks = 0;
+static int _failures = 0;
+
+#define CHECK(name,cond) { \
+    _checks++; \
+    if (!(cond)) { \
+      _failures++; \
+      printf("FAILED: %s: %s\n", name, #cond); \
+    } \
+  }
+
+static const char *_op_names[] = {
+  "END", "CONST", "VAR", "EQ", "NE", "LT", "LE", "GT", "GE", "NOT", "JZ", "JNZ",
+};
+
+/*
+   compile a rule and return its code as text, or the error
+*/
+static std::string Compile(const char *expression, RULE_T *rule)
+{
+  char error[RULE_ERROR_LENGTH];
+  std::string code;
+  char word[32];
+
+  if (!RuleCompile(rule, expression, error, sizeof(error)))
+    return error;
+
+  for (int pc = 0; pc < rule->length; pc++) {
+    int op = rule->code[pc];
+
+    code += std::string((pc) ? " " : "") + _op_names[op];
+    switch (op) {
+      case RULE_OP_CONST:
+        pc++;
+        snprintf(word, sizeof(word), " %d", rule->consts[rule->code[pc]]);
+        code += word;
+        break;
+      case RULE_OP_VAR:
+        pc++;
+        code += std::string(" ") + RuleVarName(rule->code[pc]);
+        break;
+      case RULE_OP_JZ:
+      case RULE_OP_JNZ:
+        pc++;
+        snprintf(word, sizeof(word), " %d", pc + rule->code[pc]);
+        code += word;
+        break;
+    }
+  }
+  return code;
+}
+
+static std::string Compile(const char *expression)
+{
+  RULE_T rule;
+
+  return Compile(expression, &rule);
+}
+
+/*
+   evaluate a rule for the values given as name=value, values not given are 0
+*/
+static bool Eval(const char *expression, const char *values)
+{
+  RULE_T rule;
+  int32_t vars[RULE_VARS] = { 0 };
+  char error[RULE_ERROR_LENGTH];
+  char name[16];
+  int value, n;
+
+  if (!RuleCompile(&rule, expression, error, sizeof(error)))
+    return false;
+  for (const char *s = values; sscanf(s, " %15[a-z]=%i%n", name, &value, &n) == 2; s += n)
+    for (int var = 0; var < RULE_VARS; var++)
+      if (!strcmp(RuleVarName(var), name))
+        vars[var] = value;
+  return RuleEval(&rule, vars);
+}
+
+int main(int argc, char *argv[])
+{
+  RULE_T rule;
+
+  /*
+     valid rules
+  */
+  CHECK("empty", Compile("  ", &rule) == "" && rule.length == 0);
+  CHECK("empty", Eval("", ""));
+  CHECK("compare", Compile("rssi > -80") == "VAR rssi CONST -80 GT END");
+  CHECK("hex", Compile("manufacturer == 0x004C") == "VAR manufacturer CONST 76 EQ END");
+  CHECK("upper case", Compile("RSSI >= -80") == "VAR rssi CONST -80 GE END");
+  CHECK("constants shared", Compile("rssi > 1 && age > 1", &rule) == "VAR rssi CONST 1 GT JZ 12 VAR age CONST 1 GT END" && rule.count == 1);
+  CHECK("vars", Compile("present && battery < 20", &rule) != "" && rule.vars == ((1 << RULE_VAR_PRESENT) | (1 << RULE_VAR_BATTERY)));
+  CHECK("and", Compile("present && connectable") == "VAR present JZ 6 VAR connectable END");
+  CHECK("or", Compile("present || connectable") == "VAR present JNZ 6 VAR connectable END");
+
+  /*
+     nested parentheses
+  */
+  CHECK("parentheses", Compile("((rssi > -80))") == Compile("rssi > -80"));
+  CHECK("parentheses", Compile("(present || zone == 1) && rssi > -80") == "VAR present JNZ 9 VAR zone CONST 1 EQ JZ 16 VAR rssi CONST -80 GT END");
+  CHECK("parentheses", Eval("(present || zone == 1) && rssi > -80", "present=1 rssi=-90") == false);
+  CHECK("parentheses", Eval("(present || zone == 1) && rssi > -80", "zone=1 rssi=-70") == true);
+  CHECK("parentheses", Compile("1 == (1 == (1 == (1 == (1 == (1 == (1 == 1))))))") != "" && Eval("1 == (1 == (1 == (1 == (1 == (1 == (1 == 1))))))", ""));
+  CHECK("parentheses", Compile("(rssi > -80") == "missing ) at position 12");
+  CHECK("parentheses", Compile("rssi > -80)") == "unexpected character at position 11");
+  CHECK("parentheses", Compile("1 == (1 == (1 == (1 == (1 == (1 == (1 == (1 == 1)))))))") == "rule nested too deep at position 49");
+
+  /*
+     repeated !
+  */
+  CHECK("not", Compile("!present") == "VAR present NOT END");
+  CHECK("not", Compile("!!present") == "VAR present NOT NOT END");
+  CHECK("not", Compile("! ! ! present") == "VAR present NOT NOT NOT END");
+  CHECK("not", Eval("!!present", "present=5") && !Eval("!!present", "") && Eval("!!!present", ""));
+  CHECK("not", Compile("!") == "unexpected end at position 2");
+  CHECK("not", Compile("!= 1") == "unexpected character at position 1");
+
+  /*
+     precedence -- ! binds looser than a comparison, && binds tighter than ||
+  */
+  CHECK("precedence", Compile("present || rssi > -80 && zone == 1") == "VAR present JNZ 16 VAR rssi CONST -80 GT JZ 16 VAR zone CONST 1 EQ END");
+  CHECK("precedence", Eval("present || rssi > -80 && zone == 1", "present=1 rssi=-90"));
+  CHECK("precedence", !Eval("present || rssi > -80 && zone == 1", "rssi=-70"));
+  CHECK("precedence", Eval("rssi > -80 && zone == 1 || present", "present=1 rssi=-90"));
+  CHECK("precedence", Compile("!zone == 1") == "VAR zone CONST 1 EQ NOT END");
+  CHECK("precedence", Eval("!zone == 1", "zone=2"));
+
+  /*
+     invalid rules
+  */
+  CHECK("unknown name", Compile("foo > 1") == "unknown name at position 1");
+  CHECK("unknown name", Compile("rssi > -80 && rssix") == "unknown name at position 15");
+  CHECK("unexpected end", Compile("rssi >") == "unexpected end at position 7");
+  CHECK("unexpected end", Compile("rssi > -80 && ") == "unexpected end at position 15");
+  CHECK("unexpected end", Compile("(") == "unexpected end at position 2");
+  CHECK("single &", Compile("rssi > -80 & present") == "unexpected character at position 12");
+  CHECK("single |", Compile("rssi > -80 | present") == "unexpected character at position 12");
+  CHECK("chained ==", Compile("present == 1 == 1") == "unexpected character at position 14");
+  CHECK("chained <", Compile("-90 < rssi < -60") == "unexpected character at position 12");
+  CHECK("invalid", Compile("rssi > -80", &rule) != "" && Compile("foo", &rule) != "" && rule.length == 0);
+
+  printf("%d checks, %d failures\n", _checks, _failures);
+  return _failures;
+}/**/
@@ -0,0 +1,276 @@
+/*
+  BLE-Scanner
+
+  (c) 2020 Christian.Lorenz@gromeck.de
+
+  replay a feed of scan results to compare the watchlist filtering
+
+
+  This file is part of BLE-Scanner.
+
+  BLE-Scanner is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  BLE-Scanner is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with BLE-Scanner.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+/*
+   usage: watchlist-bench [-d devices] [-w watched] [-t seconds] [-s seed] [-l list] [feed]
+
+   the feed is a text file with one advertisement per line:
+
+     <time in seconds> <address> [<rssi>]
+
+   fields might be separated by white spaces, commas or semicolons,
+   lines starting with # are ignored, the lines have to be sorted by time
+
+   without a feed, the given number of devices is generated, each
+   advertising with a random interval between 100 ms and 1 s
+
+   the watchlist is read from the list file, one address per line, or
+   the given number of addresses is taken from the feed
+
+   the feed is replayed through a mocked controller, which either passes
+   all advertisements to the host, which filters them with the lookup of
+   the BLE-Scanner, or only the ones of the addresses in its filter accept
+   list -- as the BLE-Scanner does, the controller only filters if the
+   watchlist fits into it
+
+   the callbacks per second, the accepted advertisements per second and
+   the time of the callbacks per advertisement of the feed are reported
+   for both
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <vector>
+#include "../../../BLE-Scanner/watchsearch.h"
+
+/*
+   an advertisement of the feed
+*/
+typedef struct _advert {
+  double time;
+  uint64_t addr;
+} ADVERT_T;
+
+/*
+   the result of a replay
+*/
+typedef struct _result {
+  long callbacks;
+  long accepted;
+  double seconds;
+} RESULT_T;
+
+/*
+   convert an address like 01:23:45:67:89:ab into a number
+*/
+static bool ParseAddress(const char *s, uint64_t *addr)
+{
+  unsigned int b[6];
+
+  if (sscanf(s, "%2x:%2x:%2x:%2x:%2x:%2x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6)
+    return false;
+  *addr = 0;
+  for (int n = 0; n < 6; n++)
+    *addr = (*addr << 8) | b[n];
+  return true;
+}
+
+/*
+   read the feed
+*/
+static bool ReadFeed(const char *filename, std::vector<ADVERT_T> &feed)
+{
+  char line[256];
+  FILE *fp;
+
+  if (!(fp = fopen(filename, "r"))) {
+    perror(filename);
+    return false;
+  }
+  while (fgets(line, sizeof(line), fp)) {
+    const char *sep = " \t\r\n,;";
+    char *time_s, *addr_s;
+    ADVERT_T advert;
+
+    if (*line == '#' || !(time_s = strtok(line, sep)) || !(addr_s = strtok(NULL, sep)) || !ParseAddress(addr_s, &advert.addr))
+      continue;
+    advert.time = atof(time_s);
+    if (!feed.empty() && advert.time < feed.back().time) {
+      fprintf(stderr, "%s: feed is not sorted by time\n", filename);
+      fclose(fp);
+      return false;
+    }
+    feed.push_back(advert);
+  }
+  fclose(fp);
+  return true;
+}
+
+/*
+   read the watchlist
+*/
+static bool ReadList(const char *filename, std::vector<uint64_t> &list)
+{
+  char line[256];
+  FILE *fp;
+
+  if (!(fp = fopen(filename, "r"))) {
+    perror(filename);
+    return false;
+  }
+  while (fgets(line, sizeof(line), fp)) {
+    char *addr_s = strtok(line, " \t\r\n,;");
+    uint64_t addr;
+
+    if (addr_s && *addr_s != '#' && ParseAddress(addr_s, &addr))
+      list.push_back(addr);
+  }
+  fclose(fp);
+  return true;
+}
+
+/*
+   generate a feed of devices advertising with random intervals
+*/
+static void GenerateFeed(std::vector<ADVERT_T> &feed, int devices, int seconds)
+{
+  for (int n = 0; n < devices; n++) {
+    double interval = (100 + rand() % 901) / 1000.0;
+    uint64_t addr = 0x0000c0de0000ULL + n;
+
+    for (double t = interval * (rand() % 1000) / 1000.0; t < seconds; t += interval)
+      feed.push_back({ t, addr });
+  }
+  std::sort(feed.begin(), feed.end(), [](const ADVERT_T &a, const ADVERT_T &b) { return a.time < b.time; });
+}
+
+/*
+   replay the feed through the mocked controller
+
+   with controller filtering only the advertisements of the addresses in the
+   filter accept list reach the host, otherwise all of them are passed to
+   the callback, which checks them against the watchlist
+*/
+static RESULT_T Replay(const std::vector<ADVERT_T> &feed, const std::vector<uint64_t> &list, bool controller)
+{
+  std::set<uint64_t> accept(list.begin(), list.end());
+  std::vector<uint64_t> passed;
+  RESULT_T result = { 0, 0, 0 };
+
+  for (const ADVERT_T &advert : feed)
+    if (!controller || accept.count(advert.addr))
+      passed.push_back(advert.addr);
+
+  /*
+     the callbacks
+  */
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t addr : passed) {
+    result.callbacks++;
+    if (controller || WatchlistSearch(list.data(), list.size(), addr))
+      result.accepted++;
+  }
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+/*
+   report the result of a replay
+*/
+static void Report(const char *title, const RESULT_T *result, size_t adverts, double span)
+{
+  printf("  %-26s %10.1f/s %10.1f/s %10.2f ns\n", title, result->callbacks / span, result->accepted / span, result->seconds * 1e9 / adverts);
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<ADVERT_T> feed;
+  std::vector<uint64_t> list;
+  const char *list_file = NULL;
+  int devices = 200;
+  int watched = 8;
+  int seconds = 60;
+  int c;
+
+  srand(1);
+  while ((c = getopt(argc, argv, "d:w:t:s:l:")) != -1) {
+    switch (c) {
+      case 'd':
+        devices = atoi(optarg);
+        break;
+      case 'w':
+        watched = atoi(optarg);
+        break;
+      case 't':
+        seconds = atoi(optarg);
+        break;
+      case 's':
+        srand(atoi(optarg));
+        break;
+      case 'l':
+        list_file = optarg;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-d devices] [-w watched] [-t seconds] [-s seed] [-l list] [feed]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (optind < argc) {
+    if (!ReadFeed(argv[optind], feed))
+      return 1;
+  }
+  else
+    GenerateFeed(feed, devices, seconds);
+  if (feed.empty()) {
+    fprintf(stderr, "no advertisements\n");
+    return 1;
+  }
+
+  if (list_file) {
+    if (!ReadList(list_file, list))
+      return 1;
+  }
+  else {
+    std::set<uint64_t> seen;
+
+    for (const ADVERT_T &advert : feed)
+      if ((int) list.size() < watched && seen.insert(advert.addr).second)
+        list.push_back(advert.addr);
+  }
+  std::sort(list.begin(), list.end());
+  list.erase(std::unique(list.begin(), list.end()), list.end());
+
+  double span = (feed.back().time > feed.front().time) ? feed.back().time - feed.front().time : 1.0;
+  bool fits = !list.empty() && list.size() <= WATCHLIST_CONTROLLER_MAX;
+  RESULT_T host = Replay(feed, list, false);
+  RESULT_T controller = Replay(feed, list, fits);
+
+  printf("%zu advertisements in %.1f s, %zu addresses on the watchlist\n", feed.size(), span, list.size());
+  printf("  %-26s %12s %12s %13s\n", "filtering", "callbacks", "accepted", "time");
+  Report("host", &host, feed.size(), span);
+  Report((fits) ? "controller" : "controller (list too long)", &controller, feed.size(), span);
+  printf("  callbacks reduced by %.1f %%\n", 100.0 * (host.callbacks - controller.callbacks) / host.callbacks);
+
+  if (host.accepted != controller.accepted) {
+    fprintf(stderr, "the filterings accepted a different number of advertisements\n");
+    return 1;
+  }
+  return 0;
+}/**/